@@ -0,0 +1,101 @@
+#ifndef ASYNC_HTTP_TRANSPORT_HPP
+#define ASYNC_HTTP_TRANSPORT_HPP
+
+#define ASIO_STANDALONE
+#include <asio.hpp>
+#include <atomic>
+#include <curl/curl.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "http_transport.hpp"
+
+struct HttpResult {
+    CURLcode code{CURLE_OK};
+    long status{0};             // HTTP status, 0 if no response arrived
+    std::string body;
+    std::string error;          // Set when code != CURLE_OK
+
+    bool ok() const { return code == CURLE_OK; }
+};
+
+typedef std::function<void(HttpResult&&)> HttpCallback;
+
+// Non-blocking HTTP over curl_multi, driven by an asio io_context: curl tells
+// us which sockets to watch and when its timeout fires, asio waits on them,
+// and any number of requests progress concurrently on the io_context thread.
+// Connections, TLS sessions and DNS entries are cached by the multi handle.
+//
+// get/post may be called from any thread; the transfer is started and the
+// callback runs on the io_context thread.
+class AsyncHttpTransport {
+public:
+    AsyncHttpTransport(asio::io_context& io, const HttpTransportOptions& options = HttpTransportOptions());
+    ~AsyncHttpTransport();
+
+    AsyncHttpTransport(const AsyncHttpTransport&) = delete;
+    AsyncHttpTransport& operator=(const AsyncHttpTransport&) = delete;
+
+    void get(std::string url, std::string auth_token, HttpCallback callback);
+    void post(std::string url, std::string body, std::string auth_token, HttpCallback callback);
+
+    size_t in_flight() const { return in_flight_.load(std::memory_order_relaxed); }
+
+private:
+    struct Headers {
+        std::string auth_token;
+        curl_slist* get{nullptr};
+        curl_slist* post{nullptr};
+        ~Headers();
+    };
+
+    struct Request {
+        CURL* easy{nullptr};
+        bool is_post{false};
+        std::string url;
+        std::string body;
+        std::string auth_token;
+        std::string response;
+        std::shared_ptr<Headers> headers;
+        HttpCallback callback;
+    };
+
+    struct SocketWatch {
+        explicit SocketWatch(asio::io_context& io, curl_socket_t fd) : descriptor(io, fd), fd(fd) {}
+        asio::posix::stream_descriptor descriptor;
+        curl_socket_t fd;
+        int action{0};
+        bool reading{false};
+        bool writing{false};
+        bool removed{false};
+    };
+
+    void submit(std::unique_ptr<Request> request);
+    void start(std::unique_ptr<Request> request);
+    CURL* acquire_easy();
+    std::shared_ptr<Headers> headers_for(const std::string& auth_token);
+    void watch(const std::shared_ptr<SocketWatch>& socket);
+    void on_socket_ready(curl_socket_t fd, int event);
+    void on_timeout(const asio::error_code& ec);
+    void check_completed();
+
+    static int socket_callback(CURL* easy, curl_socket_t fd, int what, void* self, void* socket_data);
+    static int timer_callback(CURLM* multi, long timeout_ms, void* self);
+
+    asio::io_context& io_;
+    HttpTransportOptions options_;
+    CURLM* multi_;
+    asio::steady_timer timer_;
+    int running_{0};
+    std::atomic<size_t> in_flight_{0};
+
+    // io_context thread only.
+    std::unordered_map<CURL*, std::unique_ptr<Request>> active_;
+    std::unordered_map<curl_socket_t, std::shared_ptr<SocketWatch>> sockets_;
+    std::vector<CURL*> idle_easy_;
+    std::shared_ptr<Headers> headers_;
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef ASYNC_REST_CLIENT_HPP
+#define ASYNC_REST_CLIENT_HPP
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "async_http_transport.hpp"
+#include "rate_limiter.hpp"
+
+// Non-blocking counterpart of the functions in rest_client.hpp. Every call
+// returns immediately; the response is delivered to the callback on the event
+// loop thread, or through the returned future. Any number of requests can be
+// in flight at once, so a batch of orders is sent by simply issuing the calls
+// back to back: they go out together over the pooled connections (or a single
+// multiplexed HTTP/2 connection) instead of one round trip after another.
+//
+// Requests draw on getRateLimiter() like the blocking calls. Out of credits,
+// one waits on a timer for the refill, up to the same limits, and is
+// otherwise answered with a local too_many_requests (10028) error.
+class AsyncRestClient {
+public:
+    // Runs its own event loop on a background thread.
+    explicit AsyncRestClient(const std::string& access_token = "",
+                             const HttpTransportOptions& options = HttpTransportOptions());
+    // Shares an io_context the caller already runs, e.g. the WebSocket client's.
+    AsyncRestClient(asio::io_context& io, const std::string& access_token = "",
+                    const HttpTransportOptions& options = HttpTransportOptions());
+    ~AsyncRestClient();
+
+    AsyncRestClient(const AsyncRestClient&) = delete;
+    AsyncRestClient& operator=(const AsyncRestClient&) = delete;
+
+    void set_access_token(const std::string& access_token);
+
+    void place_order(const std::string& instrument, double amount, const std::string& side,
+                     const std::string& order_type, double price, HttpCallback callback);
+    void cancel_order(const std::string& order_id, HttpCallback callback);
+    void modify_order(const std::string& order_id, double new_amount, double new_price, HttpCallback callback);
+    void get_order_book(const std::string& instrument, int depth, HttpCallback callback);
+    void get_positions(const std::string& currency, HttpCallback callback);
+
+    // Future forms resolve to the response body, or hold a std::runtime_error
+    // on transport failure, matching what the blocking functions return and throw.
+    std::future<std::string> place_order(const std::string& instrument, double amount, const std::string& side,
+                                         const std::string& order_type, double price = 0.0);
+    std::future<std::string> cancel_order(const std::string& order_id);
+    std::future<std::string> modify_order(const std::string& order_id, double new_amount, double new_price);
+    std::future<std::string> get_order_book(const std::string& instrument, int depth = 10);
+    std::future<std::string> get_positions(const std::string& currency);
+
+    // Includes requests waiting for credits. Destroy a client that shares
+    // an io_context only once this is zero.
+    size_t in_flight() const { return transport_.in_flight() + waiting_.load(std::memory_order_relaxed); }
+
+private:
+    static HttpCallback fulfil(std::shared_ptr<std::promise<std::string>> promise);
+    std::string access_token();
+    void send(RequestClass request_class, std::string url, std::string auth_token, HttpCallback callback);
+    void send(RequestClass request_class, std::chrono::steady_clock::time_point deadline, bool queued,
+              std::string url, std::string auth_token, HttpCallback callback);
+
+    std::unique_ptr<asio::io_context> owned_io_;
+    asio::io_context& io_;
+    std::unique_ptr<asio::executor_work_guard<asio::io_context::executor_type>> work_;
+    std::thread loop_thread_;
+    AsyncHttpTransport transport_;
+
+    std::mutex token_mutex_;
+    std::string access_token_;
+    std::atomic<size_t> waiting_{0};
+};
+
+#endif
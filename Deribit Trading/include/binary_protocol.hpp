@@ -0,0 +1,147 @@
+#ifndef BINARY_PROTOCOL_HPP
+#define BINARY_PROTOCOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "notification_parser.hpp"
+#include "order_book.hpp"
+
+// Optional downstream wire format, chosen per connection with
+// "format": "binary" in the subscribe action. SBE-style: every binary
+// WebSocket frame is one message, a WireHeader followed by the template's
+// fixed block, then for book and trades a repeating group (a WireGroup and
+// num_in_group fixed-size entries). All integers and doubles little-endian,
+// no padding between fields beyond what the layouts below spell out, so a
+// consumer reads a message by casting or memcpy into these structs.
+//
+// Instruments are referred to by the gateway's dense id; a WireInstrument
+// message maps it to the name before the first update for that id.
+// Anything without a template here (subscription replies, errors, other RPC
+// responses) still arrives as a JSON text frame.
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "The binary downstream protocol is encoded by memcpy and assumes a little-endian host"
+#endif
+
+enum WireTemplate : uint16_t {
+    WIRE_BOOK = 1,
+    WIRE_TRADES = 2,
+    WIRE_TICKER = 3,
+    WIRE_ORDER_ACK = 4,
+    WIRE_INSTRUMENT = 5
+};
+
+const uint16_t kWireSchemaId = 1;
+const uint16_t kWireSchemaVersion = 1;
+
+#pragma pack(push, 1)
+
+struct WireHeader {
+    uint16_t block_length;      // Size of the fixed block that follows
+    uint16_t template_id;
+    uint16_t schema_id;
+    uint16_t version;
+};
+
+struct WireGroup {
+    uint16_t block_length;      // Size of one entry
+    uint16_t num_in_group;
+};
+
+struct WireInstrument {
+    uint32_t instrument;
+    uint32_t padding;
+    double tick_size;           // 0 when the gateway has no metadata
+    double min_trade_amount;
+    char name[64];              // NUL-padded
+};
+
+// Followed by two groups of WireLevel: bids, then asks.
+struct WireBook {
+    uint32_t instrument;
+    uint8_t snapshot;           // 1: replace the book, 0: apply as delta
+    uint8_t padding[3];
+    int64_t timestamp;
+    int64_t change_id;
+    int64_t prev_change_id;
+};
+
+struct WireLevel {
+    double price;
+    double amount;              // 0 with action DELETE
+    uint8_t action;             // BookLevel::Action: 0 new, 1 change, 2 delete
+    uint8_t padding[7];
+};
+
+// Followed by one group of WireTrade.
+struct WireTrades {
+    uint32_t instrument;
+    uint32_t padding;
+};
+
+struct WireTrade {
+    int64_t timestamp;
+    int64_t trade_seq;
+    double price;
+    double amount;
+    uint8_t side;               // OrderSide: 0 buy, 1 sell (aggressor)
+    uint8_t padding[7];
+};
+
+struct WireTicker {
+    uint32_t instrument;
+    uint32_t padding;
+    int64_t timestamp;
+    double best_bid_price;
+    double best_bid_amount;
+    double best_ask_price;
+    double best_ask_amount;
+    double last_price;
+    double mark_price;
+    double index_price;
+};
+
+// Response to place_order, modify_order or cancel_order.
+struct WireOrderAck {
+    uint64_t request_id;        // Gateway's JSON-RPC id, as in the "request_id" reply to the order action
+    uint32_t instrument;        // InstrumentRegistry::kInvalidId when unknown
+    int32_t error_code;         // Deribit error code, 0 on success
+    uint8_t state;              // OrderState
+    uint8_t side;               // OrderSide
+    uint8_t order_type;         // OrderType
+    uint8_t padding[5];
+    double price;               // 0 for market orders
+    double amount;
+    double filled_amount;
+    double average_price;
+    int64_t timestamp;          // Last update, ms
+    char order_id[48];          // NUL-padded; empty on error
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(WireHeader) == 8, "WireHeader layout");
+static_assert(sizeof(WireBook) == 32, "WireBook layout");
+static_assert(sizeof(WireLevel) == 24, "WireLevel layout");
+static_assert(sizeof(WireTrade) == 40, "WireTrade layout");
+static_assert(sizeof(WireOrderAck) == 112, "WireOrderAck layout");
+
+// Each encoder replaces out with one message; false when the source does not
+// fit the template, and the caller then forwards the JSON instead.
+bool encode_wire_instrument(uint32_t instrument, const std::string& name, std::string& out);
+bool encode_wire_book(uint32_t instrument, const BookNotification& book, std::string& out);
+bool encode_wire_book_snapshot(uint32_t instrument, int64_t change_id, int64_t timestamp, const PriceLevel* bids,
+                               size_t bid_count, const PriceLevel* asks, size_t ask_count, std::string& out);
+// A delta computed by the gateway rather than forwarded from Deribit.
+bool encode_wire_book_changes(uint32_t instrument, int64_t change_id, int64_t prev_change_id, int64_t timestamp,
+                              const BookLevel* bids, size_t bid_count, const BookLevel* asks, size_t ask_count,
+                              std::string& out);
+bool encode_wire_trades(uint32_t instrument, StrRef data, std::string& out);
+bool encode_wire_ticker(uint32_t instrument, const TickerNotification& ticker, std::string& out);
+// From Deribit's JSON-RPC response to an order request.
+bool encode_wire_order_ack(const std::string& response, std::string& out);
+// From a book, ticker or trades notification as received from Deribit.
+bool encode_wire_notification(uint32_t instrument, const std::string& frame, std::string& out);
+
+#endif
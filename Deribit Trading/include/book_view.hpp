@@ -0,0 +1,62 @@
+#ifndef BOOK_VIEW_HPP
+#define BOOK_VIEW_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "notification_parser.hpp"
+#include "order_book.hpp"
+
+// One downstream window on a local book: the best `depth` levels per side
+// (0 for the whole book), sent at most once per `interval_ms` (0 for every
+// change). Subscribers asking for the same window on an instrument share a
+// view. refresh() re-reads the window and diffs it against what the view
+// last sent, so its subscribers only see levels that changed inside the
+// window: a level pushed out by a better one arrives as a delete, one that
+// moves up into the window as a new level. Not thread-safe; the fan-out
+// thread owns every view.
+class BookView {
+public:
+    BookView(uint32_t instrument, size_t depth, uint32_t interval_ms, uint64_t serial);
+
+    uint32_t instrument() const { return instrument_; }
+    size_t depth() const { return depth_; }
+    uint32_t interval_ms() const { return interval_ms_; }
+    // Unique per view, so a subscriber moving between views of one book is
+    // never handed a delta against another view's levels.
+    uint64_t serial() const { return serial_; }
+
+    // False when the book is not valid or nothing inside the window changed.
+    bool refresh(OrderBookStore::Entry& entry);
+
+    // The book's change_id at the last refresh, and at the one before it.
+    int64_t change_id() const { return change_id_; }
+    int64_t prev_change_id() const { return prev_change_id_; }
+    bool has_levels() const { return change_id_ != 0; }
+
+    // Deribit-style book notification on channel(): the last diff as
+    // "change", or the whole window as "snapshot".
+    std::string render_json(bool snapshot) const;
+    // The same as a WIRE_BOOK message.
+    std::string render_wire(bool snapshot) const;
+    // book.<instrument>.<depth or "full">.<interval>ms
+    std::string channel() const;
+
+private:
+    uint32_t instrument_;
+    size_t depth_;
+    uint32_t interval_ms_;
+    uint64_t serial_;
+
+    int64_t change_id_{0};
+    int64_t prev_change_id_{0};
+    int64_t timestamp_{0};
+    // The window as last sent, best first, and the scratch copy refresh()
+    // reads into; swapped rather than reallocated.
+    std::vector<PriceLevel> sides_[2];
+    std::vector<PriceLevel> next_[2];
+    std::vector<BookLevel> changes_[2];
+};
+
+#endif
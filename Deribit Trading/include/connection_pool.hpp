@@ -0,0 +1,55 @@
+#ifndef CONNECTION_POOL_HPP
+#define CONNECTION_POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+class WebSocketClient;
+class WebSocketServer;
+
+// The gateway's Deribit connections: one order-entry session carrying every
+// private request and the user.orders / user.trades streams, and N
+// market-data connections with instruments sharded across them by
+// InstrumentRegistry id. A burst of book updates then queues on a shard's
+// socket and thread, never ahead of an order acknowledgement.
+class ConnectionPool {
+public:
+    static const size_t kMaxShards = 16;
+
+    ~ConnectionPool();
+
+    // Call once, before the server's fan-out thread starts: every connection
+    // gets its own fan-out producer queue on server (which may be null).
+    void configure(size_t market_data_shards, WebSocketServer* server);
+    bool configured() const { return orders_ != nullptr; }
+    size_t shards() const { return market_data_.size(); }
+
+    WebSocketClient& orders() { return *orders_; }
+    WebSocketClient& market_data(uint32_t instrument) { return *market_data_[instrument % market_data_.size()]; }
+
+    // Journals every connection, to <prefix>.orders and <prefix>.md<N>.
+    void start_capture(const std::string& prefix);
+    // Starts one thread per connection: the order session as
+    // ThreadRole::ORDER_EGRESS, shard n as instance n of DERIBIT_INGRESS.
+    // Each authenticates once connected and renews its token from then on.
+    void connect(const std::string& uri, const std::string& client_id, const std::string& client_secret);
+    void stop();
+    void join();
+
+    size_t scheduled_requests() const;
+    // Summed over the market data connections.
+    uint64_t book_resyncs() const;
+
+private:
+    std::unique_ptr<WebSocketClient> orders_;
+    std::vector<std::unique_ptr<WebSocketClient>> market_data_;
+    std::vector<std::thread> threads_;
+};
+
+ConnectionPool& getConnectionPool();
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef ENDPOINTS_HPP
+#define ENDPOINTS_HPP
+
+#include <string>
+
+// Exchange endpoints, read once from the environment so every binary can be
+// pointed at the local mock exchange instead of the Deribit testnet:
+//
+//   DERIBIT_REST_URL    REST base, default https://test.deribit.com/api/v2
+//   DERIBIT_WS_URL      WebSocket API, default wss://test.deribit.com/ws/api/v2
+//   DERIBIT_TLS_VERIFY  0 to accept self-signed certificates (default 1)
+const std::string& rest_base_url();
+const std::string& ws_url();
+bool tls_verify();
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef HTTP_TRANSPORT_HPP
+#define HTTP_TRANSPORT_HPP
+
+#include <curl/curl.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct HttpTransportOptions {
+    size_t warm_handles = 4;           // Easy handles created up front
+    bool http2 = false;                // Negotiate HTTP/2 over TLS and multiplex on one connection
+    long connect_timeout_ms = 3000;
+    long request_timeout_ms = 5000;
+    long dns_cache_timeout_s = 600;
+};
+
+// Blocking HTTP transport over a pool of long-lived curl easy handles. Each
+// handle keeps its connection alive between requests, and the handles share
+// one DNS cache and TLS session cache, so after the first request to a host
+// there is no lookup, and a handle's first connection resumes the TLS session
+// instead of a full handshake. Safe to call from any thread; each concurrent
+// caller borrows its own handle.
+class HttpTransport {
+public:
+    explicit HttpTransport(const HttpTransportOptions& options = HttpTransportOptions());
+    ~HttpTransport();
+
+    HttpTransport(const HttpTransport&) = delete;
+    HttpTransport& operator=(const HttpTransport&) = delete;
+
+    // Throw std::runtime_error on transport failure; HTTP error bodies are returned as-is.
+    std::string get(const std::string& url, const std::string& auth_token = "");
+    // An empty body is sent as a GET, the way the query-string callers expect.
+    std::string post(const std::string& url, const std::string& body, const std::string& auth_token = "");
+
+    // Sends a HEAD request to url so a pooled handle already holds a live
+    // connection, and the shared caches a TLS session and DNS entry, before
+    // the first real request.
+    void warm_up(const std::string& url);
+
+private:
+    struct Handle {
+        CURL* easy{nullptr};
+        std::string response;
+        // Header lists are rebuilt only when the token changes.
+        std::string auth_token;
+        curl_slist* get_headers{nullptr};
+        curl_slist* post_headers{nullptr};
+    };
+
+    Handle* acquire();
+    void release(Handle* handle);
+    Handle* create_handle();
+    void set_auth_token(Handle& handle, const std::string& auth_token);
+    std::string perform(Handle& handle, const char* what);
+
+    static void lock_share(CURL*, curl_lock_data data, curl_lock_access, void* self);
+    static void unlock_share(CURL*, curl_lock_data data, void* self);
+
+    HttpTransportOptions options_;
+    CURLSH* share_;
+    std::mutex share_mutexes_[CURL_LOCK_DATA_LAST];
+
+    std::mutex pool_mutex_;
+    std::vector<std::unique_ptr<Handle>> handles_;
+    std::vector<Handle*> idle_;
+};
+
+// Process-wide transport used by http_get/http_post. Set DERIBIT_HTTP2=1 to
+// enable HTTP/2.
+HttpTransport& getHttpTransport();
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef INSTRUMENTS_HPP
+#define INSTRUMENTS_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "notification_parser.hpp"
+
+// Fixed-point price, in ticks of its instrument.
+struct Price {
+    int64_t ticks{0};
+
+    bool operator==(Price other) const { return ticks == other.ticks; }
+    bool operator!=(Price other) const { return ticks != other.ticks; }
+    bool operator<(Price other) const { return ticks < other.ticks; }
+    bool operator>(Price other) const { return ticks > other.ticks; }
+    bool operator<=(Price other) const { return ticks <= other.ticks; }
+    bool operator>=(Price other) const { return ticks >= other.ticks; }
+};
+
+// Fixed-point amount, in lots of the instrument's min_trade_amount.
+struct Qty {
+    int64_t lots{0};
+
+    bool operator==(Qty other) const { return lots == other.lots; }
+    bool operator!=(Qty other) const { return lots != other.lots; }
+    bool operator<(Qty other) const { return lots < other.lots; }
+    bool operator>(Qty other) const { return lots > other.lots; }
+};
+
+// Trading rules of one instrument as returned by public/get_instruments.
+// tick_e8 and lot_e8 are the tick size and lot in units of 1e-8, so turning
+// ticks or lots back into text is integer arithmetic and always exact.
+struct InstrumentSpec {
+    std::string name;
+    std::string kind;               // future, option, spot, ...
+    std::string base_currency;
+    std::string quote_currency;
+    double tick_size{0.0};
+    double contract_size{0.0};
+    double min_trade_amount{0.0};
+    int64_t tick_e8{0};
+    int64_t lot_e8{0};
+    // Inverse contracts (USD-quoted futures) are sized in USD, so the amount
+    // already is the notional.
+    bool inverse{false};
+
+    // Nearest tick. Deribit rejects anything off the grid, so round here
+    // rather than pay a round trip to find out.
+    Price price_from(double price) const;
+    // Whole lots, rounded down so an order never grows past what was asked.
+    Qty qty_from(double amount) const;
+    double to_double(Price price) const { return static_cast<double>(price.ticks) * tick_size; }
+    double to_double(Qty qty) const { return static_cast<double>(qty.lots) * min_trade_amount; }
+    // Exact decimal text; out needs room for 32 characters.
+    size_t format(Price price, char* out) const;
+    size_t format(Qty qty, char* out) const;
+};
+
+// Process-wide mapping between instrument names and dense integer ids.
+// A name gets its id the first time it is seen (metadata load, the first
+// notification, a downstream subscribe when there is no metadata) and keeps
+// it for the life of the process, so per-instrument state elsewhere is a
+// plain array indexed by id.
+// Lookups are lock-free and never allocate; only a new name takes the lock.
+class InstrumentRegistry {
+public:
+    static const uint32_t kMaxInstruments = 16384;
+    static const uint32_t kInvalidId = 0xFFFFFFFF;
+
+    InstrumentRegistry();
+
+    // kInvalidId once the table is full.
+    uint32_t intern(StrRef name);
+    uint32_t intern(const std::string& name) { return intern(StrRef{name.data(), name.size()}); }
+    // kInvalidId when the name has never been interned.
+    uint32_t find(StrRef name) const;
+    uint32_t find(const std::string& name) const { return find(StrRef{name.data(), name.size()}); }
+
+    // Only for ids returned by intern() or find().
+    const std::string& name(uint32_t id) const { return names_[id]; }
+    uint32_t size() const { return count_.load(std::memory_order_acquire); }
+
+private:
+    // Open addressing over twice as many slots as ids; a slot holds id + 1.
+    static const uint32_t kSlotCount = kMaxInstruments * 2;
+
+    static uint32_t hash(StrRef name);
+
+    std::unique_ptr<std::string[]> names_;
+    std::unique_ptr<std::atomic<uint32_t>[]> slots_;
+    std::atomic<uint32_t> count_{0};
+    std::mutex mutex_;
+};
+
+InstrumentRegistry& getInstrumentRegistry();
+
+// Metadata for every instrument the gateway may trade, fetched once at
+// startup and indexed by registry id. Lookups do not lock: finish loading
+// before other threads start and treat the cache as read-only afterwards.
+class InstrumentCache {
+public:
+    InstrumentCache();
+
+    // Fetches public/get_instruments for a currency ("BTC", "ETH", ... or
+    // "any") and adds every active instrument. Returns the number added.
+    size_t load(const std::string& currency);
+    // Parses a get_instruments response. Returns the number added.
+    size_t load_response(const std::string& response);
+    // False when the spec is unusable (no tick size or lot); replaces an
+    // existing entry of the same name.
+    bool add(const InstrumentSpec& spec);
+
+    const InstrumentSpec* find(uint32_t id) const {
+        return id < InstrumentRegistry::kMaxInstruments ? specs_[id].get() : nullptr;
+    }
+    const InstrumentSpec* find(const std::string& name) const { return find(getInstrumentRegistry().find(name)); }
+    size_t size() const { return count_; }
+
+private:
+    std::unique_ptr<std::unique_ptr<InstrumentSpec>[]> specs_;
+    size_t count_{0};
+};
+
+InstrumentCache& getInstrumentCache();
+
+#endif
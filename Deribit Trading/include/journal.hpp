@@ -0,0 +1,130 @@
+#ifndef JOURNAL_HPP
+#define JOURNAL_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "spsc_queue.hpp"
+
+// On-disk layout of a journal segment: a JournalFileHeader followed by
+// records, each a JournalRecordHeader and its payload padded to 8 bytes. A
+// record with size 0 (or the end of the file) marks the end of the segment.
+struct JournalFileHeader {
+    char magic[8];              // "DBJRNL01"
+    uint64_t segment_index;
+    uint64_t created_ns;        // system_clock
+};
+
+struct JournalRecordHeader {
+    uint32_t size;              // Payload bytes, excluding padding
+    uint32_t reserved;
+    uint64_t received_ns;       // system_clock at receipt
+};
+
+// Appends raw inbound frames to memory-mapped, append-only segment files
+// named <prefix>.<index>.jrnl, starting a new segment once the current one
+// reaches segment_bytes.
+//
+// append() is meant for the IO thread: it only copies the frame into a
+// lock-free byte ring. A background thread moves records from the ring into
+// the mapped file. If the ring fills up, the frame is dropped and counted
+// rather than stalling the socket.
+class JournalWriter : public CacheAligned {
+public:
+    JournalWriter(const std::string& prefix, size_t segment_bytes = 256 << 20, size_t ring_bytes = 64 << 20);
+    ~JournalWriter();
+
+    JournalWriter(const JournalWriter&) = delete;
+    JournalWriter& operator=(const JournalWriter&) = delete;
+
+    // Single producer.
+    bool append(const char* data, size_t size, uint64_t received_ns);
+
+    // Blocks until everything appended so far is in the mapped file.
+    void flush();
+
+    uint64_t records_written() const { return records_written_.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    void writer_loop();
+    bool drain();
+    void write_record(const JournalRecordHeader& header, const char* payload);
+    void open_segment(size_t min_bytes);
+    void close_segment();
+
+    // Variable-length SPSC ring of [JournalRecordHeader][payload][pad], 16-byte
+    // aligned. A header with size kWrapMarker tells the consumer to skip to the
+    // start of the ring.
+    static const uint32_t kWrapMarker = 0xFFFFFFFFu;
+    bool ring_push(const char* data, size_t size, uint64_t received_ns);
+
+    const size_t ring_mask_;
+    std::unique_ptr<char[]> ring_;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> ring_head_{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> ring_tail_{0};
+    size_t cached_head_{0};
+
+    const std::string prefix_;
+    const size_t segment_bytes_;
+    uint64_t segment_index_{0};
+    int fd_{-1};
+    char* map_{nullptr};
+    size_t mapped_{0};
+    size_t used_{0};
+
+    std::atomic<bool> running_{true};
+    std::atomic<uint64_t> records_written_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::thread writer_;
+};
+
+struct JournalRecord {
+    uint64_t received_ns;
+    const char* data;
+    size_t size;
+};
+
+// Sequential reader over one segment, memory-mapped read-only.
+class JournalReader {
+public:
+    explicit JournalReader(const std::string& path);
+    ~JournalReader();
+
+    JournalReader(const JournalReader&) = delete;
+    JournalReader& operator=(const JournalReader&) = delete;
+
+    bool next(JournalRecord& record);
+    void rewind();
+
+private:
+    int fd_{-1};
+    const char* map_{nullptr};
+    size_t size_{0};
+    size_t offset_{0};
+};
+
+// Feeds journal segments, in order, to a frame handler: either as fast as
+// possible or paced by the recorded receive timestamps (scaled by speed).
+// The handler gets a mutable copy of each frame, as a live socket would.
+class JournalReplay {
+public:
+    typedef std::function<void(std::string& payload)> FrameHandler;
+
+    explicit JournalReplay(std::vector<std::string> segments) : segments_(std::move(segments)) {}
+
+    // Returns the number of frames replayed.
+    uint64_t run(const FrameHandler& handler, bool paced = false, double speed = 1.0);
+
+    // Every segment written for prefix so far, in index order.
+    static std::vector<std::string> segments_for(const std::string& prefix);
+
+private:
+    std::vector<std::string> segments_;
+};
+
+#endif
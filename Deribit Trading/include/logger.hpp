@@ -0,0 +1,201 @@
+#ifndef LOGGER_HPP
+#define LOGGER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "spsc_queue.hpp"
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO  1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_ERROR 3
+
+// Calls below this level compile to nothing, arguments included.
+// Override with -DLOG_MIN_LEVEL=LOG_LEVEL_DEBUG.
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#endif
+
+// A (pointer, length) string argument, e.g. a payload that is not null terminated.
+struct LogText {
+    const char* data;
+    size_t size;
+    LogText(const char* d, size_t n) : data(d), size(n) {}
+    LogText(const std::string& s) : data(s.data()), size(s.size()) {}
+};
+
+// Fixed-size binary record. The format string must be a literal: only its
+// pointer is stored, and the "{}" placeholders are expanded on the writer thread.
+struct LogRecord {
+    static const size_t kMaxArgs = 8;
+    static const size_t kTextCapacity = 400;
+
+    enum ArgType : uint8_t { INT, UINT, DOUBLE, TEXT, TEXT_TRUNCATED };
+
+    union Value {
+        int64_t i;
+        uint64_t u;
+        double d;
+        struct {
+            uint16_t offset;
+            uint16_t size;
+            uint32_t original_size;
+        } text;
+    };
+
+    uint64_t timestamp_ns;
+    const char* format;
+    uint8_t level;
+    uint8_t arg_count;
+    uint16_t text_used;
+    ArgType types[kMaxArgs];
+    Value values[kMaxArgs];
+    char text[kTextCapacity];
+};
+
+// Hot paths only fill a record in their own thread's ring; a background thread
+// formats and writes. A full ring drops the record rather than block.
+class Logger {
+public:
+    Logger();
+    ~Logger();
+
+    template <typename... Args>
+    void log(int level, const char* format, const Args&... args) {
+        LogRecord* record = thread_buffer().try_claim();
+        if (!record) return;
+        record->timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        record->format = format;
+        record->level = static_cast<uint8_t>(level);
+        record->arg_count = 0;
+        record->text_used = 0;
+        int expand[] = {0, (encode(*record, args), 0)...};
+        (void)expand;
+        thread_buffer().commit();
+    }
+
+    // Defaults to stdout. Takes effect for records written after the call.
+    void set_output(FILE* output);
+    void flush();
+    uint64_t dropped() const;
+
+private:
+    typedef SpscQueue<LogRecord> ThreadBuffer;
+    static const size_t kThreadBufferRecords = 2048;
+
+    ThreadBuffer& thread_buffer() {
+        static thread_local ThreadBuffer* buffer = nullptr;
+        if (!buffer) buffer = register_thread();
+        return *buffer;
+    }
+    ThreadBuffer* register_thread();
+
+    static LogRecord::Value* next_slot(LogRecord& r, LogRecord::ArgType type) {
+        if (r.arg_count >= LogRecord::kMaxArgs) return nullptr;
+        r.types[r.arg_count] = type;
+        return &r.values[r.arg_count++];
+    }
+
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+    encode(LogRecord& r, T value) {
+        if (LogRecord::Value* v = next_slot(r, LogRecord::INT)) v->i = value;
+    }
+
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type
+    encode(LogRecord& r, T value) {
+        if (LogRecord::Value* v = next_slot(r, LogRecord::UINT)) v->u = value;
+    }
+
+    template <typename T>
+    static typename std::enable_if<std::is_floating_point<T>::value>::type
+    encode(LogRecord& r, T value) {
+        if (LogRecord::Value* v = next_slot(r, LogRecord::DOUBLE)) v->d = value;
+    }
+
+    static void encode(LogRecord& r, const LogText& value) {
+        size_t room = LogRecord::kTextCapacity - r.text_used;
+        size_t n = value.size < room ? value.size : room;
+        LogRecord::Value* v = next_slot(r, n < value.size ? LogRecord::TEXT_TRUNCATED : LogRecord::TEXT);
+        if (!v) return;
+        std::memcpy(r.text + r.text_used, value.data, n);
+        v->text.offset = r.text_used;
+        v->text.size = static_cast<uint16_t>(n);
+        v->text.original_size = static_cast<uint32_t>(value.size);
+        r.text_used += static_cast<uint16_t>(n);
+    }
+    static void encode(LogRecord& r, const std::string& value) { encode(r, LogText(value)); }
+    static void encode(LogRecord& r, const char* value) { encode(r, LogText(value, std::strlen(value))); }
+
+    void writer_loop();
+    bool drain();
+    void format(const LogRecord& record, std::string& out);
+
+    mutable std::mutex buffers_mutex_;
+    std::mutex drain_mutex_;
+    // Line-aligned through SpscQueue's CacheAligned operator new, so each
+    // ring's head and tail stay apart from each other and from the next ring.
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+    std::atomic<FILE*> output_;
+    std::atomic<bool> running_;
+    std::thread writer_;
+    uint64_t reported_drops_{0};
+};
+
+Logger& getLogger();
+
+// Lets one call site through at most once per interval and counts the rest.
+class LogRateLimiter {
+public:
+    explicit LogRateLimiter(int64_t interval_ms) : interval_ns_(interval_ms * 1000000) {}
+
+    bool allow() {
+        int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        int64_t last = last_ns_.load(std::memory_order_relaxed);
+        if (now - last < interval_ns_ || !last_ns_.compare_exchange_strong(last, now, std::memory_order_relaxed)) {
+            suppressed_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+    // Number of calls suppressed since the previous one that was let through.
+    uint64_t take_suppressed() { return suppressed_.exchange(0, std::memory_order_relaxed); }
+
+private:
+    const int64_t interval_ns_;
+    std::atomic<int64_t> last_ns_{0};
+    std::atomic<uint64_t> suppressed_{0};
+};
+
+#define LOG_AT(level, ...) \
+    do { if ((level) >= LOG_MIN_LEVEL) getLogger().log((level), __VA_ARGS__); } while (0)
+
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...)  LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...)  LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+// For payload dumps on hot paths. The format gets one extra trailing argument:
+// how many calls were suppressed since the last one logged.
+#define LOG_EVERY_MS(level, interval_ms, format, ...) \
+    do { \
+        if ((level) >= LOG_MIN_LEVEL) { \
+            static LogRateLimiter log_rate_limiter_(interval_ms); \
+            if (log_rate_limiter_.allow()) \
+                getLogger().log((level), format, __VA_ARGS__, log_rate_limiter_.take_suppressed()); \
+        } \
+    } while (0)
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef MATCHING_ENGINE_HPP
+#define MATCHING_ENGINE_HPP
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+enum class MockOrderState { OPEN, FILLED, CANCELLED };
+
+struct MockOrder {
+    uint64_t id{0};
+    uint32_t account{0};
+    bool buy{true};
+    bool market{false};
+    double price{0.0};
+    double amount{0.0};
+    double filled{0.0};
+    double filled_notional{0.0};
+    MockOrderState state{MockOrderState::OPEN};
+    uint64_t created_ms{0};
+    uint64_t updated_ms{0};
+    std::string label;
+
+    double remaining() const { return amount - filled; }
+    double average_price() const { return filled > 0.0 ? filled_notional / filled : 0.0; }
+};
+
+struct MockFill {
+    uint64_t trade_id;
+    uint64_t maker_order;
+    uint64_t taker_order;
+    uint32_t maker_account;
+    uint32_t taker_account;
+    bool taker_buy;
+    double price;
+    double amount;
+    uint64_t timestamp_ms;
+};
+
+// One aggregated price level after a change; amount 0 means the level is gone.
+struct MockLevelChange {
+    bool bid;
+    double price;
+    double amount;
+};
+
+// Price-time priority limit order book for one instrument. Each price level
+// is a FIFO of resting orders; takers sweep the opposite side from the best
+// price until filled or out of the limit. Not thread-safe.
+class MatchingEngine {
+public:
+    // Order and trade ids start after id_base, so several engines can hand out
+    // ids that never collide.
+    MatchingEngine(const std::string& instrument, double tick_size, uint64_t id_base = 0);
+
+    // Returns the order as it stands after matching. Fills are appended to
+    // fills. Unfilled market remainders are cancelled, limit remainders rest.
+    MockOrder submit(uint32_t account, bool buy, bool market, double price, double amount,
+                     const std::string& label, uint64_t now_ms, std::vector<MockFill>& fills);
+    // False when the order is unknown, not open, or belongs to another account.
+    bool cancel(uint64_t order_id, uint32_t account, uint64_t now_ms, MockOrder& result);
+    // Amount is the new total amount. Keeps queue priority only when the price
+    // is unchanged and the amount does not grow, as Deribit does.
+    bool edit(uint64_t order_id, uint32_t account, double amount, double price,
+              uint64_t now_ms, std::vector<MockFill>& fills, MockOrder& result);
+    const MockOrder* find(uint64_t order_id) const;
+
+    // Best first, at most depth levels (0 = all).
+    void levels(bool bid, size_t depth, std::vector<std::pair<double, double>>& out) const;
+    double best_bid() const { return bids_.empty() ? 0.0 : bids_.rbegin()->first; }
+    double best_ask() const { return asks_.empty() ? 0.0 : asks_.begin()->first; }
+    double last_price() const { return last_price_; }
+    size_t resting_orders(bool bid) const;
+    // Resting orders of one account, oldest first.
+    void open_orders(uint32_t account, std::vector<MockOrder>& out) const;
+
+    const std::string& instrument() const { return instrument_; }
+    double tick_size() const { return tick_size_; }
+    double round_to_tick(double price) const;
+
+    // Bumped once per operation that changed the book.
+    uint64_t change_id() const { return change_id_; }
+    // Levels touched since the previous call, in the order they changed.
+    void take_changes(std::vector<MockLevelChange>& out);
+
+    // Finished orders of this account are forgotten instead of kept for
+    // lookups, so synthetic flow does not grow memory without bound.
+    void set_transient_account(uint32_t account) { transient_account_ = account; }
+
+private:
+    struct Level {
+        double total{0.0};
+        std::list<uint64_t> queue;
+    };
+    // Both sides are keyed ascending: the best bid is the last entry.
+    typedef std::map<double, Level> Side;
+
+    struct Resting {
+        MockOrder order;
+        std::list<uint64_t>::iterator position;
+        bool resting{false};
+    };
+
+    void match(Resting& taker, uint64_t now_ms, std::vector<MockFill>& fills);
+    void rest(Resting& entry);
+    void unrest(Resting& entry);
+    // Returns the final state; the entry may be erased.
+    MockOrder finish(uint64_t order_id, MockOrderState state, uint64_t now_ms);
+    void record_change(bool bid, double price);
+
+    std::string instrument_;
+    double tick_size_;
+    Side bids_;
+    Side asks_;
+    std::unordered_map<uint64_t, Resting> orders_;
+    std::vector<MockLevelChange> changes_;
+    uint64_t next_order_id_;
+    uint64_t next_trade_id_;
+    uint64_t change_id_{1};
+    bool changed_{false};
+    double last_price_{0.0};
+    uint32_t transient_account_{0};
+};
+
+#endif
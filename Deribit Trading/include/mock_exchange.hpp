@@ -0,0 +1,186 @@
+#ifndef MOCK_EXCHANGE_HPP
+#define MOCK_EXCHANGE_HPP
+
+#define ASIO_STANDALONE
+#define _WEBSOCKETPP_CPP11_STL_
+
+#include <websocketpp/config/asio.hpp>
+#include <websocketpp/server.hpp>
+#include <nlohmann/json.hpp>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "matching_engine.hpp"
+
+struct MockExchangeOptions {
+    uint16_t port = 8443;
+    std::vector<std::string> instruments{"BTC-PERPETUAL"};
+    double mid_price = 64000.0;
+    double tick_size = 0.5;
+    double contract_size = 10.0;        // Also the min trade amount
+    int initial_levels = 25;            // Seeded per side at startup
+    double churn_per_second = 200.0;    // Synthetic book events per instrument
+    uint32_t seed = 1;
+    int token_ttl_s = 900;
+    std::string cert_file;              // PEM files; a throwaway self-signed
+    std::string key_file;               // certificate is generated when empty
+};
+
+// Local stand-in for the Deribit testnet, so benchmarks measure this system
+// instead of the public internet. One TLS port serves both the JSON-RPC
+// WebSocket API (any path) and REST under /api/v2/<method>. Supported subset:
+//
+//   public/auth (client_credentials, refresh_token), public/test,
+//   public/get_instruments, public/get_order_book, public/subscribe, public/unsubscribe,
+//   private/buy, private/sell, private/cancel, private/edit,
+//   private/get_positions, private/get_open_orders, private/subscribe, private/unsubscribe,
+//   book.<instrument>.{100ms,raw} channels, and user.orders.* / user.trades.*
+//   channels for the subscriber's own account.
+//
+// Each instrument has a price-time priority matching engine. Client orders
+// trade against each other and against synthetic liquidity that a churn
+// timer keeps adding, cancelling and crossing. Everything runs on the
+// server's io thread, so no state is locked.
+class MockExchange {
+public:
+    explicit MockExchange(const MockExchangeOptions& options);
+
+    void run();
+    void stop();
+
+private:
+    typedef websocketpp::server<websocketpp::config::asio_tls> server;
+    typedef websocketpp::connection_hdl connection_hdl;
+    typedef nlohmann::json json;
+
+    static const uint32_t kSyntheticAccount = 1;
+    static const uint64_t kOrderIdStride = 1000000000000ULL;
+    static const int kChurnTickMs = 10;
+    static const int kBookIntervalMs = 100;
+
+    struct RpcError : std::runtime_error {
+        RpcError(int code, const std::string& message) : std::runtime_error(message), code(code) {}
+        int code;
+    };
+
+    struct Channel;
+
+    struct Instrument {
+        std::string name;
+        std::unique_ptr<MatchingEngine> engine;
+        double mid{0.0};
+        double churn_credit{0.0};
+        std::vector<uint64_t> synthetic_orders;
+        std::vector<Channel*> channels;
+    };
+
+    // One book.* channel. pending holds levels changed since the last
+    // notification; published is the book as subscribers last saw it, which
+    // decides between "new" and "change".
+    struct Channel {
+        std::string name;
+        Instrument* instrument{nullptr};
+        int interval_ms{0};                 // 0 = raw, every change
+        std::set<connection_hdl, std::owner_less<connection_hdl>> subscribers;
+        std::map<std::pair<bool, double>, double> pending;
+        std::map<std::pair<bool, double>, double> published;
+        uint64_t last_change_id{0};
+    };
+
+    struct Session {
+        uint32_t account{0};
+        std::set<std::string> user_channels;    // user.orders.* and user.trades.*
+    };
+
+    struct Token {
+        uint32_t account;
+        uint64_t expires_ms;
+    };
+
+    struct Position {
+        double size{0.0};                   // Signed, positive = long
+        double average_price{0.0};
+    };
+
+    // Per-request state threaded through dispatch().
+    struct CallContext {
+        uint32_t account{0};
+        Session* session{nullptr};          // WebSocket only
+        connection_hdl hdl;
+        std::vector<Channel*> snapshots;    // Sent after the subscribe response
+    };
+
+    std::shared_ptr<asio::ssl::context> make_tls_context();
+    void on_open(connection_hdl hdl);
+    void on_close(connection_hdl hdl);
+    void on_message(connection_hdl hdl, server::message_ptr msg);
+    void on_http(connection_hdl hdl);
+
+    // Full JSON-RPC response for one call, success or error.
+    json execute(const std::string& method, const json& params, const json& id, CallContext& context);
+    json dispatch(const std::string& method, const json& params, CallContext& context);
+    uint32_t require_account(const json& params, CallContext& context);
+
+    json rpc_auth(const json& params, CallContext& context);
+    json rpc_order(bool buy, const json& params, uint32_t account);
+    json rpc_cancel(const json& params, uint32_t account);
+    json rpc_edit(const json& params, uint32_t account);
+    json rpc_positions(const json& params, uint32_t account);
+    json rpc_open_orders(const json& params, uint32_t account);
+    json rpc_order_book(const json& params);
+    json rpc_instruments(const json& params);
+    void check_grid(double amount, double price, bool market) const;
+    json rpc_subscribe(const json& params, CallContext& context, bool subscribe);
+    bool subscribe_user(const std::string& name, const json& params, CallContext& context, bool subscribe);
+
+    Instrument& instrument_for(const std::string& name);
+    Instrument& instrument_for_order(uint64_t order_id);
+    json order_json(const Instrument& instrument, const MockOrder& order) const;
+    json trades_json(const Instrument& instrument, const MockOrder& order, const std::vector<MockFill>& fills) const;
+    json fill_json(const Instrument& instrument, const MockFill& fill, bool maker) const;
+    // Updates positions and sends user.trades (and maker user.orders) notifications.
+    void apply_fills(const Instrument& instrument, const std::vector<MockFill>& fills);
+    void notify_order(const Instrument& instrument, const MockOrder& order);
+    void notify_user(uint32_t account, const Instrument& instrument, const char* prefix, const json& data);
+
+    Channel* channel_for(const std::string& name);
+    void after_book_change(Instrument& instrument);
+    void flush_channel(Channel& channel);
+    std::string snapshot_notification(Channel& channel);
+    void send_to(connection_hdl hdl, const std::string& message);
+
+    void seed_book(Instrument& instrument);
+    void schedule_churn();
+    void schedule_book_flush();
+    void churn(Instrument& instrument);
+
+    static uint64_t now_ms();
+    static uint64_t now_us();
+
+    MockExchangeOptions options_;
+    server m_server;
+    std::shared_ptr<asio::ssl::context> tls_context_;
+    std::mt19937 rng_;
+
+    std::vector<std::unique_ptr<Instrument>> instruments_;
+    std::unordered_map<std::string, Instrument*> instruments_by_name_;
+    std::map<std::string, std::unique_ptr<Channel>> channels_;
+    std::map<connection_hdl, Session, std::owner_less<connection_hdl>> sessions_;
+
+    std::unordered_map<std::string, uint32_t> accounts_;        // client_id -> account
+    std::unordered_map<std::string, Token> access_tokens_;
+    std::unordered_map<std::string, Token> refresh_tokens_;
+    std::map<std::pair<uint32_t, std::string>, Position> positions_;
+    uint32_t next_account_{kSyntheticAccount + 1};
+
+    std::vector<MockLevelChange> changes_;
+    std::vector<MockFill> fills_;
+};
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef NOTIFICATION_PARSER_HPP
+#define NOTIFICATION_PARSER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Non-owning view into the frame being parsed. Only valid while the frame is.
+struct StrRef {
+    const char* data{nullptr};
+    size_t size{0};
+
+    bool empty() const { return size == 0; }
+    bool equals(const char* s) const { return std::strlen(s) == size && std::memcmp(data, s, size) == 0; }
+    bool starts_with(const char* s) const {
+        size_t n = std::strlen(s);
+        return n <= size && std::memcmp(data, s, n) == 0;
+    }
+    std::string str() const { return std::string(data, size); }
+};
+
+enum class NotificationKind {
+    NONE,
+    BOOK,
+    TICKER,
+    TRADES,
+    USER,
+    OTHER
+};
+
+struct BookLevel {
+    enum Action { NEW, CHANGE, DELETE };
+    Action action;
+    double price;
+    double amount;
+};
+
+// Walks a Deribit level array in place: [["new",price,amount],...] or [[price,amount],...].
+class LevelCursor {
+public:
+    explicit LevelCursor(StrRef array);
+    bool next(BookLevel& level);
+
+private:
+    const char* pos_;
+    const char* end_;
+};
+
+struct Trade {
+    int64_t timestamp;
+    int64_t trade_seq;
+    StrRef trade_id;
+    double price;
+    double amount;
+    bool buy;
+};
+
+// Walks the trades.* data array in place.
+class TradeCursor {
+public:
+    explicit TradeCursor(StrRef array);
+    bool next(Trade& trade);
+
+private:
+    const char* pos_;
+    const char* end_;
+};
+
+// One order from a user.orders.* notification. Market orders carry the
+// string "market_price" as their price, which reads as 0.
+struct OrderUpdate {
+    StrRef order_id;
+    StrRef instrument;
+    StrRef order_state;     // open, filled, rejected, cancelled, untriggered
+    StrRef order_type;
+    StrRef label;
+    bool buy;
+    double price;
+    double amount;
+    double filled_amount;
+    double average_price;
+    int64_t creation_timestamp;
+    int64_t last_update_timestamp;
+};
+
+// Walks user.orders.* data in place. Raw channels send one order object,
+// grouped ones an array of them; both are accepted.
+class OrderCursor {
+public:
+    explicit OrderCursor(StrRef data);
+    bool next(OrderUpdate& order);
+
+private:
+    const char* pos_;
+    const char* end_;
+    bool single_;
+};
+
+// One execution from a user.trades.* notification.
+struct UserTrade {
+    StrRef trade_id;
+    StrRef order_id;
+    StrRef instrument;
+    StrRef order_state;     // State of the order after this trade
+    bool buy;
+    bool maker;
+    double price;
+    double amount;
+    double fee;
+    int64_t timestamp;
+};
+
+// Walks the user.trades.* data array in place.
+class UserTradeCursor {
+public:
+    explicit UserTradeCursor(StrRef array);
+    bool next(UserTrade& trade);
+
+private:
+    const char* pos_;
+    const char* end_;
+};
+
+struct BookNotification {
+    bool snapshot;
+    int64_t timestamp;
+    int64_t change_id;
+    int64_t prev_change_id;
+    StrRef bids;
+    StrRef asks;
+};
+
+struct TickerNotification {
+    int64_t timestamp;
+    double best_bid_price;
+    double best_bid_amount;
+    double best_ask_price;
+    double best_ask_amount;
+    double last_price;
+    double mark_price;
+    double index_price;
+};
+
+// Typed view of a "subscription" notification. Every StrRef points into the
+// original frame, so parsing never allocates.
+struct Notification {
+    NotificationKind kind{NotificationKind::NONE};
+    StrRef channel;
+    StrRef instrument;   // Second channel segment, empty for user.* channels.
+    StrRef data;         // Raw "data" value.
+    BookNotification book{};
+    TickerNotification ticker{};
+};
+
+// Fast path for book.*, ticker.*, trades.* and user.* notifications.
+// Returns false for anything that is not a subscription notification (RPC
+// responses, heartbeats) or is malformed; callers fall back to nlohmann::json.
+bool parse_notification(const char* frame, size_t size, Notification& out);
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef ORDER_BOOK_HPP
+#define ORDER_BOOK_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct PriceLevel {
+    double price;
+    double amount;
+};
+
+// L2 book for a single instrument, kept in two flat sorted arrays.
+// Each side is ordered so that its best level sits at the back: bids ascending,
+// asks descending. Most updates land near the top of the book, so inserts and
+// erases only shift a handful of elements and best bid/ask is a back() read.
+class OrderBook {
+public:
+    enum Side { BID, ASK };
+
+    // Snapshot: begin_snapshot, add_snapshot_level for every level, end_snapshot.
+    void begin_snapshot(int64_t change_id, int64_t timestamp);
+    void add_snapshot_level(Side side, double price, double amount);
+    void end_snapshot();
+
+    // Returns false and invalidates the book if prev_change_id does not follow
+    // the last applied change_id. The caller must then resync from a snapshot.
+    bool begin_delta(int64_t prev_change_id, int64_t change_id, int64_t timestamp);
+    // amount == 0 deletes the level.
+    void apply_level(Side side, double price, double amount);
+
+    void invalidate();
+
+    bool is_valid() const { return valid_; }
+    int64_t change_id() const { return change_id_; }
+    int64_t timestamp() const { return timestamp_; }
+
+    // nullptr when the side is empty.
+    const PriceLevel* best_bid() const { return bids_.empty() ? nullptr : &bids_.back(); }
+    const PriceLevel* best_ask() const { return asks_.empty() ? nullptr : &asks_.back(); }
+
+    size_t depth(Side side) const { return side == BID ? bids_.size() : asks_.size(); }
+    // Copies up to n levels, best first, into out. Returns the number copied.
+    size_t top(Side side, PriceLevel* out, size_t n) const;
+
+private:
+    std::vector<PriceLevel> bids_;
+    std::vector<PriceLevel> asks_;
+    int64_t change_id_{0};
+    int64_t timestamp_{0};
+    bool valid_{false};
+};
+
+// Process-wide set of local books, one per subscribed instrument, indexed by
+// InstrumentRegistry id. The Deribit IO thread writes a book under its entry
+// mutex; readers take the same mutex only for as long as it takes to copy out
+// what they need. Finding a book is an array read.
+class OrderBookStore {
+public:
+    struct Entry {
+        std::mutex mutex;
+        OrderBook book;
+    };
+
+    OrderBookStore();
+    ~OrderBookStore();
+
+    // nullptr for an invalid id.
+    Entry* get_or_create(uint32_t instrument);
+    Entry* find(uint32_t instrument);
+    Entry* get_or_create(const std::string& instrument);
+    Entry* find(const std::string& instrument);
+
+private:
+    std::mutex create_mutex_;
+    std::unique_ptr<std::atomic<Entry*>[]> books_;
+};
+
+OrderBookStore& getOrderBookStore();
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef ORDER_ENCODER_HPP
+#define ORDER_ENCODER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "instruments.hpp"
+#include "notification_parser.hpp"
+
+enum class OrderSide : uint8_t { BUY, SELL };
+enum class OrderType : uint8_t { LIMIT, MARKET };
+
+// Writes value in decimal and returns the number of characters written.
+// out needs room for 20 characters.
+size_t format_uint(uint64_t value, char* out);
+
+// Writes value rounded to kDecimalPlaces fraction digits with trailing zeros
+// trimmed, so 64250.5 is "64250.5" and 10 is "10". Exact for every tick size
+// and amount Deribit uses. out needs room for 32 characters.
+const int kDecimalPlaces = 8;
+size_t format_decimal(double value, char* out);
+// Writes value * 1e-8 the same way, from integers only.
+size_t format_scaled(int64_t value_e8, char* out);
+
+// Builds JSON-RPC order requests without allocating. Every method has its own
+// fixed buffer that already holds the constant part of the message, access
+// token included if one is set; an encode call only writes the variable
+// fields after it.
+// The returned view stays valid until the next call for the same method.
+//
+// Not thread-safe: keep one per thread. Encoding fails (returns an empty
+// view) when a field is too long or contains characters JSON would need to
+// escape; callers then fall back to WebSocketClient::build_*.
+class OrderEncoder {
+public:
+    static const size_t kMaxMessage = 512;
+    static const size_t kMaxTokenSize = 256;
+
+    OrderEncoder();
+
+    // Rebuilds the templates only when the token differs from the current one.
+    // Empty (the default) leaves the token out, for session-authenticated
+    // WebSocket connections.
+    void set_access_token(const std::string& token);
+
+    StrRef place_order(uint64_t id, OrderSide side, OrderType type, const std::string& instrument,
+                       double amount, double price);
+    StrRef cancel_order(uint64_t id, const std::string& order_id);
+    StrRef modify_order(uint64_t id, const std::string& order_id, double amount, double price);
+
+    // Fixed-point variants: price and amount are already on the instrument's
+    // grid and are written exactly.
+    StrRef place_order(uint64_t id, OrderSide side, OrderType type, const InstrumentSpec& instrument,
+                       Qty amount, Price price);
+    StrRef modify_order(uint64_t id, const std::string& order_id, const InstrumentSpec& instrument,
+                        Qty amount, Price price);
+
+private:
+    struct Template {
+        char buffer[kMaxMessage];
+        size_t prefix{0};   // Bytes that stay the same between calls
+    };
+
+    enum { BUY_LIMIT, BUY_MARKET, SELL_LIMIT, SELL_MARKET, CANCEL, EDIT, TEMPLATE_COUNT };
+
+    Template& place_template(OrderSide side, OrderType type);
+    void rebuild_templates();
+    void build_template(Template& t, const char* method, const char* type);
+
+    Template templates_[TEMPLATE_COUNT];
+    char token_[kMaxTokenSize];
+    size_t token_size_{0};
+    bool token_valid_{true};
+};
+
+#endif
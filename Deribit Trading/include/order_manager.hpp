@@ -0,0 +1,156 @@
+#ifndef ORDER_MANAGER_HPP
+#define ORDER_MANAGER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "instruments.hpp"
+#include "notification_parser.hpp"
+#include "order_encoder.hpp"
+
+enum class OrderState : uint8_t { OPEN, UNTRIGGERED, FILLED, CANCELLED, REJECTED };
+
+const char* order_state_name(OrderState state);
+// Deribit's order_state string; anything unrecognised reads as open.
+OrderState parse_order_state(StrRef state);
+
+// An order as the gateway last saw it. Fixed size so records live in a
+// preallocated pool: longer labels are truncated, longer ids not tracked.
+struct OrderRecord {
+    static const size_t kMaxOrderId = 48;
+    static const size_t kMaxLabel = 64;
+
+    char order_id[kMaxOrderId];
+    char label[kMaxLabel];
+    uint8_t order_id_size{0};
+    uint8_t label_size{0};
+    uint32_t instrument{InstrumentRegistry::kInvalidId};
+    OrderSide side{OrderSide::BUY};
+    OrderType type{OrderType::LIMIT};
+    OrderState state{OrderState::OPEN};
+    double price{0.0};              // 0 for market orders
+    double amount{0.0};
+    double filled_amount{0.0};
+    double average_price{0.0};
+    int64_t creation_timestamp{0};
+    int64_t last_update_timestamp{0};
+    uint32_t fill_count{0};
+
+    bool is_open() const { return state == OrderState::OPEN || state == OrderState::UNTRIGGERED; }
+    double remaining() const { return amount - filled_amount; }
+    std::string id() const { return std::string(order_id, order_id_size); }
+};
+
+struct FillRecord {
+    static const size_t kMaxTradeId = 32;
+
+    char trade_id[kMaxTradeId];
+    char order_id[OrderRecord::kMaxOrderId];
+    uint8_t trade_id_size{0};
+    uint8_t order_id_size{0};
+    uint32_t instrument{InstrumentRegistry::kInvalidId};
+    OrderSide side{OrderSide::BUY};
+    bool maker{false};
+    double price{0.0};
+    double amount{0.0};
+    double fee{0.0};
+    int64_t timestamp{0};
+};
+
+struct OrderManagerStats {
+    size_t open_orders;
+    size_t tracked_orders;
+    uint64_t fills;
+    uint64_t recycled;
+};
+
+// Local view of the account's orders, fed by Deribit's private user.orders.*
+// and user.trades.* channels, so "what is open" and "what filled" never need
+// a round trip.
+//
+// Orders live in a fixed pool addressed through an open-addressing table
+// keyed by order id. Open orders are also threaded on an intrusive list per
+// InstrumentRegistry id. Finished orders stay queryable until the pool runs
+// out, after which the oldest finished order is reused. Fills go to a ring
+// of the most recent kMaxFills.
+//
+// The Deribit IO thread applies updates and downstream sessions query, both
+// under one mutex held only for the copy.
+class OrderManager {
+public:
+    static const uint32_t kMaxOrders = 16384;
+    static const size_t kMaxFills = 8192;
+
+    OrderManager();
+
+    // Takes user.orders.* and user.trades.* notifications; ignores the rest.
+    void on_notification(const Notification& note);
+    void apply_order(const OrderUpdate& update);
+    void apply_trade(const UserTrade& trade);
+
+    bool find(StrRef order_id, OrderRecord& out) const;
+    bool find(const std::string& order_id, OrderRecord& out) const {
+        return find(StrRef{order_id.data(), order_id.size()}, out);
+    }
+    // Open orders of one instrument, or of all of them for kInvalidId.
+    // Replaces the contents of out and returns its size.
+    size_t open_orders(uint32_t instrument, std::vector<OrderRecord>& out) const;
+    // Up to max fills, newest first, optionally limited to one instrument
+    // (kInvalidId for all) and one order (empty for all).
+    size_t fills(uint32_t instrument, StrRef order_id, size_t max, std::vector<FillRecord>& out) const;
+
+    OrderManagerStats stats() const;
+
+private:
+    static const uint32_t kSlotCount = kMaxOrders * 2;
+    static const uint32_t kNone = 0xFFFFFFFF;
+
+    struct Node {
+        OrderRecord record;
+        // filled_amount is the larger of what the last order update reported
+        // and what the trades seen so far add up to, whichever arrived first.
+        double reported_filled{0.0};
+        double traded{0.0};
+        double traded_notional{0.0};
+        uint32_t prev{kNone};       // Open list of its instrument, or the
+        uint32_t next{kNone};       // finished FIFO once it is closed
+    };
+
+    static uint32_t hash(StrRef order_id);
+    // Slot holding the order, or the empty slot it would go in.
+    uint32_t find_slot(StrRef order_id) const;
+    uint32_t lookup(StrRef order_id) const;
+    uint32_t allocate(StrRef order_id);
+    void erase_slot(uint32_t slot);
+
+    // Moves a node on or off the open list of its instrument and the
+    // finished FIFO according to its state.
+    void place(uint32_t index);
+    void remove(uint32_t index);
+    void link(uint32_t& head, uint32_t& tail, uint32_t index);
+    void unlink(uint32_t& head, uint32_t& tail, uint32_t index);
+    void update_fill(Node& node);
+
+    mutable std::mutex mutex_;
+    std::unique_ptr<Node[]> nodes_;
+    std::unique_ptr<uint32_t[]> slots_;         // Node index + 1, 0 = empty
+    std::vector<uint32_t> free_;
+    // Per instrument open lists. Tails are kept only so unlink stays O(1).
+    std::unique_ptr<uint32_t[]> open_head_;
+    std::unique_ptr<uint32_t[]> open_tail_;
+    uint32_t finished_head_{kNone};             // Oldest finished order
+    uint32_t finished_tail_{kNone};
+    size_t open_count_{0};
+    size_t tracked_{0};
+    uint64_t recycled_{0};
+
+    std::unique_ptr<FillRecord[]> fills_;
+    uint64_t fill_total_{0};
+};
+
+OrderManager& getOrderManager();
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef RATE_LIMITER_HPP
+#define RATE_LIMITER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Deribit keeps one credit budget for matching-engine requests (orders,
+// edits, cancels) and one for everything else.
+enum class RequestClass : uint8_t { MATCHING, NON_MATCHING, CLASS_COUNT };
+
+const char* request_class_name(RequestClass request_class);
+
+// A request costs `cost` credits; the balance refills at refill_per_second
+// up to max_credits. Same units as Deribit's documentation.
+struct CreditPolicy {
+    int64_t cost;
+    int64_t max_credits;
+    int64_t refill_per_second;
+};
+
+struct CreditStats {
+    int64_t available;
+    int64_t max_credits;
+    uint64_t sent;
+    uint64_t queued;
+    uint64_t shed;
+    uint64_t exchange_rejects;
+};
+
+// Token bucket kept as a single "theoretical arrival time" (GCRA): the
+// moment the bucket would be full again. Acquiring pushes it forward by the
+// cost; a request fits while it stays within max_credits of now. One atomic,
+// so every thread shares the budget without a lock.
+class CreditBucket {
+public:
+    void configure(const CreditPolicy& policy);
+    const CreditPolicy& policy() const { return policy_; }
+
+    bool try_acquire();
+    // Nanoseconds until one request fits; 0 if it fits now.
+    uint64_t wait_ns() const;
+    int64_t available() const;
+    // The exchange said we are out: assume an empty bucket.
+    void drain();
+
+private:
+    static int64_t now_ns();
+
+    CreditPolicy policy_{0, 0, 0};
+    int64_t cost_ns_{0};        // Time one request's credits take to refill
+    int64_t capacity_ns_{0};    // Time a full bucket takes to refill
+    std::atomic<int64_t> full_at_ns_{0};
+};
+
+// Local mirror of the account's Deribit credit budget, shared by the
+// WebSocket and REST paths. Starts from Deribit's default limits; override
+// with DERIBIT_CREDITS_MATCHING and DERIBIT_CREDITS_NON_MATCHING, each
+// "<max_credits>:<refill_per_second>:<cost>".
+class RateLimiter {
+public:
+    RateLimiter();
+
+    void configure(RequestClass request_class, const CreditPolicy& policy);
+    // Throws std::invalid_argument on a malformed variable.
+    void configure_from_env();
+
+    bool try_acquire(RequestClass request_class);
+    uint64_t wait_ns(RequestClass request_class) const;
+    // Waits for credit, but no longer than max_wait. False when it would
+    // have to wait longer; the request should then be shed.
+    bool acquire(RequestClass request_class, std::chrono::nanoseconds max_wait);
+
+    void on_queued(RequestClass request_class);
+    void on_shed(RequestClass request_class);
+    // Deribit answered too_many_requests (10028).
+    void on_exchange_reject(RequestClass request_class);
+
+    CreditStats stats(RequestClass request_class) const;
+
+private:
+    struct Counters {
+        std::atomic<uint64_t> sent{0};
+        std::atomic<uint64_t> queued{0};
+        std::atomic<uint64_t> shed{0};
+        std::atomic<uint64_t> exchange_rejects{0};
+    };
+
+    static size_t index(RequestClass request_class) { return static_cast<size_t>(request_class); }
+
+    CreditBucket buckets_[static_cast<size_t>(RequestClass::CLASS_COUNT)];
+    Counters counters_[static_cast<size_t>(RequestClass::CLASS_COUNT)];
+};
+
+RateLimiter& getRateLimiter();
+
+#endif
@@ -18,4 +18,12 @@ std::string get_order_book(const std::string& instrument, int depth = 10);
 
 std::string get_positions(const std::string& access_token, const std::string& currency);
 
+// Endpoint URLs, shared by the blocking functions above and AsyncRestClient.
+std::string place_order_url(const std::string& instrument, double amount, const std::string& side,
+                            const std::string& order_type, double price = 0.0);
+std::string cancel_order_url(const std::string& order_id);
+std::string modify_order_url(const std::string& order_id, double new_amount, double new_price);
+std::string order_book_url(const std::string& instrument, int depth = 10);
+std::string positions_url(const std::string& currency);
+
 #endif
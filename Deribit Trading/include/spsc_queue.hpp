@@ -0,0 +1,124 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <utility>
+#include <vector>
+
+#define CACHE_LINE_SIZE 64
+
+// Base for classes with alignas(CACHE_LINE_SIZE) members. Before C++17 a
+// plain new only guarantees alignof(std::max_align_t), which would leave the
+// padded members sharing lines after all; these are placed on a line boundary.
+struct CacheAligned {
+    static void* operator new(size_t size) {
+        void* memory = nullptr;
+        if (posix_memalign(&memory, CACHE_LINE_SIZE, size) != 0) throw std::bad_alloc();
+        return memory;
+    }
+    static void operator delete(void* memory) { std::free(memory); }
+};
+
+// Bounded single-producer/single-consumer ring. Head and tail live on their own
+// cache lines and each side keeps a cached copy of the other's index, so the
+// shared lines are only touched when the cached view says the ring looks
+// full (producer) or empty (consumer).
+template <typename T>
+class SpscQueue : public CacheAligned {
+public:
+    // capacity is rounded up to a power of two.
+    explicit SpscQueue(size_t capacity)
+        : mask_(round_up(capacity) - 1), slots_(mask_ + 1) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer only. Counts a drop and leaves item untouched when the ring is full.
+    bool try_push(T&& item) {
+        T* slot = try_claim();
+        if (!slot) return false;
+        *slot = std::move(item);
+        commit();
+        return true;
+    }
+
+    // Producer only. Returns the next free slot to be filled in place, or nullptr
+    // (counting a drop) when the ring is full. Must be followed by commit().
+    T* try_claim() {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ > mask_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ > mask_) {
+                drops_.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+        }
+        return &slots_[tail & mask_];
+    }
+
+    void commit() {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumer only.
+    bool try_pop(T& item) {
+        T* slot = front();
+        if (!slot) return false;
+        item = std::move(*slot);
+        pop();
+        return true;
+    }
+
+    // Consumer only. Oldest element, read in place, or nullptr when empty.
+    T* front() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_) return nullptr;
+            // The backlog is sampled whenever the consumer refreshes its view of
+            // the tail, which keeps the producer's side free of the extra load.
+            size_t backlog = cached_tail_ - head;
+            if (backlog > high_water_mark_.load(std::memory_order_relaxed)) {
+                high_water_mark_.store(backlog, std::memory_order_relaxed);
+            }
+        }
+        return &slots_[head & mask_];
+    }
+
+    void pop() {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Approximate when read from a third thread.
+    size_t depth() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+    bool empty() const { return depth() == 0; }
+    size_t capacity() const { return mask_ + 1; }
+    uint64_t drops() const { return drops_.load(std::memory_order_relaxed); }
+    size_t high_water_mark() const { return high_water_mark_.load(std::memory_order_relaxed); }
+
+private:
+    static size_t round_up(size_t n) {
+        size_t p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    const size_t mask_;
+    std::vector<T> slots_;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> head_{0};
+    size_t cached_tail_{0};
+    std::atomic<size_t> high_water_mark_{0};
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail_{0};
+    size_t cached_head_{0};
+    std::atomic<uint64_t> drops_{0};
+};
+
+#endif
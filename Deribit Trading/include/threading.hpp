@@ -0,0 +1,79 @@
+#ifndef THREADING_HPP
+#define THREADING_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+// The gateway's long-lived threads. Each event-loop role runs its own
+// io_context: one per Deribit connection, and the downstream server's.
+enum class ThreadRole : uint8_t {
+    DERIBIT_INGRESS,    // Deribit market data connections: parse, book update, publish
+    ORDER_EGRESS,       // Deribit order connection
+    FANOUT,             // Drains the SPSC queue to downstream subscribers
+    SERVER_IO,          // Downstream WebSocket server
+    ROLE_COUNT
+};
+
+// Also the thread name shown by top -H and gdb.
+const char* thread_role_name(ThreadRole role);
+
+struct ThreadSettings {
+    int cpu{-1};            // Core to pin to; -1 leaves placement to the scheduler
+    int rt_priority{0};     // SCHED_FIFO priority 1-99; 0 keeps the default policy
+    bool busy_poll{false};  // Spin on poll() instead of sleeping in run()
+};
+
+// Per-role placement and scheduling. Load before starting any thread.
+class ThreadingConfig {
+public:
+    // key = value lines, '#' comments, keys "<role>.cpu", "<role>.rt_priority"
+    // and "<role>.busy_poll" with role as thread_role_name(). Throws on a bad line.
+    void load(const std::string& path);
+    void set(ThreadRole role, const ThreadSettings& settings);
+    const ThreadSettings& settings(ThreadRole role) const { return settings_[static_cast<size_t>(role)]; }
+    bool busy_poll(ThreadRole role) const { return settings(role).busy_poll; }
+
+    // Names the calling thread after its role and applies the pinning and
+    // scheduling policy. Failures (no CAP_SYS_NICE, a CPU outside the cgroup,
+    // a non-Linux host) are logged and the thread carries on unpinned.
+    // Several threads may share a role; instance n is pinned to cpu + n.
+    void apply(ThreadRole role, size_t instance = 0) const;
+    // A thread that applies the role's settings before running body.
+    std::thread spawn(ThreadRole role, std::function<void()> body, size_t instance = 0) const;
+
+private:
+    ThreadSettings settings_[static_cast<size_t>(ThreadRole::ROLE_COUNT)];
+};
+
+ThreadingConfig& getThreadingConfig();
+
+// Spin-wait hint: frees the core's pipeline for a hyperthread sibling and
+// avoids the memory-order flush when the awaited data arrives.
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Runs an event loop (a websocketpp endpoint or an asio::io_context) on the
+// calling thread until it runs out of work or is stopped. In busy-poll mode
+// the thread never blocks in the kernel, so a frame is handled as soon as the
+// socket is readable instead of after an epoll wakeup.
+template <typename EventLoop>
+void run_event_loop(EventLoop& loop, ThreadRole role) {
+    if (!getThreadingConfig().busy_poll(role)) {
+        loop.run();
+        return;
+    }
+    while (!loop.stopped()) {
+        if (loop.poll() == 0) {
+            cpu_relax();
+        }
+    }
+}
+
+#endif
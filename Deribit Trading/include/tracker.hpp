@@ -1,15 +1,63 @@
 #ifndef LATENCY_TRACKER_H
 #define LATENCY_TRACKER_H
 
+#include <atomic>
 #include <chrono>
-#include <map>
-#include <vector>
+#include <cstdint>
+#include <memory>
 #include <mutex>
 #include <string>
-#include <sstream>
-#include <algorithm>
-#include <numeric>
-#include <iomanip>
+#include <unordered_map>
+#include <vector>
+
+// Timestamps for latency measurement. Uses the invariant TSC when built with
+// -DLATENCY_TRACKER_USE_TSC on x86 and the CPU advertises one, otherwise
+// steady_clock. Tick values are only meaningful to to_nanoseconds().
+class LatencyClock {
+public:
+    static uint64_t now();
+    static uint64_t to_nanoseconds(uint64_t ticks);
+    static bool using_tsc();
+};
+
+// Log-linear histogram in the style of HdrHistogram. Values below 256ns are
+// exact; above that every power-of-two range is split into 128 linear
+// sub-buckets, so any recorded value is off by at most 1/128 (~0.8%). Memory
+// is fixed at construction no matter how many values are recorded.
+class LatencyHistogram {
+public:
+    static const int kSubBucketBits = 8;
+    static const uint64_t kSubBucketCount = 1ULL << kSubBucketBits;
+    static const uint64_t kSubBucketHalf = kSubBucketCount / 2;
+    static const int kMaxValueBits = 40;   // ~18 minutes in nanoseconds
+    static const size_t kBucketCount = kSubBucketCount + (kMaxValueBits - kSubBucketBits) * kSubBucketHalf;
+
+    LatencyHistogram();
+    LatencyHistogram(const LatencyHistogram& other);
+    LatencyHistogram& operator=(const LatencyHistogram& other);
+
+    // Wait-free, but only one thread may record into a given histogram.
+    void record(uint64_t nanoseconds);
+    void merge(const LatencyHistogram& other);
+    void reset();
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t min() const;
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+    double mean() const;
+    // Highest value equivalent to the bucket holding the given percentile (0-100].
+    uint64_t value_at_percentile(double percentile) const;
+
+private:
+    static size_t index_of(uint64_t value);
+    static uint64_t highest_equivalent(size_t index);
+
+    std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> min_;
+    std::atomic<uint64_t> max_;
+};
 
 class LatencyTracker {
 public:
@@ -17,28 +65,57 @@ public:
         ORDER_PLACEMENT,
         MARKET_DATA_PROCESSING,
         WEBSOCKET_MESSAGE_PROPAGATION,
-        TRADING_LOOP_END_TO_END
+        TRADING_LOOP_END_TO_END,
+        ORDER_CANCEL,
+        ORDER_MODIFY,
+        PRE_TRADE_RISK,
+        LATENCY_TYPE_COUNT
     };
 
-    struct LatencyMetric {
-        std::chrono::high_resolution_clock::time_point start_time;
-        std::chrono::high_resolution_clock::time_point end_time;
-        std::chrono::nanoseconds duration{0};
-        bool completed{false};
-    };
+    // Hot-path API: take a timestamp with LatencyClock::now() and record the
+    // elapsed time later. Each thread records into its own histograms, so this
+    // never locks or allocates after the thread's first call.
+    void record(LatencyType type, uint64_t nanoseconds);
+    void record_since(LatencyType type, uint64_t start_ticks);
 
+    // Unkeyed start/stop pairs up per thread and type. Keyed measurements can
+    // start and stop on different threads but go through a mutex-protected
+    // map, so keep them off hot paths.
     void start_measurement(LatencyType type, const std::string& unique_id = "");
     void stop_measurement(LatencyType type, const std::string& unique_id = "");
+
+    // Merged view across every recording thread.
+    LatencyHistogram snapshot(LatencyType type);
     std::string generate_report();
-    std::map<LatencyType, std::vector<LatencyMetric>> get_raw_metrics();
     void reset();
 
 private:
-    std::mutex metrics_mutex;
-    std::map<LatencyType, std::vector<LatencyMetric>> latency_metrics;
-    std::map<std::string, LatencyMetric> active_measurements;
+    struct ThreadRecorder {
+        LatencyHistogram histograms[LATENCY_TYPE_COUNT];
+        uint64_t pending_start[LATENCY_TYPE_COUNT] = {};
+    };
+
+    ThreadRecorder& thread_recorder();
+
+    std::mutex recorders_mutex_;
+    std::vector<std::unique_ptr<ThreadRecorder>> recorders_;
+
+    std::mutex keyed_mutex_;
+    std::unordered_map<std::string, uint64_t> keyed_starts_;
 };
 
 LatencyTracker& getLatencyTracker();
 
+// Records the lifetime of the scope.
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyTracker::LatencyType type)
+        : type_(type), start_(LatencyClock::now()) {}
+    ~ScopedLatency() { getLatencyTracker().record_since(type_, start_); }
+
+private:
+    LatencyTracker::LatencyType type_;
+    uint64_t start_;
+};
+
 #endif // LATENCY_TRACKER_H
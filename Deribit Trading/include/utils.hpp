@@ -1,6 +1,7 @@
 #ifndef UTILS_HPP
 #define UTILS_HPP
 
+#include <functional>
 #include <string>
 
 std::string http_get(const std::string& url);
@@ -8,4 +9,14 @@ std::string http_get(const std::string& url);
 std::string http_post(const std::string& url, const std::string& post_fields, const std::string& auth_token = "");
 
 std::string http_get_with_auth(const std::string& url, const std::string& auth_token);
+
+// Without leading and trailing spaces, tabs and carriage returns.
+std::string trim(const std::string& text);
+
+// Reads a key = value file: '#' starts a comment, blank lines are skipped and
+// key and value are trimmed. entry gets each pair and "<path>:<line>: " to
+// prefix its errors with. what names the file in the error thrown when it
+// cannot be opened; a line without '=' throws too.
+typedef std::function<void(const std::string& key, const std::string& value, const std::string& where)> ConfigEntry;
+void read_config_file(const std::string& path, const std::string& what, const ConfigEntry& entry);
 #endif
\ No newline at end of file
@@ -7,39 +7,280 @@
 #include <websocketpp/config/asio_client.hpp>
 #include <websocketpp/client.hpp>
 #include <asio.hpp>
-#include <queue>
+#include <deque>
 #include <mutex>
-#include <condition_variable>
 #include <thread>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "notification_parser.hpp"
+#include "journal.hpp"
+#include "order_encoder.hpp"
+#include "rate_limiter.hpp"
+#include "threading.hpp"
+
+enum class RequestKind : uint8_t {
+    OTHER,
+    SUBSCRIBE,
+    BUY,
+    SELL,
+    CANCEL,
+    EDIT,
+    GET_POSITIONS,
+    GET_ORDER_BOOK,
+    AUTH,
+    BOOK_SNAPSHOT,      // Internal resync after a gap in a book channel
+    SEED_POSITIONS,     // Internal: account state for the risk gate on connect
+    SEED_OPEN_ORDERS
+};
+
+struct MarketEvent;
+
+// Deribit book channel per instrument, book.<instrument>.<interval>: "raw"
+// carries every change as it happens and needs an authenticated session,
+// "100ms" and "agg2" batch. Configure before connecting.
+class BookChannelConfig {
+public:
+    // Comma-separated: a bare interval sets the default, <instrument>=<interval>
+    // overrides one instrument. Throws on an unknown interval.
+    void configure(const std::string& spec);
+    const std::string& interval(const std::string& instrument) const;
+    std::string channel(const std::string& instrument) const { return "book." + instrument + "." + interval(instrument); }
+
+private:
+    std::string default_interval_{"100ms"};
+    std::unordered_map<std::string, std::string> intervals_;
+};
+
+BookChannelConfig& getBookChannelConfig();
 
 class WebSocketClient {
 public:
-    WebSocketClient();
+    // role picks the thread settings connect() runs the event loop under.
+    explicit WebSocketClient(ThreadRole role = ThreadRole::DERIBIT_INGRESS);
     ~WebSocketClient();
-    std::string access_token_;
 
+    // Fan-out queue this connection publishes on (WebSocketServer::add_producer).
+    void set_producer(size_t producer) { producer_ = producer; }
+    // Whether the connection subscribes to user.orders and user.trades once
+    // authenticated; market data connections only need the session for raw books.
+    void set_user_streams(bool enabled) { user_streams_ = enabled; }
+
+    // The connection authenticates itself with public/auth as soon as it
+    // opens, without blocking anything, and renews with the refresh token
+    // before the access token expires. Private requests carry no token, and
+    // any sent before the first authentication wait for it, as they do again
+    // after the connection closes or fails or the token runs out. Call
+    // before connect().
+    void set_credentials(const std::string& client_id, const std::string& client_secret);
+    bool authenticated() const { return authenticated_.load(std::memory_order_acquire); }
+
+    // Blocks running the connection's event loop until stop().
     void connect(const std::string& uri);
+    void stop();
     void send(const std::string& message);
+    void send(const char* data, size_t size);
     void subscribe_orderbook(const std::string& instrument);
     void unsubscribe_orderbook(const std::string& instrument);
-    std::string receive();  // Blocking call, clearly waits for new messages
-    void place_order(const std::string& instrument, double amount, const std::string& direction,
-                     const std::string& order_type, double price = 0.0);
-    void cancel_order(const std::string& order_id);
-    void modify_order(const std::string& order_id, double new_amount, double new_price);
-    void get_positions();
-    void get_order_book(const std::string& instrument, int depth = 10);
-    void authenticate(const std::string& client_id, const std::string& client_secret);
+    void resubscribe_orderbook(const std::string& instrument);
+    // Book channels resynced from a snapshot after a change_id gap.
+    uint64_t book_resyncs() const { return book_resyncs_.load(std::memory_order_relaxed); }
+    // For frames fed through on_frame with no connection behind them, as in a
+    // journal replay: a change_id gap is counted in book_gaps() and the delta
+    // applied over it, instead of resyncing with requests nobody answers.
+    void set_offline(bool offline) { offline_ = offline; }
+    uint64_t book_gaps() const { return book_gaps_.load(std::memory_order_relaxed); }
+    // user.orders and user.trades for every instrument, feeding getOrderManager().
+    // Sent once the session is authenticated.
+    void subscribe_user_streams();
+    // Request methods return the JSON-RPC id they were sent with. origin is the
+    // downstream session the response should be routed back to (0 = none).
+    uint64_t place_order(const std::string& instrument, double amount, const std::string& direction,
+                         const std::string& order_type, double price = 0.0, uint32_t origin = 0);
+    uint64_t place_order(const std::string& instrument, double amount, OrderSide side, OrderType type,
+                         double price = 0.0, uint32_t origin = 0);
+    uint64_t cancel_order(const std::string& order_id, uint32_t origin = 0);
+    uint64_t modify_order(const std::string& order_id, double new_amount, double new_price, uint32_t origin = 0);
+    // Fixed-point entry points. The double overloads above convert through
+    // getInstrumentCache() when the instrument is known, so prices are on the
+    // tick grid before anything is sent.
+    uint64_t place_order(const InstrumentSpec& instrument, OrderSide side, OrderType type, Qty amount,
+                         Price price = Price(), uint32_t origin = 0);
+    uint64_t modify_order(const std::string& order_id, const InstrumentSpec& instrument, Qty new_amount,
+                          Price new_price, uint32_t origin = 0);
+    uint64_t get_positions(uint32_t origin = 0);
+    uint64_t get_order_book(const std::string& instrument, int depth = 10, uint32_t origin = 0);
+
+    // Reference nlohmann builds of the request bodies. The methods above encode
+    // through a per-thread OrderEncoder and only use these as a fallback.
+    static std::string build_place_order(uint64_t id, const std::string& instrument, double amount,
+                                         const std::string& direction, const std::string& order_type, double price);
+    static std::string build_cancel_order(uint64_t id, const std::string& order_id);
+    static std::string build_modify_order(uint64_t id, const std::string& order_id, double new_amount,
+                                          double new_price);
+
+    // Entry point for every inbound frame, live or replayed from a journal.
+    // received_at is a LatencyClock timestamp; payload may be moved from.
+    void on_frame(std::string& payload, uint64_t received_at);
+
+    // Appends every raw inbound frame to <prefix>.NNNNNN.jrnl segments until stopped.
+    // Call before connect(); the journal is written from the IO thread.
+    void start_capture(const std::string& prefix, size_t segment_bytes = 256 << 20);
+    void stop_capture();
+
+    // Responses matched to a request sent by this client.
+    uint64_t completed_requests() const { return completed_requests_.load(std::memory_order_relaxed); }
+    // True until the response to the request with this id has arrived (or it
+    // was shed), given an id returned by one of the request methods below.
+    bool request_pending(uint64_t id) const {
+        return pending_[id % kPendingSlots].id.load(std::memory_order_acquire) == id;
+    }
+    // Requests waiting for Deribit credits, all priorities.
+    size_t scheduled_requests() const;
+    // Responses for downstream sessions that found the fan-out queue full and
+    // were held for a retry instead of being dropped.
+    uint64_t delayed_responses() const { return delayed_responses_.load(std::memory_order_relaxed); }
 
 private:
     typedef websocketpp::client<websocketpp::config::asio_tls_client> client;
     client ws_client;
     websocketpp::connection_hdl hdl_;
+    ThreadRole role_;
+    size_t producer_{0};
+    bool user_streams_{true};
+
+    // Session authentication. Credentials are set before connect; the tokens
+    // belong to the IO thread, which sends every auth request and handles
+    // every response. The access token itself is never needed again.
+    static const long kAuthRetryMs = 500;
+    static const long kMaxAuthRetryMs = 30000;
+    std::string client_id_;
+    std::string client_secret_;
+    std::string refresh_token_;
+    uint32_t auth_failures_{0};
+    // Auth timers from an earlier connection, and the expiry timer of a
+    // token since renewed, find these moved on and do nothing.
+    uint64_t connection_epoch_{0};
+    uint64_t token_serial_{0};
+    std::atomic<bool> authenticated_{false};
+    // Raw book channels asked for before the session was authenticated.
+    std::mutex auth_mutex_;
+    std::vector<std::string> deferred_books_;
+
+    // With the refresh token when there is one, the credentials otherwise.
+    void send_auth();
+    void schedule_auth(long delay_ms);
+    void on_auth_response(const std::string& payload);
+    // Connection lost or token expired: private requests wait again.
+    void clear_session(const char* reason);
+
+    // The order session loads the account's positions and open orders into
+    // the risk gate and the OMS once authenticated; the user streams keep
+    // them current from there. IO thread only.
+    static const long kSeedRetryMs = 1000;
+    bool positions_seeded_{false};
+    bool orders_seeded_{false};
+    void request_exposure(RequestKind kind);
+    void on_exposure(RequestKind kind, const std::string& payload);
+
+    // In-flight requests, indexed by id modulo the table size. A sender fills the
+    // slot before the request goes out and publishes it by storing the id; the
+    // IO thread claims it when the response arrives. Ids are never reused, so a
+    // slot that has wrapped simply fails to match.
+    struct PendingRequest {
+        std::atomic<uint64_t> id{0};
+        std::atomic<uint8_t> kind{0};
+        std::atomic<uint32_t> origin{0};
+        std::atomic<uint64_t> sent_at{0};
+    };
+    static const size_t kPendingSlots = 4096;
+    std::unique_ptr<PendingRequest[]> pending_;
+    std::atomic<uint64_t> next_request_id_{1};
+    std::atomic<uint64_t> completed_requests_{0};
+
+    uint64_t begin_request(RequestKind kind, uint32_t origin);
+    // throttled: Deribit answered too_many_requests.
+    void complete_request(uint64_t id, std::string& payload, bool throttled = false);
+
+    // Responses routed to a downstream session must not be lost to a full
+    // fan-out ring. Once one is held, later ones queue behind it so a
+    // session still sees them in order; a timer retries until the backlog
+    // is gone.
+    static const long kBacklogRetryMs = 1;
+    struct HeldResponse {
+        uint32_t target;
+        bool order_response;
+        std::string payload;
+    };
+    std::mutex backlog_mutex_;
+    std::deque<HeldResponse> private_backlog_;
+    std::atomic<bool> backlogged_{false};
+    std::atomic<uint64_t> delayed_responses_{0};
+    void publish_private(MarketEvent&& event);
+    void flush_private_backlog();
+
+    // Outbound scheduling against getRateLimiter(). A request goes straight
+    // out when its class has credit and nothing of equal or higher priority is
+    // waiting; otherwise it queues and a timer drains the queues in priority
+    // order as credit refills. Queries are shed (answered locally with
+    // too_many_requests) rather than queued indefinitely. Private requests on
+    // a connection with credentials also wait in the queues until the session
+    // is authenticated, and go out first thing afterwards.
+    enum Priority { PRIORITY_CANCEL, PRIORITY_ORDER, PRIORITY_CONTROL, PRIORITY_QUERY, PRIORITY_COUNT };
+    struct QueuedRequest {
+        uint64_t id;
+        RequestKind kind;
+        uint64_t queued_at;
+        std::string payload;
+    };
+    static const size_t kMaxQueuedQueries = 256;
+    static const uint64_t kMaxQueryWaitMs = 1000;
+
+    static Priority priority_of(RequestKind kind);
+    // False for a private request while the session is not yet authenticated.
+    bool session_ready(RequestKind kind) const;
+    static RequestClass class_of(Priority priority) {
+        return priority <= PRIORITY_ORDER ? RequestClass::MATCHING : RequestClass::NON_MATCHING;
+    }
+    void dispatch(uint64_t id, RequestKind kind, const char* data, size_t size);
+    void dispatch(uint64_t id, RequestKind kind, const std::string& message);
+    void drain_scheduled();
+    void shed(uint64_t id, RequestKind kind);
+
+    mutable std::mutex schedule_mutex_;
+    std::deque<QueuedRequest> scheduled_[PRIORITY_COUNT];
+    std::atomic<uint32_t> scheduled_count_[PRIORITY_COUNT];
+    bool drain_pending_{false};
+
+    std::unique_ptr<JournalWriter> journal_;
 
-    std::queue<std::string> messages_;
-    std::mutex msg_mutex_;
-    std::condition_variable msg_cond_;
+    // Gap recovery, IO thread only. An instrument is listed from the moment a
+    // change_id gap shows until a delta has chained onto the new snapshot.
+    // Deltas arriving meanwhile are kept and replayed on top of the snapshot,
+    // so downstream sees the snapshot followed by every later change.
+    struct BookResync {
+        uint64_t request{0};  // Snapshot request in flight; 0 once the snapshot is in
+        std::deque<std::pair<uint64_t, std::string>> buffered;  // received_at, frame
+    };
+    static const uint64_t kAwaitingSubscription = ~0ULL;  // Resubscribed instead
+    static const size_t kMaxBufferedDeltas = 4096;
+    static const int kResyncDepth = 10000;
+    std::unordered_map<uint32_t, BookResync> resync_;
+    std::atomic<uint64_t> book_resyncs_{0};
+    bool offline_{false};
+    std::atomic<uint64_t> book_gaps_{0};
 
+    uint64_t request_order_book(const std::string& instrument, int depth, RequestKind kind, uint32_t origin);
+    // False when the update must not go downstream: buffered, stale, or the
+    // book is waiting for a snapshot. May take payload.
+    bool apply_book_update(uint32_t instrument, const BookNotification& update, std::string& payload,
+                           uint64_t received_at);
+    void start_resync(uint32_t instrument, std::string& payload, uint64_t received_at);
+    void on_book_snapshot(uint64_t id, const std::string& payload);
+    void replay_buffered(uint32_t instrument);
     void on_open(websocketpp::connection_hdl hdl);
     void on_message(websocketpp::connection_hdl hdl, client::message_ptr msg);
     websocketpp::lib::shared_ptr<asio::ssl::context> on_tls_init();
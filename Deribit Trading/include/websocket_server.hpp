@@ -7,28 +7,239 @@
 #include <websocketpp/config/asio_no_tls.hpp>
 #include <websocketpp/server.hpp>
 #include <asio.hpp>
-#include <set>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "book_view.hpp"
+#include "instruments.hpp"
+#include "order_manager.hpp"
+#include "spsc_queue.hpp"
 
 typedef websocketpp::server<websocketpp::config::asio> server;
 typedef websocketpp::connection_hdl connection_hdl;
 
+// Preparsed unit of work handed from the Deribit IO thread to the fan-out thread.
+struct MarketEvent {
+    enum Kind { BOOK, TICKER, TRADES, OTHER, PRIVATE };
+    Kind kind{OTHER};
+    uint32_t instrument{InstrumentRegistry::kInvalidId};
+    uint32_t target{0};       // Downstream session a PRIVATE response goes to
+    bool order_response{false};  // PRIVATE answer to an order, cancel or edit
+    int64_t timestamp{0};
+    int64_t change_id{0};
+    uint64_t received_at{0};  // LatencyClock ticks when the frame arrived
+    std::string payload;
+};
+
+struct FanoutStats {
+    size_t depth;
+    size_t capacity;
+    uint64_t drops;
+    size_t high_water_mark;
+};
+
+// Thresholds on the bytes waiting in a downstream connection's send queue.
+// 0 disables a step.
+struct BackpressureLimits {
+    size_t conflate_above{1 << 20};     // Switch the client to latest-value delivery
+    size_t resume_below{256 << 10};     // Back to every update once drained this far
+    size_t disconnect_above{32 << 20};  // Close the connection as a lost cause
+};
+
 class WebSocketServer {
 public:
+    WebSocketServer();
+    ~WebSocketServer();
+
     void run(uint16_t port);
-    void broadcast(const std::string& instrument, const std::string& message);
+    // Stops the accept loop and every connection; run() then returns.
+    void stop();
+    // Starts the fan-out thread without a listening socket (run() does this too).
+    // In busy-poll mode (ThreadRole::FANOUT) it spins instead of sleeping.
+    void start_fanout();
+    // Fan-out thread only, or a single caller while it is not running.
+    void broadcast(const std::string& instrument, std::string message);
+    // Call before run().
+    void set_backpressure(const BackpressureLimits& limits) { backpressure_ = limits; }
+    // Shared secret a connection presents with the authorize action to become
+    // an operator session, the only kind allowed the kill switch. Empty (the
+    // default) leaves no way to become one. Call before run().
+    void set_operator_secret(const std::string& secret) { operator_secret_ = secret; }
+
+    // Every Deribit connection publishes on its own SPSC queue. Producer 0
+    // always exists; add one per extra connection before the fan-out thread
+    // starts.
+    size_t add_producer();
+    // From the producer's IO thread only. Never blocks: the event is dropped
+    // (and counted) if the fan-out thread has fallen a full ring behind.
+    bool publish(MarketEvent&& event, size_t producer = 0);
+    // Summed over producers; high_water_mark is the worst single queue.
+    FanoutStats fanout_stats() const;
 
 private:
+    static const size_t kFanoutQueueCapacity = 8192;
+    static const int kFanoutSpinCount = 2000;
+
+    // Events per fan-out pass between checks on clients that fell behind and
+    // on throttled book views.
+    static const int kCatchUpInterval = 64;
+    static const int64_t kMaxViewDepth = 1000;
+    static const int64_t kMaxViewIntervalMs = 60000;
+    // Names downstream clients may add to the registry when there is no
+    // instrument metadata to check them against.
+    static const uint32_t kMaxClientInstruments = 1024;
+
+    // A BookView and the frames rendered from its last refresh, built once
+    // per format and shared by every subscriber on the view.
+    struct ViewFeed {
+        ViewFeed(uint32_t instrument, size_t depth, uint32_t interval_ms, uint64_t serial)
+            : view(instrument, depth, interval_ms, serial) {}
+
+        BookView view;  // Window fixed at creation; the rest is fan-out thread only
+        server::message_ptr frames[2][2];  // [binary][snapshot]
+        std::chrono::steady_clock::time_point next_due;
+        bool pending{false};  // Changed since the last send, waiting out the interval
+    };
+
+    // One downstream connection. A client whose send queue passes
+    // conflate_above stops getting every update: the fan-out thread keeps only
+    // the newest ticker / trades frame per instrument, and for books a marker
+    // that a fresh snapshot is owed, since book frames are deltas. Once the
+    // queue drains below resume_below the held state goes out and book deltas
+    // the snapshot already covers are skipped.
+    struct Client {
+        struct Held {
+            bool book{false};
+            int64_t snapshot_change_id{0};  // Deltas up to here are in the last snapshot
+            std::shared_ptr<ViewFeed> view; // Owed a snapshot of this view
+            server::message_ptr ticker;
+            server::message_ptr trades;
+            server::message_ptr other;
+        };
+
+        uint32_t session{0};
+        connection_hdl hdl;
+        server::connection_ptr connection;
+
+        // Written by the fan-out thread, read by get_stats.
+        std::atomic<size_t> buffered{0};
+        std::atomic<size_t> max_buffered{0};
+        std::atomic<uint64_t> sent{0};
+        std::atomic<uint64_t> conflated{0};     // Updates superseded before they were sent
+        std::atomic<uint64_t> conflations{0};   // Times the client fell behind
+        std::atomic<uint64_t> behind_since{0};  // LatencyClock ticks; 0 while keeping up
+        std::atomic<bool> closing{false};
+        // Negotiated in subscribe: binary_protocol.hpp frames instead of JSON.
+        std::atomic<bool> binary{false};
+        // Set by authorize; under connection_mutex_.
+        bool operator_session{false};
+
+        // Fan-out thread only.
+        struct ViewSync {
+            uint64_t serial{0};
+            int64_t change_id{0};
+        };
+        bool conflating{false};
+        std::unordered_map<uint32_t, Held> held;
+        // Per instrument, the view and change_id the client last got from it;
+        // anything else than the view's prev_change_id means a snapshot is due.
+        std::unordered_map<uint32_t, ViewSync> view_sync;
+    };
+    // A subscription with a depth or interval reads through a view; without
+    // one the client gets Deribit's book deltas as they arrive.
+    struct Subscriber {
+        std::shared_ptr<Client> client;
+        std::shared_ptr<ViewFeed> view;
+    };
+    typedef std::vector<Subscriber> SubscriberList;
+
     server m_server;
     std::mutex connection_mutex_;
-    // Mapping: instrument -> set of connection handles (clients subscribed to that instrument)
-    std::map<std::string, std::set<connection_hdl, std::owner_less<connection_hdl>>> subscriptions_;
+    // Indexed by InstrumentRegistry id and never resized. Each list is immutable
+    // once published and replaced copy-on-write, so fan-out reads it without
+    // taking connection_mutex_.
+    std::vector<std::shared_ptr<const SubscriberList>> subscribers_;
+    // Every downstream connection gets a session id so RPC responses can be
+    // routed back to the connection that sent the request.
+    std::map<connection_hdl, uint32_t, std::owner_less<connection_hdl>> session_ids_;
+    std::unordered_map<uint32_t, std::shared_ptr<Client>> sessions_;
+    uint32_t next_session_id_{1};
+    uint32_t client_interned_{0};
+    uint64_t next_view_serial_{1};
+
+    BackpressureLimits backpressure_;
+    std::string operator_secret_;
+    // Fan-out thread only: clients currently conflating.
+    std::vector<std::shared_ptr<Client>> behind_;
+    std::atomic<uint64_t> slow_disconnects_{0};
+    // Fan-out thread only: views waiting out their interval, and the views
+    // touched by the event being fanned out.
+    std::vector<std::shared_ptr<ViewFeed>> pending_views_;
+    std::vector<std::shared_ptr<ViewFeed>> touched_views_;
+
+    std::vector<std::unique_ptr<SpscQueue<MarketEvent>>> fanout_queues_;
+    std::thread fanout_thread_;
+    std::atomic<bool> fanout_running_{false};
+    std::atomic<bool> fanout_sleeping_{false};
+    std::mutex fanout_mutex_;
+    std::condition_variable fanout_cond_;
 
     void on_open(connection_hdl hdl);
     void on_close(connection_hdl hdl);
     void on_message(connection_hdl hdl, server::message_ptr msg);
+    std::string render_local_orderbook(const std::string& instrument, int depth);
+    // Under connection_mutex_: the registry id of an instrument named by a
+    // downstream client. Registry ids are never freed, so a name is only
+    // interned if instrument metadata is unavailable, and then only up to
+    // kMaxClientInstruments of them; kInvalidId otherwise.
+    uint32_t client_instrument(const std::string& name);
+    void fanout_loop();
+
+    // Replaces the client's view if it is already subscribed.
+    size_t add_subscriber(uint32_t id, const std::shared_ptr<Client>& client, const std::shared_ptr<ViewFeed>& view);
+    size_t remove_subscriber(uint32_t id, const std::shared_ptr<Client>& client);
+    void broadcast(uint32_t id, std::string message, MarketEvent::Kind kind = MarketEvent::OTHER,
+                   int64_t change_id = 0);
+    // True once the frame is queued on the connection; false if it was held
+    // back, skipped or the send failed.
+    bool deliver(const std::shared_ptr<Client>& client, uint32_t id, MarketEvent::Kind kind, int64_t change_id,
+                 const server::message_ptr& frame, const std::shared_ptr<ViewFeed>& view = nullptr);
+    void hold(Client& client, uint32_t id, MarketEvent::Kind kind, const server::message_ptr& frame,
+              const std::shared_ptr<ViewFeed>& view);
+    // Under connection_mutex_: the instrument's view with this window, shared
+    // with other subscribers when one exists.
+    std::shared_ptr<ViewFeed> find_view(uint32_t id, size_t depth, uint32_t interval_ms);
+    // Sends the view's changes now, or once its interval has passed.
+    void schedule_view(const std::shared_ptr<ViewFeed>& feed, const SubscriberList& subscribers);
+    void update_view(const std::shared_ptr<ViewFeed>& feed, const SubscriberList& subscribers,
+                     std::chrono::steady_clock::time_point now);
+    void flush_views();
+    const server::message_ptr& view_frame(ViewFeed& feed, bool binary, bool snapshot);
+    // Sends what behind clients were owed once their queues have drained.
+    void catch_up();
+    bool send_held(Client& client);
+    void disconnect_slow(Client& client, size_t buffered);
+    // A book snapshot from the local book, as a Deribit-style notification or
+    // a WIRE_BOOK message; empty while the book is not valid.
+    std::string render_book_snapshot(uint32_t id, bool binary, int64_t& change_id);
+    void send_to_session(uint32_t session, const std::string& message, bool order_response = false);
+    void send_error(connection_hdl hdl, const char* action, const std::string& message);
+    // Tells the client the id its order request went to Deribit with: the
+    // "id" of the JSON response, and WireOrderAck::request_id.
+    void send_accepted(connection_hdl hdl, const char* action, uint64_t request_id);
+    // Runs the pre-trade risk gate; a rejected order is answered here.
+    bool pass_risk(connection_hdl hdl, const char* action, uint32_t session, uint32_t instrument, OrderSide side,
+                   double amount, double price, double replaced = 0.0);
+    bool modify_passes_risk(connection_hdl hdl, uint32_t session, const OrderRecord* order, double new_amount,
+                            double new_price);
+    server::message_ptr make_shared_frame(std::string payload, websocketpp::frame::opcode::value op);
 };
 
 #endif
\ No newline at end of file
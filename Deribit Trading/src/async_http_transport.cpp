@@ -0,0 +1,264 @@
+#include "async_http_transport.hpp"
+#include <stdexcept>
+#include "endpoints.hpp"
+
+namespace {
+
+size_t write_callback(void* contents, size_t size, size_t nmemb, void* userdata) {
+    size_t total_size = size * nmemb;
+    static_cast<std::string*>(userdata)->append(static_cast<char*>(contents), total_size);
+    return total_size;
+}
+
+} // namespace
+
+AsyncHttpTransport::Headers::~Headers() {
+    curl_slist_free_all(get);
+    curl_slist_free_all(post);
+}
+
+AsyncHttpTransport::AsyncHttpTransport(asio::io_context& io, const HttpTransportOptions& options)
+    : io_(io), options_(options), timer_(io) {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    multi_ = curl_multi_init();
+    if (!multi_) throw std::runtime_error("CURL multi init failed");
+
+    curl_multi_setopt(multi_, CURLMOPT_SOCKETFUNCTION, &AsyncHttpTransport::socket_callback);
+    curl_multi_setopt(multi_, CURLMOPT_SOCKETDATA, this);
+    curl_multi_setopt(multi_, CURLMOPT_TIMERFUNCTION, &AsyncHttpTransport::timer_callback);
+    curl_multi_setopt(multi_, CURLMOPT_TIMERDATA, this);
+    // With HTTP/2 every in-flight request shares one connection per host;
+    // over HTTP/1.1 curl opens parallel keep-alive connections instead.
+    curl_multi_setopt(multi_, CURLMOPT_PIPELINING, options_.http2 ? CURLPIPE_MULTIPLEX : CURLPIPE_NOTHING);
+
+    for (size_t i = 0; i < options_.warm_handles; ++i) {
+        idle_easy_.push_back(acquire_easy());
+    }
+}
+
+// The io_context must no longer be running. Outstanding requests are dropped
+// without invoking their callbacks.
+AsyncHttpTransport::~AsyncHttpTransport() {
+    for (auto& pair : active_) {
+        curl_multi_remove_handle(multi_, pair.first);
+        curl_easy_cleanup(pair.first);
+    }
+    for (auto& pair : sockets_) {
+        pair.second->removed = true;
+        pair.second->descriptor.release();
+    }
+    for (CURL* easy : idle_easy_) {
+        curl_easy_cleanup(easy);
+    }
+    curl_multi_cleanup(multi_);
+    curl_global_cleanup();
+}
+
+CURL* AsyncHttpTransport::acquire_easy() {
+    if (!idle_easy_.empty()) {
+        CURL* easy = idle_easy_.back();
+        idle_easy_.pop_back();
+        return easy;
+    }
+    CURL* curl = curl_easy_init();
+    if (!curl) throw std::runtime_error("CURL init failed");
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, options_.dns_cache_timeout_s);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, options_.connect_timeout_ms);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, options_.request_timeout_ms);
+    if (!tls_verify()) {
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    }
+    if (options_.http2) {
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+        curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+    } else {
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+    }
+    return curl;
+}
+
+// Requests in flight keep their own reference, so a token change never frees
+// a list curl is still reading.
+std::shared_ptr<AsyncHttpTransport::Headers> AsyncHttpTransport::headers_for(const std::string& auth_token) {
+    if (headers_ && headers_->auth_token == auth_token) return headers_;
+
+    std::shared_ptr<Headers> headers = std::make_shared<Headers>();
+    headers->auth_token = auth_token;
+    headers->post = curl_slist_append(headers->post, "Content-Type: application/json");
+    headers->post = curl_slist_append(headers->post, "Expect:");
+    headers->get = curl_slist_append(headers->get, "Accept: application/json");
+    if (!auth_token.empty()) {
+        std::string auth_header = "Authorization: Bearer " + auth_token;
+        headers->post = curl_slist_append(headers->post, auth_header.c_str());
+        headers->get = curl_slist_append(headers->get, auth_header.c_str());
+    }
+    headers_ = headers;
+    return headers;
+}
+
+void AsyncHttpTransport::get(std::string url, std::string auth_token, HttpCallback callback) {
+    std::unique_ptr<Request> request(new Request());
+    request->url = std::move(url);
+    request->auth_token = std::move(auth_token);
+    request->callback = std::move(callback);
+    in_flight_.fetch_add(1, std::memory_order_relaxed);
+
+    submit(std::move(request));
+}
+
+void AsyncHttpTransport::post(std::string url, std::string body, std::string auth_token, HttpCallback callback) {
+    std::unique_ptr<Request> request(new Request());
+    request->is_post = true;
+    request->url = std::move(url);
+    request->body = std::move(body);
+    request->auth_token = std::move(auth_token);
+    request->callback = std::move(callback);
+    in_flight_.fetch_add(1, std::memory_order_relaxed);
+
+    submit(std::move(request));
+}
+
+// std::function needs a copyable handler, so the request rides in a
+// shared_ptr until it reaches the io_context thread.
+void AsyncHttpTransport::submit(std::unique_ptr<Request> request) {
+    std::shared_ptr<Request> pending(std::move(request));
+    asio::post(io_, [this, pending] { start(std::unique_ptr<Request>(new Request(std::move(*pending)))); });
+}
+
+void AsyncHttpTransport::start(std::unique_ptr<Request> request) {
+    CURL* easy = acquire_easy();
+    request->easy = easy;
+    request->headers = headers_for(request->auth_token);
+
+    curl_easy_setopt(easy, CURLOPT_URL, request->url.c_str());
+    curl_easy_setopt(easy, CURLOPT_WRITEDATA, &request->response);
+    if (request->is_post) {
+        curl_easy_setopt(easy, CURLOPT_POST, 1L);
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDS, request->body.c_str());
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE, static_cast<long>(request->body.size()));
+        curl_easy_setopt(easy, CURLOPT_HTTPHEADER, request->headers->post);
+    } else {
+        curl_easy_setopt(easy, CURLOPT_HTTPGET, 1L);
+        curl_easy_setopt(easy, CURLOPT_HTTPHEADER, request->headers->get);
+    }
+
+    CURLMcode rc = curl_multi_add_handle(multi_, easy);
+    if (rc != CURLM_OK) {
+        idle_easy_.push_back(easy);
+        in_flight_.fetch_sub(1, std::memory_order_relaxed);
+        HttpResult result;
+        result.code = CURLE_FAILED_INIT;
+        result.error = curl_multi_strerror(rc);
+        request->callback(std::move(result));
+        return;
+    }
+    active_[easy] = std::move(request);
+}
+
+int AsyncHttpTransport::socket_callback(CURL*, curl_socket_t fd, int what, void* self, void*) {
+    AsyncHttpTransport* transport = static_cast<AsyncHttpTransport*>(self);
+    auto it = transport->sockets_.find(fd);
+
+    if (what == CURL_POLL_REMOVE) {
+        if (it != transport->sockets_.end()) {
+            // curl owns and closes the socket; asio must only stop watching it.
+            it->second->removed = true;
+            asio::error_code ignored;
+            it->second->descriptor.cancel(ignored);
+            it->second->descriptor.release();
+            transport->sockets_.erase(it);
+        }
+        return 0;
+    }
+
+    std::shared_ptr<SocketWatch> socket;
+    if (it == transport->sockets_.end()) {
+        socket = std::make_shared<SocketWatch>(transport->io_, fd);
+        transport->sockets_[fd] = socket;
+    } else {
+        socket = it->second;
+    }
+    socket->action = what;
+    transport->watch(socket);
+    return 0;
+}
+
+int AsyncHttpTransport::timer_callback(CURLM*, long timeout_ms, void* self) {
+    AsyncHttpTransport* transport = static_cast<AsyncHttpTransport*>(self);
+    transport->timer_.cancel();
+    if (timeout_ms >= 0) {
+        // curl must not be re-entered from its own callback, so even a zero
+        // timeout goes through the io_context.
+        transport->timer_.expires_after(std::chrono::milliseconds(timeout_ms));
+        transport->timer_.async_wait([transport](const asio::error_code& ec) { transport->on_timeout(ec); });
+    }
+    return 0;
+}
+
+// Keeps at most one read and one write wait outstanding per socket and re-arms
+// after each event for as long as curl still wants that direction.
+void AsyncHttpTransport::watch(const std::shared_ptr<SocketWatch>& socket) {
+    if ((socket->action & CURL_POLL_IN) && !socket->reading) {
+        socket->reading = true;
+        socket->descriptor.async_wait(asio::posix::stream_descriptor::wait_read,
+            [this, socket](const asio::error_code& ec) {
+                socket->reading = false;
+                if (ec || socket->removed) return;
+                on_socket_ready(socket->fd, CURL_CSELECT_IN);
+                if (!socket->removed) watch(socket);
+            });
+    }
+    if ((socket->action & CURL_POLL_OUT) && !socket->writing) {
+        socket->writing = true;
+        socket->descriptor.async_wait(asio::posix::stream_descriptor::wait_write,
+            [this, socket](const asio::error_code& ec) {
+                socket->writing = false;
+                if (ec || socket->removed) return;
+                on_socket_ready(socket->fd, CURL_CSELECT_OUT);
+                if (!socket->removed) watch(socket);
+            });
+    }
+}
+
+void AsyncHttpTransport::on_socket_ready(curl_socket_t fd, int event) {
+    curl_multi_socket_action(multi_, fd, event, &running_);
+    check_completed();
+}
+
+void AsyncHttpTransport::on_timeout(const asio::error_code& ec) {
+    if (ec) return;
+    curl_multi_socket_action(multi_, CURL_SOCKET_TIMEOUT, 0, &running_);
+    check_completed();
+}
+
+void AsyncHttpTransport::check_completed() {
+    int pending;
+    while (CURLMsg* msg = curl_multi_info_read(multi_, &pending)) {
+        if (msg->msg != CURLMSG_DONE) continue;
+        CURL* easy = msg->easy_handle;
+        CURLcode code = msg->data.result;
+        curl_multi_remove_handle(multi_, easy);
+
+        auto it = active_.find(easy);
+        if (it == active_.end()) continue;
+        std::unique_ptr<Request> request = std::move(it->second);
+        active_.erase(it);
+
+        HttpResult result;
+        result.code = code;
+        curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &result.status);
+        if (code != CURLE_OK) {
+            result.error = curl_easy_strerror(code);
+        }
+        result.body = std::move(request->response);
+        idle_easy_.push_back(easy);
+        in_flight_.fetch_sub(1, std::memory_order_relaxed);
+
+        request->callback(std::move(result));
+    }
+}
@@ -0,0 +1,166 @@
+#include "async_rest_client.hpp"
+#include "rest_client.hpp"
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+
+namespace {
+
+// Same waits as the blocking calls, but spent on a timer instead of a thread.
+const std::chrono::seconds kMatchingMaxWait(5);
+const std::chrono::milliseconds kQueryMaxWait(250);
+
+bool throttled(const HttpResult& result) {
+    if (!result.ok()) return false;
+    nlohmann::json j = nlohmann::json::parse(result.body, nullptr, false);
+    return j.is_object() && j.contains("error") && j["error"].is_object() &&
+           j["error"].value("code", 0) == 10028;
+}
+
+} // namespace
+
+AsyncRestClient::AsyncRestClient(const std::string& access_token, const HttpTransportOptions& options)
+    : owned_io_(new asio::io_context()),
+      io_(*owned_io_),
+      work_(new asio::executor_work_guard<asio::io_context::executor_type>(owned_io_->get_executor())),
+      transport_(*owned_io_, options),
+      access_token_(access_token) {
+    loop_thread_ = std::thread([this] { owned_io_->run(); });
+}
+
+AsyncRestClient::AsyncRestClient(asio::io_context& io, const std::string& access_token,
+                                 const HttpTransportOptions& options)
+    : io_(io), transport_(io, options), access_token_(access_token) {}
+
+AsyncRestClient::~AsyncRestClient() {
+    if (owned_io_) {
+        work_.reset();
+        owned_io_->stop();
+        if (loop_thread_.joinable()) {
+            loop_thread_.join();
+        }
+    }
+}
+
+void AsyncRestClient::set_access_token(const std::string& access_token) {
+    std::lock_guard<std::mutex> lock(token_mutex_);
+    access_token_ = access_token;
+}
+
+std::string AsyncRestClient::access_token() {
+    std::lock_guard<std::mutex> lock(token_mutex_);
+    return access_token_;
+}
+
+HttpCallback AsyncRestClient::fulfil(std::shared_ptr<std::promise<std::string>> promise) {
+    return [promise](HttpResult&& result) {
+        if (result.ok()) {
+            promise->set_value(std::move(result.body));
+        } else {
+            promise->set_exception(std::make_exception_ptr(
+                std::runtime_error("CURL error: " + result.error)));
+        }
+    };
+}
+
+void AsyncRestClient::send(RequestClass request_class, std::string url, std::string auth_token,
+                           HttpCallback callback) {
+    std::chrono::nanoseconds max_wait = request_class == RequestClass::MATCHING
+        ? std::chrono::nanoseconds(kMatchingMaxWait) : std::chrono::nanoseconds(kQueryMaxWait);
+    send(request_class, std::chrono::steady_clock::now() + max_wait, false, std::move(url), std::move(auth_token),
+         std::move(callback));
+}
+
+void AsyncRestClient::send(RequestClass request_class, std::chrono::steady_clock::time_point deadline, bool queued,
+                           std::string url, std::string auth_token, HttpCallback callback) {
+    RateLimiter& limiter = getRateLimiter();
+    if (limiter.try_acquire(request_class)) {
+        // Deribit's own too_many_requests means the local budget ran ahead
+        // of the account's; the limiter then assumes an empty bucket.
+        transport_.get(std::move(url), std::move(auth_token), [request_class, callback](HttpResult&& result) {
+            if (throttled(result)) getRateLimiter().on_exchange_reject(request_class);
+            callback(std::move(result));
+        });
+        return;
+    }
+
+    std::chrono::nanoseconds wait(limiter.wait_ns(request_class));
+    if (std::chrono::steady_clock::now() + wait > deadline) {
+        limiter.on_shed(request_class);
+        HttpResult result;
+        result.status = 429;
+        result.body = "{\"jsonrpc\":\"2.0\",\"error\":{\"code\":10028,\"message\":\"too_many_requests\","
+                      "\"data\":{\"reason\":\"shed locally\"}}}";
+        asio::post(io_, [callback, result]() mutable { callback(std::move(result)); });
+        return;
+    }
+    if (!queued) limiter.on_queued(request_class);
+    waiting_.fetch_add(1, std::memory_order_relaxed);
+    auto timer = std::make_shared<asio::steady_timer>(io_, wait);
+    timer->async_wait([this, timer, request_class, deadline, url, auth_token, callback](const asio::error_code& ec) {
+        waiting_.fetch_sub(1, std::memory_order_relaxed);
+        if (ec) return;
+        send(request_class, deadline, true, url, auth_token, callback);
+    });
+}
+
+void AsyncRestClient::place_order(const std::string& instrument, double amount, const std::string& side,
+                                  const std::string& order_type, double price, HttpCallback callback) {
+    send(RequestClass::MATCHING, place_order_url(instrument, amount, side, order_type, price), access_token(),
+         std::move(callback));
+}
+
+void AsyncRestClient::cancel_order(const std::string& order_id, HttpCallback callback) {
+    send(RequestClass::MATCHING, cancel_order_url(order_id), access_token(), std::move(callback));
+}
+
+void AsyncRestClient::modify_order(const std::string& order_id, double new_amount, double new_price,
+                                   HttpCallback callback) {
+    send(RequestClass::MATCHING, modify_order_url(order_id, new_amount, new_price), access_token(),
+         std::move(callback));
+}
+
+void AsyncRestClient::get_order_book(const std::string& instrument, int depth, HttpCallback callback) {
+    send(RequestClass::NON_MATCHING, order_book_url(instrument, depth), "", std::move(callback));
+}
+
+void AsyncRestClient::get_positions(const std::string& currency, HttpCallback callback) {
+    send(RequestClass::NON_MATCHING, positions_url(currency), access_token(), std::move(callback));
+}
+
+std::future<std::string> AsyncRestClient::place_order(const std::string& instrument, double amount,
+                                                      const std::string& side, const std::string& order_type,
+                                                      double price) {
+    auto promise = std::make_shared<std::promise<std::string>>();
+    std::future<std::string> future = promise->get_future();
+    place_order(instrument, amount, side, order_type, price, fulfil(promise));
+    return future;
+}
+
+std::future<std::string> AsyncRestClient::cancel_order(const std::string& order_id) {
+    auto promise = std::make_shared<std::promise<std::string>>();
+    std::future<std::string> future = promise->get_future();
+    cancel_order(order_id, fulfil(promise));
+    return future;
+}
+
+std::future<std::string> AsyncRestClient::modify_order(const std::string& order_id, double new_amount,
+                                                       double new_price) {
+    auto promise = std::make_shared<std::promise<std::string>>();
+    std::future<std::string> future = promise->get_future();
+    modify_order(order_id, new_amount, new_price, fulfil(promise));
+    return future;
+}
+
+std::future<std::string> AsyncRestClient::get_order_book(const std::string& instrument, int depth) {
+    auto promise = std::make_shared<std::promise<std::string>>();
+    std::future<std::string> future = promise->get_future();
+    get_order_book(instrument, depth, fulfil(promise));
+    return future;
+}
+
+std::future<std::string> AsyncRestClient::get_positions(const std::string& currency) {
+    auto promise = std::make_shared<std::promise<std::string>>();
+    std::future<std::string> future = promise->get_future();
+    get_positions(currency, fulfil(promise));
+    return future;
+}
@@ -1,10 +1,11 @@
 #include "auth.hpp"
 #include "utils.hpp"
+#include "endpoints.hpp"
 #include <curl/curl.h>
 #include <nlohmann/json.hpp>
 
 std::string get_access_token(const std::string& client_id, const std::string& client_secret) {
-    std::string url = "https://test.deribit.com/api/v2/public/auth?client_id=" 
+    std::string url = rest_base_url() + "/public/auth?client_id=" 
                     + client_id + "&client_secret=" + client_secret + "&grant_type=client_credentials";
 
     std::string response = http_get(url);
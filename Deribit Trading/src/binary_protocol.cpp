@@ -0,0 +1,226 @@
+#include "binary_protocol.hpp"
+#include "instruments.hpp"
+#include "order_encoder.hpp"
+#include "order_manager.hpp"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+using json = nlohmann::json;
+
+namespace {
+
+template <typename T>
+void append(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename Block>
+void begin(std::string& out, WireTemplate id, const Block& block) {
+    out.clear();
+    append(out, WireHeader{static_cast<uint16_t>(sizeof(Block)), id, kWireSchemaId, kWireSchemaVersion});
+    append(out, block);
+}
+
+// Writes a group header with a zero count; end_group() fills it in once the
+// entries are known, so cursors need only one pass.
+size_t begin_group(std::string& out, uint16_t entry_size) {
+    size_t at = out.size();
+    append(out, WireGroup{entry_size, 0});
+    return at;
+}
+
+bool end_group(std::string& out, size_t at, size_t count) {
+    if (count > std::numeric_limits<uint16_t>::max()) return false;
+    WireGroup group{0, static_cast<uint16_t>(count)};
+    std::memcpy(&group.block_length, &out[at], sizeof(group.block_length));
+    std::memcpy(&out[at], &group, sizeof(group));
+    return true;
+}
+
+bool append_levels(std::string& out, StrRef array) {
+    size_t at = begin_group(out, sizeof(WireLevel));
+    size_t count = 0;
+    LevelCursor cursor(array);
+    BookLevel level;
+    while (cursor.next(level)) {
+        WireLevel entry{};
+        entry.price = level.price;
+        entry.amount = level.amount;
+        entry.action = static_cast<uint8_t>(level.action);
+        append(out, entry);
+        ++count;
+    }
+    return end_group(out, at, count);
+}
+
+bool append_snapshot_levels(std::string& out, const PriceLevel* levels, size_t count) {
+    size_t at = begin_group(out, sizeof(WireLevel));
+    for (size_t i = 0; i < count; ++i) {
+        WireLevel entry{};
+        entry.price = levels[i].price;
+        entry.amount = levels[i].amount;
+        entry.action = BookLevel::NEW;
+        append(out, entry);
+    }
+    return end_group(out, at, count);
+}
+
+bool append_changes(std::string& out, const BookLevel* levels, size_t count) {
+    size_t at = begin_group(out, sizeof(WireLevel));
+    for (size_t i = 0; i < count; ++i) {
+        WireLevel entry{};
+        entry.price = levels[i].price;
+        entry.amount = levels[i].amount;
+        entry.action = static_cast<uint8_t>(levels[i].action);
+        append(out, entry);
+    }
+    return end_group(out, at, count);
+}
+
+template <size_t N>
+void copy_name(char (&out)[N], const std::string& text) {
+    std::memset(out, 0, N);
+    std::memcpy(out, text.data(), std::min(text.size(), N));
+}
+
+double number_or_zero(const json& object, const char* key) {
+    auto it = object.find(key);
+    return it != object.end() && it->is_number() ? it->get<double>() : 0.0;
+}
+
+} // namespace
+
+bool encode_wire_instrument(uint32_t instrument, const std::string& name, std::string& out) {
+    WireInstrument block{};
+    block.instrument = instrument;
+    if (const InstrumentSpec* spec = getInstrumentCache().find(instrument)) {
+        block.tick_size = spec->tick_size;
+        block.min_trade_amount = spec->min_trade_amount;
+    }
+    if (name.size() > sizeof(block.name)) return false;
+    copy_name(block.name, name);
+    begin(out, WIRE_INSTRUMENT, block);
+    return true;
+}
+
+bool encode_wire_book(uint32_t instrument, const BookNotification& book, std::string& out) {
+    WireBook block{};
+    block.instrument = instrument;
+    block.snapshot = book.snapshot ? 1 : 0;
+    block.timestamp = book.timestamp;
+    block.change_id = book.change_id;
+    block.prev_change_id = book.prev_change_id;
+    begin(out, WIRE_BOOK, block);
+    return append_levels(out, book.bids) && append_levels(out, book.asks);
+}
+
+bool encode_wire_book_snapshot(uint32_t instrument, int64_t change_id, int64_t timestamp, const PriceLevel* bids,
+                               size_t bid_count, const PriceLevel* asks, size_t ask_count, std::string& out) {
+    WireBook block{};
+    block.instrument = instrument;
+    block.snapshot = 1;
+    block.timestamp = timestamp;
+    block.change_id = change_id;
+    begin(out, WIRE_BOOK, block);
+    return append_snapshot_levels(out, bids, bid_count) && append_snapshot_levels(out, asks, ask_count);
+}
+
+bool encode_wire_book_changes(uint32_t instrument, int64_t change_id, int64_t prev_change_id, int64_t timestamp,
+                              const BookLevel* bids, size_t bid_count, const BookLevel* asks, size_t ask_count,
+                              std::string& out) {
+    WireBook block{};
+    block.instrument = instrument;
+    block.timestamp = timestamp;
+    block.change_id = change_id;
+    block.prev_change_id = prev_change_id;
+    begin(out, WIRE_BOOK, block);
+    return append_changes(out, bids, bid_count) && append_changes(out, asks, ask_count);
+}
+
+bool encode_wire_trades(uint32_t instrument, StrRef data, std::string& out) {
+    WireTrades block{};
+    block.instrument = instrument;
+    begin(out, WIRE_TRADES, block);
+    size_t at = begin_group(out, sizeof(WireTrade));
+    size_t count = 0;
+    TradeCursor cursor(data);
+    Trade trade;
+    while (cursor.next(trade)) {
+        WireTrade entry{};
+        entry.timestamp = trade.timestamp;
+        entry.trade_seq = trade.trade_seq;
+        entry.price = trade.price;
+        entry.amount = trade.amount;
+        entry.side = static_cast<uint8_t>(trade.buy ? OrderSide::BUY : OrderSide::SELL);
+        append(out, entry);
+        ++count;
+    }
+    return count > 0 && end_group(out, at, count);
+}
+
+bool encode_wire_ticker(uint32_t instrument, const TickerNotification& ticker, std::string& out) {
+    WireTicker block{};
+    block.instrument = instrument;
+    block.timestamp = ticker.timestamp;
+    block.best_bid_price = ticker.best_bid_price;
+    block.best_bid_amount = ticker.best_bid_amount;
+    block.best_ask_price = ticker.best_ask_price;
+    block.best_ask_amount = ticker.best_ask_amount;
+    block.last_price = ticker.last_price;
+    block.mark_price = ticker.mark_price;
+    block.index_price = ticker.index_price;
+    begin(out, WIRE_TICKER, block);
+    return true;
+}
+
+bool encode_wire_notification(uint32_t instrument, const std::string& frame, std::string& out) {
+    Notification note;
+    if (!parse_notification(frame.data(), frame.size(), note)) return false;
+    switch (note.kind) {
+    case NotificationKind::BOOK: return encode_wire_book(instrument, note.book, out);
+    case NotificationKind::TICKER: return encode_wire_ticker(instrument, note.ticker, out);
+    case NotificationKind::TRADES: return encode_wire_trades(instrument, note.data, out);
+    default: return false;
+    }
+}
+
+bool encode_wire_order_ack(const std::string& response, std::string& out) {
+    json j = json::parse(response, nullptr, false);
+    if (!j.is_object() || !j.contains("id") || !j["id"].is_number_unsigned()) return false;
+
+    WireOrderAck block{};
+    block.request_id = j["id"].get<uint64_t>();
+    block.instrument = InstrumentRegistry::kInvalidId;
+    if (j.contains("error") && j["error"].is_object()) {
+        block.error_code = j["error"].value("code", -1);
+        block.state = static_cast<uint8_t>(OrderState::REJECTED);
+        begin(out, WIRE_ORDER_ACK, block);
+        return true;
+    }
+    if (!j.contains("result") || !j["result"].is_object()) return false;
+    // buy/sell/edit wrap the order with its trades; cancel returns it bare.
+    const json& result = j["result"];
+    const json& order = result.contains("order") ? result["order"] : result;
+    if (!order.is_object() || !order.contains("order_id")) return false;
+
+    std::string order_id = order.value("order_id", "");
+    std::string instrument = order.value("instrument_name", "");
+    std::string state = order.value("order_state", "");
+    if (order_id.size() > sizeof(block.order_id)) return false;
+    block.instrument = getInstrumentRegistry().find(instrument);
+    block.state = static_cast<uint8_t>(parse_order_state(StrRef{state.data(), state.size()}));
+    block.side = static_cast<uint8_t>(order.value("direction", "") == "sell" ? OrderSide::SELL : OrderSide::BUY);
+    block.order_type = static_cast<uint8_t>(order.value("order_type", "") == "market" ? OrderType::MARKET
+                                                                                       : OrderType::LIMIT);
+    // Market orders carry "market_price" here, which reads as 0.
+    block.price = number_or_zero(order, "price");
+    block.amount = number_or_zero(order, "amount");
+    block.filled_amount = number_or_zero(order, "filled_amount");
+    block.average_price = number_or_zero(order, "average_price");
+    block.timestamp = order.value("last_update_timestamp", int64_t(0));
+    copy_name(block.order_id, order_id);
+    begin(out, WIRE_ORDER_ACK, block);
+    return true;
+}
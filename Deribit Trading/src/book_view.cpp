@@ -0,0 +1,140 @@
+#include "book_view.hpp"
+#include "binary_protocol.hpp"
+#include "instruments.hpp"
+#include <nlohmann/json.hpp>
+#include <mutex>
+
+using json = nlohmann::json;
+
+namespace {
+
+const char* action_name(BookLevel::Action action) {
+    switch (action) {
+    case BookLevel::NEW: return "new";
+    case BookLevel::CHANGE: return "change";
+    case BookLevel::DELETE: return "delete";
+    }
+    return "new";
+}
+
+// Both sides best first: bids by falling price, asks by rising price.
+void diff_side(OrderBook::Side side, const std::vector<PriceLevel>& before, const std::vector<PriceLevel>& after,
+               std::vector<BookLevel>& changes) {
+    changes.clear();
+    size_t i = 0, j = 0;
+    while (i < before.size() || j < after.size()) {
+        if (j == after.size() || (i < before.size() && (side == OrderBook::BID ? before[i].price > after[j].price
+                                                                                : before[i].price < after[j].price))) {
+            changes.push_back(BookLevel{BookLevel::DELETE, before[i].price, 0.0});
+            ++i;
+        } else if (i == before.size() || before[i].price != after[j].price) {
+            changes.push_back(BookLevel{BookLevel::NEW, after[j].price, after[j].amount});
+            ++j;
+        } else {
+            if (before[i].amount != after[j].amount) {
+                changes.push_back(BookLevel{BookLevel::CHANGE, after[j].price, after[j].amount});
+            }
+            ++i;
+            ++j;
+        }
+    }
+}
+
+json levels_json(const std::vector<PriceLevel>& levels) {
+    json out = json::array();
+    for (const auto& level : levels) {
+        out.push_back({"new", level.price, level.amount});
+    }
+    return out;
+}
+
+json changes_json(const std::vector<BookLevel>& changes) {
+    json out = json::array();
+    for (const auto& level : changes) {
+        out.push_back({action_name(level.action), level.price, level.amount});
+    }
+    return out;
+}
+
+} // namespace
+
+BookView::BookView(uint32_t instrument, size_t depth, uint32_t interval_ms, uint64_t serial)
+    : instrument_(instrument), depth_(depth), interval_ms_(interval_ms), serial_(serial) {
+}
+
+bool BookView::refresh(OrderBookStore::Entry& entry) {
+    int64_t change_id, timestamp;
+    {
+        std::lock_guard<std::mutex> lock(entry.mutex);
+        if (!entry.book.is_valid()) return false;
+        change_id = entry.book.change_id();
+        if (change_id == change_id_) return false;
+        timestamp = entry.book.timestamp();
+        for (int side = OrderBook::BID; side <= OrderBook::ASK; ++side) {
+            OrderBook::Side book_side = static_cast<OrderBook::Side>(side);
+            std::vector<PriceLevel>& levels = next_[side];
+            levels.resize(depth_ ? depth_ : entry.book.depth(book_side));
+            levels.resize(entry.book.top(book_side, levels.data(), levels.size()));
+        }
+    }
+
+    diff_side(OrderBook::BID, sides_[OrderBook::BID], next_[OrderBook::BID], changes_[OrderBook::BID]);
+    diff_side(OrderBook::ASK, sides_[OrderBook::ASK], next_[OrderBook::ASK], changes_[OrderBook::ASK]);
+    // Activity outside the window: subscribers keep chaining from the last
+    // change_id they were sent.
+    if (changes_[OrderBook::BID].empty() && changes_[OrderBook::ASK].empty()) return false;
+
+    prev_change_id_ = change_id_;
+    change_id_ = change_id;
+    timestamp_ = timestamp;
+    sides_[OrderBook::BID].swap(next_[OrderBook::BID]);
+    sides_[OrderBook::ASK].swap(next_[OrderBook::ASK]);
+    return true;
+}
+
+std::string BookView::channel() const {
+    return "book." + getInstrumentRegistry().name(instrument_) + "." +
+           (depth_ ? std::to_string(depth_) : std::string("full")) + "." + std::to_string(interval_ms_) + "ms";
+}
+
+std::string BookView::render_json(bool snapshot) const {
+    json data = {
+        {"type", snapshot ? "snapshot" : "change"},
+        {"instrument_name", getInstrumentRegistry().name(instrument_)},
+        {"change_id", change_id_},
+        {"timestamp", timestamp_}
+    };
+    if (snapshot) {
+        data["bids"] = levels_json(sides_[OrderBook::BID]);
+        data["asks"] = levels_json(sides_[OrderBook::ASK]);
+    } else {
+        data["prev_change_id"] = prev_change_id_;
+        data["bids"] = changes_json(changes_[OrderBook::BID]);
+        data["asks"] = changes_json(changes_[OrderBook::ASK]);
+    }
+    json notification = {
+        {"jsonrpc", "2.0"},
+        {"method", "subscription"},
+        {"params", {
+            {"channel", channel()},
+            {"data", data}
+        }}
+    };
+    return notification.dump();
+}
+
+std::string BookView::render_wire(bool snapshot) const {
+    std::string wire;
+    if (snapshot) {
+        const std::vector<PriceLevel>& bids = sides_[OrderBook::BID];
+        const std::vector<PriceLevel>& asks = sides_[OrderBook::ASK];
+        encode_wire_book_snapshot(instrument_, change_id_, timestamp_, bids.data(), bids.size(), asks.data(),
+                                  asks.size(), wire);
+    } else {
+        const std::vector<BookLevel>& bids = changes_[OrderBook::BID];
+        const std::vector<BookLevel>& asks = changes_[OrderBook::ASK];
+        encode_wire_book_changes(instrument_, change_id_, prev_change_id_, timestamp_, bids.data(), bids.size(),
+                                 asks.data(), asks.size(), wire);
+    }
+    return wire;
+}
@@ -0,0 +1,90 @@
+#include "connection_pool.hpp"
+#include "websocket_client.hpp"
+#include "websocket_server.hpp"
+#include "threading.hpp"
+#include "logger.hpp"
+#include <stdexcept>
+
+const size_t ConnectionPool::kMaxShards;
+
+ConnectionPool::~ConnectionPool() {
+    stop();
+    join();
+}
+
+void ConnectionPool::configure(size_t market_data_shards, WebSocketServer* server) {
+    if (configured()) throw std::logic_error("Connection pool already configured");
+    if (market_data_shards == 0 || market_data_shards > kMaxShards) {
+        throw std::invalid_argument("Market data connections must be 1-" + std::to_string(kMaxShards));
+    }
+    // The order session keeps producer 0, which the server always has.
+    orders_.reset(new WebSocketClient(ThreadRole::ORDER_EGRESS));
+    for (size_t i = 0; i < market_data_shards; ++i) {
+        market_data_.emplace_back(new WebSocketClient(ThreadRole::DERIBIT_INGRESS));
+        if (server) {
+            market_data_.back()->set_producer(server->add_producer());
+        }
+    }
+    LOG_INFO("[Pool] Order session plus {} market data connection(s)", market_data_shards);
+}
+
+void ConnectionPool::start_capture(const std::string& prefix) {
+    orders_->start_capture(prefix + ".orders");
+    for (size_t i = 0; i < market_data_.size(); ++i) {
+        market_data_[i]->start_capture(prefix + ".md" + std::to_string(i));
+    }
+}
+
+void ConnectionPool::connect(const std::string& uri, const std::string& client_id,
+                             const std::string& client_secret) {
+    // Every connection authenticates its own session, since raw book channels
+    // need it too; only the order session takes the user streams.
+    orders_->set_credentials(client_id, client_secret);
+    WebSocketClient* orders = orders_.get();
+    threads_.push_back(getThreadingConfig().spawn(ThreadRole::ORDER_EGRESS, [orders, uri]() {
+        orders->connect(uri);
+    }));
+    for (size_t i = 0; i < market_data_.size(); ++i) {
+        WebSocketClient* shard = market_data_[i].get();
+        shard->set_credentials(client_id, client_secret);
+        shard->set_user_streams(false);
+        threads_.push_back(getThreadingConfig().spawn(ThreadRole::DERIBIT_INGRESS, [shard, uri]() {
+            shard->connect(uri);
+        }, i));
+    }
+}
+
+void ConnectionPool::stop() {
+    if (orders_) orders_->stop();
+    for (auto& shard : market_data_) {
+        shard->stop();
+    }
+}
+
+void ConnectionPool::join() {
+    for (auto& thread : threads_) {
+        if (thread.joinable()) thread.join();
+    }
+    threads_.clear();
+}
+
+size_t ConnectionPool::scheduled_requests() const {
+    size_t total = orders_ ? orders_->scheduled_requests() : 0;
+    for (const auto& shard : market_data_) {
+        total += shard->scheduled_requests();
+    }
+    return total;
+}
+
+uint64_t ConnectionPool::book_resyncs() const {
+    uint64_t total = 0;
+    for (const auto& shard : market_data_) {
+        total += shard->book_resyncs();
+    }
+    return total;
+}
+
+ConnectionPool& getConnectionPool() {
+    static ConnectionPool pool;
+    return pool;
+}
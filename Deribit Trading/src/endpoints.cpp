@@ -0,0 +1,26 @@
+#include "endpoints.hpp"
+#include <cstdlib>
+
+namespace {
+
+std::string env_or(const char* name, const char* fallback) {
+    const char* value = std::getenv(name);
+    return value && *value ? value : fallback;
+}
+
+} // namespace
+
+const std::string& rest_base_url() {
+    static const std::string url = env_or("DERIBIT_REST_URL", "https://test.deribit.com/api/v2");
+    return url;
+}
+
+const std::string& ws_url() {
+    static const std::string url = env_or("DERIBIT_WS_URL", "wss://test.deribit.com/ws/api/v2");
+    return url;
+}
+
+bool tls_verify() {
+    static const bool verify = env_or("DERIBIT_TLS_VERIFY", "1") != "0";
+    return verify;
+}
@@ -0,0 +1,186 @@
+#include "http_transport.hpp"
+#include <cstdlib>
+#include <stdexcept>
+#include "endpoints.hpp"
+
+namespace {
+
+size_t write_callback(void* contents, size_t size, size_t nmemb, void* userdata) {
+    size_t total_size = size * nmemb;
+    static_cast<std::string*>(userdata)->append(static_cast<char*>(contents), total_size);
+    return total_size;
+}
+
+} // namespace
+
+HttpTransport::HttpTransport(const HttpTransportOptions& options)
+    : options_(options) {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    share_ = curl_share_init();
+    if (!share_) throw std::runtime_error("CURL share init failed");
+    curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, &HttpTransport::lock_share);
+    curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, &HttpTransport::unlock_share);
+    curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    // Not the connection cache: libcurl does not support sharing it between
+    // threads. Each pooled handle keeps its own connection alive instead.
+
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    for (size_t i = 0; i < options_.warm_handles; ++i) {
+        idle_.push_back(create_handle());
+    }
+}
+
+HttpTransport::~HttpTransport() {
+    for (auto& handle : handles_) {
+        curl_easy_cleanup(handle->easy);
+        curl_slist_free_all(handle->get_headers);
+        curl_slist_free_all(handle->post_headers);
+    }
+    curl_share_cleanup(share_);
+    curl_global_cleanup();
+}
+
+void HttpTransport::lock_share(CURL*, curl_lock_data data, curl_lock_access, void* self) {
+    static_cast<HttpTransport*>(self)->share_mutexes_[data].lock();
+}
+
+void HttpTransport::unlock_share(CURL*, curl_lock_data data, void* self) {
+    static_cast<HttpTransport*>(self)->share_mutexes_[data].unlock();
+}
+
+// Options that never change between requests are set once here.
+HttpTransport::Handle* HttpTransport::create_handle() {
+    std::unique_ptr<Handle> handle(new Handle());
+    handle->easy = curl_easy_init();
+    if (!handle->easy) throw std::runtime_error("CURL init failed");
+
+    CURL* curl = handle->easy;
+    curl_easy_setopt(curl, CURLOPT_SHARE, share_);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &handle->response);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, options_.dns_cache_timeout_s);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, options_.connect_timeout_ms);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, options_.request_timeout_ms);
+    if (!tls_verify()) {
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    }
+    if (options_.http2) {
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+        curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+    } else {
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+    }
+    set_auth_token(*handle, "");
+
+    handles_.push_back(std::move(handle));
+    return handles_.back().get();
+}
+
+HttpTransport::Handle* HttpTransport::acquire() {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    if (idle_.empty()) {
+        return create_handle();
+    }
+    Handle* handle = idle_.back();
+    idle_.pop_back();
+    return handle;
+}
+
+void HttpTransport::release(Handle* handle) {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    idle_.push_back(handle);
+}
+
+void HttpTransport::set_auth_token(Handle& handle, const std::string& auth_token) {
+    if (handle.get_headers && handle.auth_token == auth_token) return;
+
+    curl_slist_free_all(handle.get_headers);
+    curl_slist_free_all(handle.post_headers);
+    handle.get_headers = nullptr;
+    handle.post_headers = nullptr;
+
+    // An empty "Expect:" stops curl waiting for 100-continue on POST bodies.
+    handle.post_headers = curl_slist_append(handle.post_headers, "Content-Type: application/json");
+    handle.post_headers = curl_slist_append(handle.post_headers, "Expect:");
+    handle.get_headers = curl_slist_append(handle.get_headers, "Accept: application/json");
+    if (!auth_token.empty()) {
+        std::string auth_header = "Authorization: Bearer " + auth_token;
+        handle.post_headers = curl_slist_append(handle.post_headers, auth_header.c_str());
+        handle.get_headers = curl_slist_append(handle.get_headers, auth_header.c_str());
+    }
+    handle.auth_token = auth_token;
+}
+
+std::string HttpTransport::perform(Handle& handle, const char* what) {
+    handle.response.clear();
+    CURLcode res = curl_easy_perform(handle.easy);
+    if (res != CURLE_OK) {
+        throw std::runtime_error(std::string("CURL ") + what + " error: " + curl_easy_strerror(res));
+    }
+    return std::move(handle.response);
+}
+
+std::string HttpTransport::get(const std::string& url, const std::string& auth_token) {
+    Handle* handle = acquire();
+    try {
+        set_auth_token(*handle, auth_token);
+        curl_easy_setopt(handle->easy, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(handle->easy, CURLOPT_HTTPGET, 1L);
+        curl_easy_setopt(handle->easy, CURLOPT_HTTPHEADER, handle->get_headers);
+        std::string response = perform(*handle, "GET");
+        release(handle);
+        return response;
+    } catch (...) {
+        release(handle);
+        throw;
+    }
+}
+
+std::string HttpTransport::post(const std::string& url, const std::string& body, const std::string& auth_token) {
+    // Query-string requests carry no body and went out as GETs before the
+    // pooled transport; keep them that way on the wire.
+    if (body.empty()) return get(url, auth_token);
+    Handle* handle = acquire();
+    try {
+        set_auth_token(*handle, auth_token);
+        curl_easy_setopt(handle->easy, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(handle->easy, CURLOPT_POST, 1L);
+        curl_easy_setopt(handle->easy, CURLOPT_POSTFIELDS, body.c_str());
+        curl_easy_setopt(handle->easy, CURLOPT_POSTFIELDSIZE, static_cast<long>(body.size()));
+        curl_easy_setopt(handle->easy, CURLOPT_HTTPHEADER, handle->post_headers);
+        std::string response = perform(*handle, "POST");
+        release(handle);
+        return response;
+    } catch (...) {
+        release(handle);
+        throw;
+    }
+}
+
+void HttpTransport::warm_up(const std::string& url) {
+    Handle* handle = acquire();
+    curl_easy_setopt(handle->easy, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(handle->easy, CURLOPT_NOBODY, 1L);
+    curl_easy_setopt(handle->easy, CURLOPT_HTTPHEADER, handle->get_headers);
+    handle->response.clear();
+    curl_easy_perform(handle->easy);
+    curl_easy_setopt(handle->easy, CURLOPT_NOBODY, 0L);
+    release(handle);
+}
+
+HttpTransport& getHttpTransport() {
+    static HttpTransport transport([] {
+        HttpTransportOptions options;
+        const char* http2 = std::getenv("DERIBIT_HTTP2");
+        options.http2 = http2 && std::string(http2) == "1";
+        return options;
+    }());
+    return transport;
+}
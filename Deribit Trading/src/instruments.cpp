@@ -0,0 +1,165 @@
+#include "instruments.hpp"
+#include "endpoints.hpp"
+#include "logger.hpp"
+#include "order_encoder.hpp"
+#include "utils.hpp"
+#include <cmath>
+#include <cstring>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+namespace {
+
+// Amounts that are a lot minus floating-point noise still count as a lot.
+const double kLotEpsilon = 1e-9;
+
+int64_t to_e8(double value) {
+    return std::llround(value * 1e8);
+}
+
+} // namespace
+
+const uint32_t InstrumentRegistry::kMaxInstruments;
+const uint32_t InstrumentRegistry::kInvalidId;
+const uint32_t InstrumentRegistry::kSlotCount;
+
+InstrumentRegistry::InstrumentRegistry()
+    : names_(new std::string[kMaxInstruments]), slots_(new std::atomic<uint32_t>[kSlotCount]) {
+    for (uint32_t i = 0; i < kSlotCount; ++i) {
+        slots_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+// FNV-1a; instrument names are short.
+uint32_t InstrumentRegistry::hash(StrRef name) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < name.size; ++i) {
+        h = (h ^ static_cast<unsigned char>(name.data[i])) * 16777619u;
+    }
+    return h;
+}
+
+uint32_t InstrumentRegistry::find(StrRef name) const {
+    for (uint32_t slot = hash(name) & (kSlotCount - 1);; slot = (slot + 1) & (kSlotCount - 1)) {
+        uint32_t entry = slots_[slot].load(std::memory_order_acquire);
+        if (entry == 0) return kInvalidId;
+        const std::string& candidate = names_[entry - 1];
+        if (candidate.size() == name.size && std::memcmp(candidate.data(), name.data, name.size) == 0) {
+            return entry - 1;
+        }
+    }
+}
+
+uint32_t InstrumentRegistry::intern(StrRef name) {
+    uint32_t id = find(name);
+    if (id != kInvalidId) return id;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    id = find(name);
+    if (id != kInvalidId) return id;
+    id = count_.load(std::memory_order_relaxed);
+    if (id >= kMaxInstruments) {
+        LOG_EVERY_MS(LOG_LEVEL_WARN, 1000, "[Instruments] Registry full, ignoring {} ({} more since last warning)",
+                     LogText(name.data, name.size));
+        return kInvalidId;
+    }
+
+    // The name is written before the slot that points at it is published.
+    names_[id].assign(name.data, name.size);
+    uint32_t slot = hash(name) & (kSlotCount - 1);
+    while (slots_[slot].load(std::memory_order_relaxed) != 0) {
+        slot = (slot + 1) & (kSlotCount - 1);
+    }
+    slots_[slot].store(id + 1, std::memory_order_release);
+    count_.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+InstrumentRegistry& getInstrumentRegistry() {
+    static InstrumentRegistry registry;
+    return registry;
+}
+
+Price InstrumentSpec::price_from(double price) const {
+    return Price{std::llround(price / tick_size)};
+}
+
+Qty InstrumentSpec::qty_from(double amount) const {
+    return Qty{static_cast<int64_t>(std::floor(amount / min_trade_amount + kLotEpsilon))};
+}
+
+size_t InstrumentSpec::format(Price price, char* out) const {
+    return format_scaled(price.ticks * tick_e8, out);
+}
+
+size_t InstrumentSpec::format(Qty qty, char* out) const {
+    return format_scaled(qty.lots * lot_e8, out);
+}
+
+size_t InstrumentCache::load(const std::string& currency) {
+    std::string url = rest_base_url() + "/public/get_instruments?currency=" + currency + "&expired=false";
+    size_t added = load_response(http_get(url));
+    LOG_INFO("[Instruments] Loaded {} {} instruments, {} cached", added, currency, count_);
+    return added;
+}
+
+size_t InstrumentCache::load_response(const std::string& response) {
+    json parsed = json::parse(response);
+    if (!parsed.contains("result") || !parsed["result"].is_array()) {
+        throw std::runtime_error("Unexpected get_instruments response: " + response.substr(0, 200));
+    }
+
+    size_t added = 0;
+    for (const auto& entry : parsed["result"]) {
+        if (entry.contains("is_active") && !entry["is_active"].get<bool>()) continue;
+
+        InstrumentSpec spec;
+        spec.name = entry.value("instrument_name", "");
+        spec.kind = entry.value("kind", "");
+        spec.base_currency = entry.value("base_currency", "");
+        spec.quote_currency = entry.value("quote_currency", "");
+        spec.tick_size = entry.value("tick_size", 0.0);
+        spec.contract_size = entry.value("contract_size", 0.0);
+        spec.min_trade_amount = entry.value("min_trade_amount", 0.0);
+        spec.inverse = spec.kind == "future" && spec.quote_currency == "USD";
+        if (add(spec)) {
+            ++added;
+        } else {
+            LOG_WARN("[Instruments] Skipping {}: tick size {} min trade amount {}", spec.name,
+                     spec.tick_size, spec.min_trade_amount);
+        }
+    }
+    return added;
+}
+
+InstrumentCache::InstrumentCache()
+    : specs_(new std::unique_ptr<InstrumentSpec>[InstrumentRegistry::kMaxInstruments]) {}
+
+bool InstrumentCache::add(const InstrumentSpec& spec) {
+    std::unique_ptr<InstrumentSpec> copy(new InstrumentSpec(spec));
+    copy->tick_e8 = to_e8(spec.tick_size);
+    copy->lot_e8 = to_e8(spec.min_trade_amount);
+    if (copy->name.empty() || copy->tick_e8 <= 0 || copy->lot_e8 <= 0) {
+        return false;
+    }
+
+    uint32_t id = getInstrumentRegistry().intern(copy->name);
+    if (id == InstrumentRegistry::kInvalidId) {
+        return false;
+    }
+    if (specs_[id]) {
+        // Update in place so pointers handed out earlier stay valid.
+        *specs_[id] = *copy;
+    } else {
+        specs_[id] = std::move(copy);
+        ++count_;
+    }
+    return true;
+}
+
+InstrumentCache& getInstrumentCache() {
+    static InstrumentCache cache;
+    return cache;
+}
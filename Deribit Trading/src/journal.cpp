@@ -0,0 +1,299 @@
+#include "journal.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char kJournalMagic[8] = {'D', 'B', 'J', 'R', 'N', 'L', '0', '1'};
+
+size_t align_to(size_t n, size_t alignment) {
+    return (n + alignment - 1) & ~(alignment - 1);
+}
+
+size_t round_up_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+uint64_t wall_nanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::string segment_path(const std::string& prefix, uint64_t index) {
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".%06llu.jrnl", static_cast<unsigned long long>(index));
+    return prefix + suffix;
+}
+
+} // namespace
+
+const uint32_t JournalWriter::kWrapMarker;
+
+JournalWriter::JournalWriter(const std::string& prefix, size_t segment_bytes, size_t ring_bytes)
+    : ring_mask_(round_up_pow2(ring_bytes) - 1),
+      ring_(new char[ring_mask_ + 1]),
+      prefix_(prefix),
+      segment_bytes_(segment_bytes) {
+    // Opening the first segment here surfaces path and permission errors to the caller.
+    open_segment(segment_bytes_);
+    writer_ = std::thread(&JournalWriter::writer_loop, this);
+}
+
+JournalWriter::~JournalWriter() {
+    running_ = false;
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+    drain();
+    close_segment();
+}
+
+bool JournalWriter::append(const char* data, size_t size, uint64_t received_ns) {
+    if (size == 0) return true;
+    if (!ring_push(data, size, received_ns)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+bool JournalWriter::ring_push(const char* data, size_t size, uint64_t received_ns) {
+    const size_t capacity = ring_mask_ + 1;
+    const size_t need = sizeof(JournalRecordHeader) + align_to(size, sizeof(JournalRecordHeader));
+    if (need > capacity / 2) return false;
+
+    size_t tail = ring_tail_.load(std::memory_order_relaxed);
+    size_t pos = tail & ring_mask_;
+    size_t contiguous = capacity - pos;
+    size_t total = contiguous < need ? contiguous + need : need;
+    if (tail + total - cached_head_ > capacity) {
+        cached_head_ = ring_head_.load(std::memory_order_acquire);
+        if (tail + total - cached_head_ > capacity) return false;
+    }
+
+    JournalRecordHeader header;
+    header.reserved = 0;
+    header.received_ns = received_ns;
+    if (contiguous < need) {
+        header.size = kWrapMarker;
+        std::memcpy(ring_.get() + pos, &header, sizeof(header));
+        tail += contiguous;
+        pos = 0;
+    }
+    header.size = static_cast<uint32_t>(size);
+    std::memcpy(ring_.get() + pos, &header, sizeof(header));
+    std::memcpy(ring_.get() + pos + sizeof(header), data, size);
+    ring_tail_.store(tail + need, std::memory_order_release);
+    return true;
+}
+
+void JournalWriter::flush() {
+    size_t target = ring_tail_.load(std::memory_order_acquire);
+    while (ring_head_.load(std::memory_order_acquire) < target) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void JournalWriter::writer_loop() {
+    while (running_) {
+        if (!drain()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+// Returns true if anything was written.
+bool JournalWriter::drain() {
+    const size_t capacity = ring_mask_ + 1;
+    size_t head = ring_head_.load(std::memory_order_relaxed);
+    size_t tail = ring_tail_.load(std::memory_order_acquire);
+    if (head == tail) return false;
+
+    while (head != tail) {
+        size_t pos = head & ring_mask_;
+        JournalRecordHeader header;
+        std::memcpy(&header, ring_.get() + pos, sizeof(header));
+        if (header.size == kWrapMarker) {
+            head += capacity - pos;
+            continue;
+        }
+        write_record(header, ring_.get() + pos + sizeof(header));
+        head += sizeof(header) + align_to(header.size, sizeof(header));
+        ring_head_.store(head, std::memory_order_release);
+    }
+    ring_head_.store(head, std::memory_order_release);
+    return true;
+}
+
+void JournalWriter::write_record(const JournalRecordHeader& header, const char* payload) {
+    size_t bytes = sizeof(header) + align_to(header.size, 8);
+    if (!map_ || used_ + bytes > mapped_) {
+        close_segment();
+        ++segment_index_;
+        try {
+            open_segment(std::max(segment_bytes_, sizeof(JournalFileHeader) + bytes));
+        } catch (const std::exception& e) {
+            LOG_ERROR("[Journal] {}", e.what());
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    std::memcpy(map_ + used_, &header, sizeof(header));
+    std::memcpy(map_ + used_ + sizeof(header), payload, header.size);
+    used_ += bytes;
+    records_written_.fetch_add(1, std::memory_order_relaxed);
+}
+
+// The file is sized up front so appends never extend it; close_segment() trims
+// it back to what was written.
+void JournalWriter::open_segment(size_t min_bytes) {
+    std::string path = segment_path(prefix_, segment_index_);
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot open journal segment " + path + ": " + std::strerror(errno));
+    }
+    if (::ftruncate(fd_, static_cast<off_t>(min_bytes)) != 0) {
+        ::close(fd_);
+        fd_ = -1;
+        throw std::runtime_error("Cannot size journal segment " + path + ": " + std::strerror(errno));
+    }
+    void* map = ::mmap(nullptr, min_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map == MAP_FAILED) {
+        ::close(fd_);
+        fd_ = -1;
+        throw std::runtime_error("Cannot map journal segment " + path + ": " + std::strerror(errno));
+    }
+    map_ = static_cast<char*>(map);
+    mapped_ = min_bytes;
+
+    JournalFileHeader header;
+    std::memcpy(header.magic, kJournalMagic, sizeof(header.magic));
+    header.segment_index = segment_index_;
+    header.created_ns = wall_nanoseconds();
+    std::memcpy(map_, &header, sizeof(header));
+    used_ = sizeof(header);
+    LOG_INFO("[Journal] Writing {}", path);
+}
+
+void JournalWriter::close_segment() {
+    if (!map_) return;
+    ::munmap(map_, mapped_);
+    map_ = nullptr;
+    if (::ftruncate(fd_, static_cast<off_t>(used_)) != 0) {
+        LOG_WARN("[Journal] Could not trim segment {}", segment_index_);
+    }
+    ::close(fd_);
+    fd_ = -1;
+}
+
+JournalReader::JournalReader(const std::string& path) {
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot open journal " + path + ": " + std::strerror(errno));
+    }
+    struct stat st;
+    if (::fstat(fd_, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(JournalFileHeader)) {
+        ::close(fd_);
+        throw std::runtime_error("Not a journal: " + path);
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    void* map = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (map == MAP_FAILED) {
+        ::close(fd_);
+        throw std::runtime_error("Cannot map journal " + path + ": " + std::strerror(errno));
+    }
+    map_ = static_cast<const char*>(map);
+    if (std::memcmp(map_, kJournalMagic, sizeof(kJournalMagic)) != 0) {
+        ::munmap(const_cast<char*>(map_), size_);
+        ::close(fd_);
+        throw std::runtime_error("Not a journal: " + path);
+    }
+    ::madvise(const_cast<char*>(map_), size_, MADV_SEQUENTIAL);
+    rewind();
+}
+
+JournalReader::~JournalReader() {
+    ::munmap(const_cast<char*>(map_), size_);
+    ::close(fd_);
+}
+
+void JournalReader::rewind() {
+    offset_ = sizeof(JournalFileHeader);
+}
+
+bool JournalReader::next(JournalRecord& record) {
+    JournalRecordHeader header;
+    if (offset_ + sizeof(header) > size_) return false;
+    std::memcpy(&header, map_ + offset_, sizeof(header));
+    // A zero size is the unwritten tail of a segment that was never closed.
+    if (header.size == 0 || offset_ + sizeof(header) + header.size > size_) return false;
+
+    record.received_ns = header.received_ns;
+    record.data = map_ + offset_ + sizeof(header);
+    record.size = header.size;
+    offset_ += sizeof(header) + align_to(header.size, 8);
+    return true;
+}
+
+uint64_t JournalReplay::run(const FrameHandler& handler, bool paced, double speed) {
+    uint64_t frames = 0;
+    uint64_t first_ns = 0;
+    std::chrono::steady_clock::time_point started;
+    std::string payload;
+    JournalRecord record;
+
+    for (const std::string& path : segments_) {
+        JournalReader reader(path);
+        while (reader.next(record)) {
+            if (paced) {
+                if (frames == 0) {
+                    first_ns = record.received_ns;
+                    started = std::chrono::steady_clock::now();
+                }
+                auto offset = std::chrono::nanoseconds(
+                    static_cast<int64_t>((record.received_ns - first_ns) / speed));
+                std::this_thread::sleep_until(started + offset);
+            }
+            payload.assign(record.data, record.size);
+            handler(payload);
+            ++frames;
+        }
+    }
+    return frames;
+}
+
+std::vector<std::string> JournalReplay::segments_for(const std::string& prefix) {
+    std::string directory = ".";
+    std::string base = prefix;
+    size_t slash = prefix.rfind('/');
+    if (slash != std::string::npos) {
+        directory = slash == 0 ? "/" : prefix.substr(0, slash);
+        base = prefix.substr(slash + 1);
+    }
+
+    std::vector<std::string> segments;
+    DIR* dir = ::opendir(directory.c_str());
+    if (!dir) return segments;
+    while (struct dirent* entry = ::readdir(dir)) {
+        std::string name = entry->d_name;
+        // <base>.NNNNNN.jrnl
+        if (name.size() == base.size() + 12 && name.compare(0, base.size(), base) == 0 &&
+            name[base.size()] == '.' && name.compare(name.size() - 5, 5, ".jrnl") == 0) {
+            segments.push_back(directory + "/" + name);
+        }
+    }
+    ::closedir(dir);
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
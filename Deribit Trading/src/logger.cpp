@@ -0,0 +1,144 @@
+#include "logger.hpp"
+#include <ctime>
+
+const size_t LogRecord::kMaxArgs;
+const size_t LogRecord::kTextCapacity;
+const size_t Logger::kThreadBufferRecords;
+
+Logger::Logger()
+    : output_(stdout), running_(true) {
+    writer_ = std::thread(&Logger::writer_loop, this);
+}
+
+Logger::~Logger() {
+    running_ = false;
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+    drain();
+    std::fflush(output_.load());
+}
+
+Logger::ThreadBuffer* Logger::register_thread() {
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    buffers_.emplace_back(new ThreadBuffer(kThreadBufferRecords));
+    return buffers_.back().get();
+}
+
+void Logger::set_output(FILE* output) {
+    output_ = output;
+}
+
+void Logger::flush() {
+    drain();
+    std::fflush(output_.load());
+}
+
+uint64_t Logger::dropped() const {
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    uint64_t total = 0;
+    for (const auto& buffer : buffers_) {
+        total += buffer->drops();
+    }
+    return total;
+}
+
+void Logger::writer_loop() {
+    while (running_) {
+        if (!drain()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+// Returns true if anything was written.
+bool Logger::drain() {
+    // flush() may drain from another thread; each ring must keep a single consumer.
+    std::lock_guard<std::mutex> drain_lock(drain_mutex_);
+    std::vector<ThreadBuffer*> buffers;
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        for (const auto& buffer : buffers_) {
+            buffers.push_back(buffer.get());
+        }
+    }
+
+    static thread_local std::string line;
+    FILE* output = output_.load();
+    bool wrote = false;
+    uint64_t drops = 0;
+    for (ThreadBuffer* buffer : buffers) {
+        drops += buffer->drops();
+        while (LogRecord* record = buffer->front()) {
+            line.clear();
+            format(*record, line);
+            buffer->pop();
+            std::fwrite(line.data(), 1, line.size(), output);
+            wrote = true;
+        }
+    }
+    if (drops != reported_drops_) {
+        std::fprintf(output, "[Logger] %llu records dropped, thread buffers full\n",
+                     static_cast<unsigned long long>(drops - reported_drops_));
+        reported_drops_ = drops;
+        wrote = true;
+    }
+    if (wrote) {
+        std::fflush(output);
+    }
+    return wrote;
+}
+
+void Logger::format(const LogRecord& record, std::string& out) {
+    static const char* level_names[] = {"DEBUG", "INFO ", "WARN ", "ERROR"};
+
+    char prefix[48];
+    time_t seconds = static_cast<time_t>(record.timestamp_ns / 1000000000ULL);
+    unsigned micros = static_cast<unsigned>((record.timestamp_ns % 1000000000ULL) / 1000);
+    struct tm parts;
+    localtime_r(&seconds, &parts);
+    int n = std::snprintf(prefix, sizeof(prefix), "%02d:%02d:%02d.%06u %s ",
+                          parts.tm_hour, parts.tm_min, parts.tm_sec, micros,
+                          level_names[record.level < 4 ? record.level : 3]);
+    out.append(prefix, n);
+
+    char number[32];
+    size_t arg = 0;
+    for (const char* p = record.format; *p; ++p) {
+        if (p[0] != '{' || p[1] != '}') {
+            out.push_back(*p);
+            continue;
+        }
+        ++p;
+        if (arg >= record.arg_count) {
+            out.append("{}");
+            continue;
+        }
+        const LogRecord::Value& v = record.values[arg];
+        switch (record.types[arg]) {
+        case LogRecord::INT:
+            out.append(number, std::snprintf(number, sizeof(number), "%lld", static_cast<long long>(v.i)));
+            break;
+        case LogRecord::UINT:
+            out.append(number, std::snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(v.u)));
+            break;
+        case LogRecord::DOUBLE:
+            out.append(number, std::snprintf(number, sizeof(number), "%.10g", v.d));
+            break;
+        case LogRecord::TEXT:
+            out.append(record.text + v.text.offset, v.text.size);
+            break;
+        case LogRecord::TEXT_TRUNCATED:
+            out.append(record.text + v.text.offset, v.text.size);
+            out.append(number, std::snprintf(number, sizeof(number), "...(%u bytes)", v.text.original_size));
+            break;
+        }
+        ++arg;
+    }
+    out.push_back('\n');
+}
+
+Logger& getLogger() {
+    static Logger logger;
+    return logger;
+}
@@ -1,11 +1,18 @@
-#include "auth.hpp"
 #include "rest_client.hpp"
 #include <iostream>
 #include <nlohmann/json.hpp>
 #include "websocket_client.hpp"
+#include "connection_pool.hpp"
+#include "endpoints.hpp"
+#include "instruments.hpp"
+#include "risk_gate.hpp"
+#include "rate_limiter.hpp"
+#include "threading.hpp"
 #include "websocket_server.hpp"
 #include <thread>
 #include <chrono>
+#include <cstdio>
+#include <cstdlib>
 
 using json = nlohmann::json;
 
@@ -17,25 +24,106 @@ int main() {
     std::string client_id = "0uXsIP-O";
     std::string client_secret = "pq2Hswet8WhwSnLcdaAhyiLCz3gnbDj05OMKWdpM4w0";
 
-    std::string token = get_access_token(client_id, client_secret);
-    std::cout << "Access Token: " << token << "\n";
+    // Tick sizes and lots for up-front price rounding. Loaded before any other
+    // thread starts; the gateway still runs without it, just unrounded.
+    try {
+        getInstrumentCache().load("any");
+    } catch (const std::exception& e) {
+        std::cerr << "Instrument metadata unavailable: " << e.what() << "\n";
+    }
+
+    // DERIBIT_RISK_LIMITS=<file> preloads the pre-trade limits; without it
+    // only the kill switch applies.
+    if (const char* limits = std::getenv("DERIBIT_RISK_LIMITS")) {
+        try {
+            getRiskGate().load(limits);
+        } catch (const std::exception& e) {
+            std::cerr << "Risk limits not loaded: " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    // Credit budgets default to Deribit's published limits; see rate_limiter.hpp.
+    try {
+        getRateLimiter().configure_from_env();
+    } catch (const std::exception& e) {
+        std::cerr << "Credit limits not set: " << e.what() << "\n";
+        return 1;
+    }
+
+    // DERIBIT_THREADS=<file> pins threads, sets real-time priority and
+    // switches event loops to busy polling; format at the end of this file.
+    if (const char* threads = std::getenv("DERIBIT_THREADS")) {
+        try {
+            getThreadingConfig().load(threads);
+        } catch (const std::exception& e) {
+            std::cerr << "Thread config not loaded: " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    // DERIBIT_BOOK_INTERVALS picks the Deribit book channel per instrument,
+    // e.g. "100ms,BTC-PERPETUAL=raw"; 100ms for everything by default.
+    if (const char* intervals = std::getenv("DERIBIT_BOOK_INTERVALS")) {
+        try {
+            getBookChannelConfig().configure(intervals);
+        } catch (const std::exception& e) {
+            std::cerr << "DERIBIT_BOOK_INTERVALS: " << e.what() << "\n";
+            return 1;
+        }
+    }
 
-    WebSocketClient ws_client;
     WebSocketServer ws_server;
-    g_ws_client = &ws_client;
     g_ws_server = &ws_server;
 
-    // Connect the WS client to Deribit
-    std::thread deribitThread([&ws_client]() {
-        ws_client.connect("wss://test.deribit.com/ws/api/v2");
-    });
-    ws_client.access_token_ = token;
+    // DERIBIT_FANOUT_LIMITS=<conflate>:<resume>:<disconnect>, bytes queued per
+    // downstream client; defaults 1 MiB, 256 KiB and 32 MiB.
+    if (const char* limits = std::getenv("DERIBIT_FANOUT_LIMITS")) {
+        unsigned long long conflate = 0, resume = 0, disconnect = 0;
+        if (std::sscanf(limits, "%llu:%llu:%llu", &conflate, &resume, &disconnect) != 3 || resume > conflate) {
+            std::cerr << "DERIBIT_FANOUT_LIMITS must be <conflate>:<resume>:<disconnect> with resume <= conflate\n";
+            return 1;
+        }
+        ws_server.set_backpressure(BackpressureLimits{static_cast<size_t>(conflate), static_cast<size_t>(resume),
+                                                      static_cast<size_t>(disconnect)});
+    }
+
+    // DERIBIT_OPERATOR_SECRET lets a downstream connection authorize as an
+    // operator and use the kill switch; without it nobody can.
+    if (const char* secret = std::getenv("DERIBIT_OPERATOR_SECRET")) {
+        ws_server.set_operator_secret(secret);
+    }
+
+    // One order-entry session plus DERIBIT_MD_CONNECTIONS market-data
+    // connections (default 1), instruments sharded across them.
+    size_t shards = 1;
+    if (const char* connections = std::getenv("DERIBIT_MD_CONNECTIONS")) {
+        shards = std::strtoul(connections, nullptr, 10);
+    }
+    ConnectionPool& pool = getConnectionPool();
+    try {
+        pool.configure(shards, &ws_server);
+    } catch (const std::exception& e) {
+        std::cerr << "DERIBIT_MD_CONNECTIONS: " << e.what() << "\n";
+        return 1;
+    }
+    g_ws_client = &pool.orders();
+
+    // DERIBIT_CAPTURE=<prefix> records every inbound frame for later replay.
+    if (const char* capture = std::getenv("DERIBIT_CAPTURE")) {
+        pool.start_capture(capture);
+    }
+
+    // Each connection authenticates its session once connected, off the order
+    // path; the order session then subscribes to the private order and trade
+    // streams.
+    pool.connect(ws_url(), client_id, client_secret);
     // Create and run your WS server (for external clients)
-    std::thread serverThread([&ws_server]() {
+    std::thread serverThread = getThreadingConfig().spawn(ThreadRole::SERVER_IO, [&ws_server]() {
         ws_server.run(9002);  // Your server will listen on port 9002.
     });
 
-    deribitThread.join();
+    pool.join();
     serverThread.join();
 
     return 0;
@@ -50,6 +138,30 @@ For Subscribing to Orderbook -
 }
 
 
+Adding "format": "binary" switches the connection to the compact binary
+protocol in binary_protocol.hpp for book, ticker and trades updates and order
+acknowledgements; "format": "json" switches it back:
+
+{
+  "action": "subscribe",
+  "instrument": "BTC-PERPETUAL",
+  "format": "binary"
+}
+
+
+"depth" (top N levels per side) and "interval_ms" (at most one update per
+interval) give the client its own view of the local book on channel
+book.<instrument>.<depth or full>.<interval>ms: a snapshot first, then only
+levels that changed inside the window. Subscribing again changes the view:
+
+{
+  "action": "subscribe",
+  "instrument": "BTC-PERPETUAL",
+  "depth": 5,
+  "interval_ms": 250
+}
+
+
 For Unsubscribing to Orderbook - 
 
 {
@@ -69,6 +181,16 @@ For Placing an Order -
 }
 
 
+Every order, cancel and edit the gateway sends on is answered at once with
+the JSON-RPC id it went to Deribit with; Deribit's response, and
+WireOrderAck::request_id for binary clients, carry the same id -
+
+{
+  "action": "place_order",
+  "request_id": 42
+}
+
+
 For Cancelling an Order - 
 
 {
@@ -77,6 +199,20 @@ For Cancelling an Order -
 }
 
 
+Limit and market orders may carry integer ticks and lots instead of decimals
+(price = price_ticks * tick_size, amount = amount_lots * min_trade_amount).
+A limit order without "price" or "price_ticks" is rejected:
+
+{
+  "action": "place_order",
+  "instrument": "BTC-PERPETUAL",
+  "amount_lots": 1,
+  "direction": "buy",
+  "order_type": "limit",
+  "price_ticks": 128000
+}
+
+
 For Modifying an Order - 
 
 {
@@ -86,6 +222,16 @@ For Modifying an Order -
   "new_price": 31000.0
 }
 
+Adding "instrument" enables rounding and "new_amount_lots" / "new_price_ticks".
+
+
+For an Instrument's Tick Size and Lot - 
+
+{
+  "action": "get_instrument",
+  "instrument": "BTC-PERPETUAL"
+}
+
 
 For Getting Positions - 
 
@@ -94,4 +240,95 @@ For Getting Positions -
 }
 
 
+Answered locally from the user.orders / user.trades streams -
+
+{
+  "action": "get_open_orders",
+  "instrument": "BTC-PERPETUAL"
+}
+
+{
+  "action": "get_order",
+  "order_id": "order_id_here"
+}
+
+{
+  "action": "get_fills",
+  "instrument": "BTC-PERPETUAL",
+  "order_id": "order_id_here",
+  "count": 100
+}
+
+"instrument" and "order_id" are optional filters. Cancels and edits of
+orders already known to be finished are rejected without a round trip.
+
+
+Orders and edits pass the pre-trade risk gate first. The kill switch
+rejects every new order and cancels all open ones; "engaged": false
+releases it. Only an operator session may use it, one that has first sent
+the secret from DERIBIT_OPERATOR_SECRET -
+
+{
+  "action": "authorize",
+  "secret": "operator_secret_here"
+}
+
+{
+  "action": "kill_switch",
+  "engaged": true
+}
+
+Limits come from DERIBIT_RISK_LIMITS, a key = value file:
+
+max_order_amount = 100000
+max_notional = 1000000
+price_band_bps = 200
+max_position = 500000
+max_orders_per_second = 50
+BTC-PERPETUAL.max_position = 1000000
+
+Positions and open orders are loaded from the account once the order
+session authenticates; until then a position limit rejects every order.
+Price bands and market order notionals are checked against the mid of the
+local book, which needs a live subscription to the instrument; without one
+those orders are rejected.
+
+
+Outbound requests are paced against a local copy of the Deribit credit
+budget. Cancels go first, then orders and edits, then subscriptions, then
+queries; queries that cannot get credit within a second are answered with
+error 10028 locally. Override the budgets with
+
+DERIBIT_CREDITS_MATCHING=<max_credits>:<refill_per_second>:<cost>
+DERIBIT_CREDITS_NON_MATCHING=<max_credits>:<refill_per_second>:<cost>
+
+and watch them under "credits" in get_stats.
+
+
+A downstream client whose send queue passes the conflate threshold of
+DERIBIT_FANOUT_LIMITS gets only the newest ticker and trades message per
+instrument, and a fresh book snapshot instead of the deltas it missed, until
+its queue drains; past the disconnect threshold it is closed. get_stats lists
+per-client "buffered", "lag_ms", "conflated" and "conflations", plus
+"slow_disconnects".
+
+
+DERIBIT_THREADS names a key = value file of per-thread settings. Threads are
+deribit_ingress (one per market-data connection), order_egress, fanout and
+server_io; cpu pins, rt_priority selects SCHED_FIFO (needs CAP_SYS_NICE) and
+busy_poll spins instead of sleeping. Market-data connection n is pinned to
+deribit_ingress.cpu + n. Give busy-polling threads a core each:
+
+order_egress.cpu = 1
+order_egress.busy_poll = true
+deribit_ingress.cpu = 2
+deribit_ingress.busy_poll = true
+fanout.cpu = 4
+fanout.busy_poll = true
+server_io.cpu = 5
+server_io.rt_priority = 10
+
+With DERIBIT_MD_CONNECTIONS=2 the two market-data threads take cores 2 and 3.
+
+
 */
\ No newline at end of file
@@ -0,0 +1,232 @@
+#include "matching_engine.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Amounts and prices compared after arithmetic get a little slack.
+const double kEpsilon = 1e-9;
+
+} // namespace
+
+MatchingEngine::MatchingEngine(const std::string& instrument, double tick_size, uint64_t id_base)
+    : instrument_(instrument), tick_size_(tick_size), next_order_id_(id_base + 1), next_trade_id_(id_base + 1) {}
+
+double MatchingEngine::round_to_tick(double price) const {
+    return std::round(price / tick_size_) * tick_size_;
+}
+
+MockOrder MatchingEngine::submit(uint32_t account, bool buy, bool market, double price, double amount,
+                                 const std::string& label, uint64_t now_ms, std::vector<MockFill>& fills) {
+    uint64_t id = next_order_id_++;
+    Resting& entry = orders_[id];
+    MockOrder& order = entry.order;
+    order.id = id;
+    order.account = account;
+    order.buy = buy;
+    order.market = market;
+    order.price = market ? 0.0 : round_to_tick(price);
+    order.amount = amount;
+    order.label = label;
+    order.created_ms = now_ms;
+    order.updated_ms = now_ms;
+    changed_ = false;
+
+    match(entry, now_ms, fills);
+
+    MockOrder result;
+    if (order.remaining() <= kEpsilon) {
+        result = finish(id, MockOrderState::FILLED, now_ms);
+    } else if (market) {
+        result = finish(id, MockOrderState::CANCELLED, now_ms);
+    } else {
+        rest(entry);
+        result = entry.order;
+    }
+    if (changed_) ++change_id_;
+    return result;
+}
+
+bool MatchingEngine::cancel(uint64_t order_id, uint32_t account, uint64_t now_ms, MockOrder& result) {
+    auto it = orders_.find(order_id);
+    if (it == orders_.end() || it->second.order.account != account ||
+        it->second.order.state != MockOrderState::OPEN) {
+        return false;
+    }
+    changed_ = false;
+    unrest(it->second);
+    result = finish(order_id, MockOrderState::CANCELLED, now_ms);
+    if (changed_) ++change_id_;
+    return true;
+}
+
+bool MatchingEngine::edit(uint64_t order_id, uint32_t account, double amount, double price,
+                          uint64_t now_ms, std::vector<MockFill>& fills, MockOrder& result) {
+    auto it = orders_.find(order_id);
+    if (it == orders_.end() || it->second.order.account != account ||
+        it->second.order.state != MockOrderState::OPEN) {
+        return false;
+    }
+    Resting& entry = it->second;
+    MockOrder& order = entry.order;
+    double new_price = round_to_tick(price);
+    changed_ = false;
+    order.updated_ms = now_ms;
+
+    if (amount <= order.filled + kEpsilon) {
+        unrest(entry);
+        order.amount = order.filled;
+        result = finish(order_id, order.filled > 0.0 ? MockOrderState::FILLED : MockOrderState::CANCELLED, now_ms);
+    } else if (std::fabs(new_price - order.price) < kEpsilon && amount <= order.amount) {
+        // Same price, smaller size: shrink in place and keep the queue position.
+        Side& side = order.buy ? bids_ : asks_;
+        side[order.price].total -= order.amount - amount;
+        order.amount = amount;
+        record_change(order.buy, order.price);
+        result = order;
+    } else {
+        // Anything else goes to the back of the queue and may trade.
+        unrest(entry);
+        order.amount = amount;
+        order.price = new_price;
+        match(entry, now_ms, fills);
+        if (order.remaining() <= kEpsilon) {
+            result = finish(order_id, MockOrderState::FILLED, now_ms);
+        } else {
+            rest(entry);
+            result = entry.order;
+        }
+    }
+    if (changed_) ++change_id_;
+    return true;
+}
+
+const MockOrder* MatchingEngine::find(uint64_t order_id) const {
+    auto it = orders_.find(order_id);
+    return it == orders_.end() ? nullptr : &it->second.order;
+}
+
+void MatchingEngine::match(Resting& taker, uint64_t now_ms, std::vector<MockFill>& fills) {
+    MockOrder& order = taker.order;
+    Side& book = order.buy ? asks_ : bids_;
+
+    while (order.remaining() > kEpsilon && !book.empty()) {
+        auto level_it = order.buy ? book.begin() : std::prev(book.end());
+        double level_price = level_it->first;
+        if (!order.market && (order.buy ? level_price > order.price + kEpsilon
+                                        : level_price < order.price - kEpsilon)) {
+            break;
+        }
+
+        Level& level = level_it->second;
+        while (order.remaining() > kEpsilon && !level.queue.empty()) {
+            uint64_t maker_id = level.queue.front();
+            MockOrder& maker = orders_[maker_id].order;
+            double quantity = std::min(order.remaining(), maker.remaining());
+
+            maker.filled += quantity;
+            maker.filled_notional += quantity * level_price;
+            maker.updated_ms = now_ms;
+            order.filled += quantity;
+            order.filled_notional += quantity * level_price;
+            level.total -= quantity;
+            last_price_ = level_price;
+
+            fills.push_back(MockFill{next_trade_id_++, maker_id, order.id, maker.account, order.account,
+                                     order.buy, level_price, quantity, now_ms});
+
+            if (maker.remaining() <= kEpsilon) {
+                level.queue.pop_front();
+                orders_[maker_id].resting = false;
+                finish(maker_id, MockOrderState::FILLED, now_ms);
+            }
+        }
+        if (level.queue.empty()) {
+            book.erase(level_it);
+        }
+        record_change(!order.buy, level_price);
+    }
+}
+
+void MatchingEngine::rest(Resting& entry) {
+    MockOrder& order = entry.order;
+    Level& level = (order.buy ? bids_ : asks_)[order.price];
+    level.total += order.remaining();
+    entry.position = level.queue.insert(level.queue.end(), order.id);
+    entry.resting = true;
+    record_change(order.buy, order.price);
+}
+
+void MatchingEngine::unrest(Resting& entry) {
+    if (!entry.resting) return;
+    MockOrder& order = entry.order;
+    Side& side = order.buy ? bids_ : asks_;
+    auto level_it = side.find(order.price);
+    if (level_it != side.end()) {
+        level_it->second.total -= order.remaining();
+        level_it->second.queue.erase(entry.position);
+        if (level_it->second.queue.empty()) {
+            side.erase(level_it);
+        }
+    }
+    entry.resting = false;
+    record_change(order.buy, order.price);
+}
+
+MockOrder MatchingEngine::finish(uint64_t order_id, MockOrderState state, uint64_t now_ms) {
+    auto it = orders_.find(order_id);
+    MockOrder& order = it->second.order;
+    order.state = state;
+    order.updated_ms = now_ms;
+    MockOrder result = order;
+    if (order.account == transient_account_) {
+        orders_.erase(it);
+    }
+    return result;
+}
+
+void MatchingEngine::record_change(bool bid, double price) {
+    const Side& side = bid ? bids_ : asks_;
+    auto it = side.find(price);
+    double amount = it == side.end() ? 0.0 : std::max(0.0, it->second.total);
+    changes_.push_back(MockLevelChange{bid, price, amount});
+    changed_ = true;
+}
+
+void MatchingEngine::take_changes(std::vector<MockLevelChange>& out) {
+    out.insert(out.end(), changes_.begin(), changes_.end());
+    changes_.clear();
+}
+
+void MatchingEngine::levels(bool bid, size_t depth, std::vector<std::pair<double, double>>& out) const {
+    out.clear();
+    const Side& side = bid ? bids_ : asks_;
+    if (bid) {
+        for (auto it = side.rbegin(); it != side.rend() && (depth == 0 || out.size() < depth); ++it) {
+            out.emplace_back(it->first, it->second.total);
+        }
+    } else {
+        for (auto it = side.begin(); it != side.end() && (depth == 0 || out.size() < depth); ++it) {
+            out.emplace_back(it->first, it->second.total);
+        }
+    }
+}
+
+size_t MatchingEngine::resting_orders(bool bid) const {
+    size_t count = 0;
+    for (const auto& level : bid ? bids_ : asks_) {
+        count += level.second.queue.size();
+    }
+    return count;
+}
+
+void MatchingEngine::open_orders(uint32_t account, std::vector<MockOrder>& out) const {
+    size_t first = out.size();
+    for (const auto& entry : orders_) {
+        if (entry.second.resting && entry.second.order.account == account) {
+            out.push_back(entry.second.order);
+        }
+    }
+    std::sort(out.begin() + first, out.end(),
+              [](const MockOrder& a, const MockOrder& b) { return a.id < b.id; });
+}
@@ -0,0 +1,498 @@
+#include "websocket_client.hpp"
+#include "websocket_server.hpp"
+#include "notification_parser.hpp"
+#include "binary_protocol.hpp"
+#include "book_view.hpp"
+#include "order_book.hpp"
+#include "instruments.hpp"
+#include "order_encoder.hpp"
+#include "order_manager.hpp"
+#include "risk_gate.hpp"
+#include "rate_limiter.hpp"
+#include "rest_client.hpp"
+#include "tracker.hpp"
+#include <benchmark/benchmark.h>
+#include <websocketpp/config/asio_no_tls_client.hpp>
+#include <websocketpp/client.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+WebSocketClient* g_ws_client = nullptr;
+WebSocketServer* g_ws_server = nullptr;
+
+// Google Benchmark suite for the hot paths, each measured in isolation with
+// no exchange connection. For regression tracking between releases, keep the
+// JSON output:
+//
+//   microbench --benchmark_out=bench.json --benchmark_out_format=json
+//
+// and compare two runs with tools/compare.py from Google Benchmark.
+
+namespace {
+
+const char* kInstrument = "BTC-PERPETUAL";
+
+std::string make_book(bool snapshot, int levels) {
+    std::string frame = "{\"jsonrpc\":\"2.0\",\"method\":\"subscription\",\"params\":{\"channel\":\"book.BTC-PERPETUAL.100ms\","
+                        "\"data\":{\"type\":\"";
+    frame += snapshot ? "snapshot" : "change";
+    frame += "\",\"timestamp\":1712345678901,\"prev_change_id\":68371981230,\"instrument_name\":\"BTC-PERPETUAL\","
+             "\"change_id\":68371981231,\"bids\":[";
+    for (int i = 0; i < levels; ++i) {
+        if (i) frame += ",";
+        frame += "[\"" + std::string(snapshot ? "new" : "change") + "\"," + std::to_string(64250 - i) + ".5,"
+               + std::to_string(1000 + i * 10) + ".0]";
+    }
+    frame += "],\"asks\":[";
+    for (int i = 0; i < levels; ++i) {
+        if (i) frame += ",";
+        frame += "[\"" + std::string(snapshot ? "new" : "change") + "\"," + std::to_string(64251 + i) + ".0,"
+               + std::to_string(2000 + i * 10) + ".0]";
+    }
+    frame += "]}}}";
+    return frame;
+}
+
+const char* kTicker =
+    "{\"jsonrpc\":\"2.0\",\"method\":\"subscription\",\"params\":{\"channel\":\"ticker.BTC-PERPETUAL.100ms\","
+    "\"data\":{\"timestamp\":1712345678901,\"stats\":{\"volume_usd\":123456789.0,\"volume\":1923.5,\"price_change\":1.25,"
+    "\"low\":63000.0,\"high\":65000.5},\"state\":\"open\",\"settlement_price\":64000.12,\"open_interest\":987654321,"
+    "\"min_price\":63290.5,\"max_price\":65210.0,\"mark_price\":64250.73,\"last_price\":64251.0,"
+    "\"instrument_name\":\"BTC-PERPETUAL\",\"index_price\":64230.11,\"funding_8h\":0.0001,\"current_funding\":0.0,"
+    "\"best_bid_price\":64250.5,\"best_bid_amount\":12340.0,\"best_ask_price\":64251.0,\"best_ask_amount\":5600.0}}}";
+
+const char* kTrades =
+    "{\"jsonrpc\":\"2.0\",\"method\":\"subscription\",\"params\":{\"channel\":\"trades.BTC-PERPETUAL.100ms\","
+    "\"data\":[{\"trade_seq\":30289432,\"trade_id\":\"48079254\",\"timestamp\":1712345678901,\"tick_direction\":0,"
+    "\"price\":64251.0,\"mark_price\":64250.73,\"instrument_name\":\"BTC-PERPETUAL\",\"index_price\":64230.11,"
+    "\"direction\":\"buy\",\"amount\":120.0}]}}";
+
+// ---- Outbound order requests ----------------------------------------------
+
+void BM_BuildPlaceOrder(benchmark::State& state) {
+    uint64_t id = 1;
+    for (auto _ : state) {
+        std::string request = WebSocketClient::build_place_order(id++, kInstrument, 10.0, "buy", "limit", 64250.5);
+        benchmark::DoNotOptimize(request.data());
+    }
+}
+BENCHMARK(BM_BuildPlaceOrder);
+
+void BM_BuildCancelOrder(benchmark::State& state) {
+    uint64_t id = 1;
+    for (auto _ : state) {
+        std::string request = WebSocketClient::build_cancel_order(id++, "USDC-1234567890");
+        benchmark::DoNotOptimize(request.data());
+    }
+}
+BENCHMARK(BM_BuildCancelOrder);
+
+void BM_BuildModifyOrder(benchmark::State& state) {
+    uint64_t id = 1;
+    for (auto _ : state) {
+        std::string request = WebSocketClient::build_modify_order(id++, "USDC-1234567890", 20.0, 64251.0);
+        benchmark::DoNotOptimize(request.data());
+    }
+}
+BENCHMARK(BM_BuildModifyOrder);
+
+void BM_EncodePlaceOrder(benchmark::State& state) {
+    OrderEncoder encoder;
+    const std::string instrument = kInstrument;
+    uint64_t id = 1;
+    for (auto _ : state) {
+        StrRef request = encoder.place_order(id++, OrderSide::BUY, OrderType::LIMIT, instrument, 10.0, 64250.5);
+        benchmark::DoNotOptimize(request.data);
+    }
+}
+BENCHMARK(BM_EncodePlaceOrder);
+
+void BM_EncodePlaceOrderFixed(benchmark::State& state) {
+    InstrumentSpec spec;
+    spec.name = kInstrument;
+    spec.tick_size = 0.5;
+    spec.min_trade_amount = 10.0;
+    spec.tick_e8 = 50000000;
+    spec.lot_e8 = 1000000000;
+    OrderEncoder encoder;
+    uint64_t id = 1;
+    for (auto _ : state) {
+        StrRef request = encoder.place_order(id++, OrderSide::BUY, OrderType::LIMIT, spec, Qty{1}, Price{128501});
+        benchmark::DoNotOptimize(request.data);
+    }
+}
+BENCHMARK(BM_EncodePlaceOrderFixed);
+
+void BM_EncodeCancelOrder(benchmark::State& state) {
+    OrderEncoder encoder;
+    const std::string order_id = "USDC-1234567890";
+    uint64_t id = 1;
+    for (auto _ : state) {
+        StrRef request = encoder.cancel_order(id++, order_id);
+        benchmark::DoNotOptimize(request.data);
+    }
+}
+BENCHMARK(BM_EncodeCancelOrder);
+
+void BM_EncodeModifyOrder(benchmark::State& state) {
+    OrderEncoder encoder;
+    const std::string order_id = "USDC-1234567890";
+    uint64_t id = 1;
+    for (auto _ : state) {
+        StrRef request = encoder.modify_order(id++, order_id, 20.0, 64251.0);
+        benchmark::DoNotOptimize(request.data);
+    }
+}
+BENCHMARK(BM_EncodeModifyOrder);
+
+void BM_FormatDecimal(benchmark::State& state) {
+    char digits[32];
+    double value = 64250.5;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(format_decimal(value, digits));
+        value += 0.5;
+    }
+}
+BENCHMARK(BM_FormatDecimal);
+
+// ---- Inbound notifications ------------------------------------------------
+
+// Classification and channel/instrument extraction only; levels are not walked.
+void BM_ParseNotificationHeader(benchmark::State& state) {
+    std::string frame = make_book(false, static_cast<int>(state.range(0)));
+    Notification note;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parse_notification(frame.data(), frame.size(), note));
+        benchmark::DoNotOptimize(note.instrument.size);
+    }
+    state.SetBytesProcessed(state.iterations() * frame.size());
+}
+BENCHMARK(BM_ParseNotificationHeader)->Arg(1)->Arg(10)->Arg(50);
+
+void BM_ParseBookLevels(benchmark::State& state) {
+    std::string frame = make_book(state.range(1) != 0, static_cast<int>(state.range(0)));
+    Notification note;
+    for (auto _ : state) {
+        parse_notification(frame.data(), frame.size(), note);
+        double checksum = 0.0;
+        BookLevel level;
+        for (LevelCursor bids(note.book.bids); bids.next(level);) checksum += level.price + level.amount;
+        for (LevelCursor asks(note.book.asks); asks.next(level);) checksum += level.price + level.amount;
+        benchmark::DoNotOptimize(checksum);
+    }
+    state.SetBytesProcessed(state.iterations() * frame.size());
+}
+BENCHMARK(BM_ParseBookLevels)->Args({1, 0})->Args({10, 0})->Args({50, 1})->Args({500, 1});
+
+void BM_ParseTicker(benchmark::State& state) {
+    size_t size = std::strlen(kTicker);
+    Notification note;
+    for (auto _ : state) {
+        parse_notification(kTicker, size, note);
+        benchmark::DoNotOptimize(note.ticker.best_bid_price);
+    }
+}
+BENCHMARK(BM_ParseTicker);
+
+void BM_ParseTrades(benchmark::State& state) {
+    size_t size = std::strlen(kTrades);
+    Notification note;
+    for (auto _ : state) {
+        parse_notification(kTrades, size, note);
+        Trade trade;
+        for (TradeCursor trades(note.data); trades.next(trade);) {
+            benchmark::DoNotOptimize(trade.price);
+        }
+    }
+}
+BENCHMARK(BM_ParseTrades);
+
+// A top-N view re-reading a 100-level book after one change inside its window.
+void BM_BookViewRefresh(benchmark::State& state) {
+    uint32_t id = getInstrumentRegistry().intern("BENCH-VIEW");
+    OrderBookStore::Entry& entry = *getOrderBookStore().get_or_create(id);
+    entry.book.begin_snapshot(1, 0);
+    for (int i = 0; i < 100; ++i) {
+        entry.book.add_snapshot_level(OrderBook::BID, 50000.0 - i, 1.0);
+        entry.book.add_snapshot_level(OrderBook::ASK, 50001.0 + i, 1.0);
+    }
+    entry.book.end_snapshot();
+    BookView view(id, static_cast<size_t>(state.range(0)), 0, 1);
+    int64_t change_id = 1;
+    for (auto _ : state) {
+        entry.book.begin_delta(change_id, change_id + 1, 0);
+        entry.book.apply_level(OrderBook::BID, 50000.0, static_cast<double>(change_id % 7 + 1));
+        ++change_id;
+        benchmark::DoNotOptimize(view.refresh(entry));
+    }
+}
+BENCHMARK(BM_BookViewRefresh)->Arg(1)->Arg(5)->Arg(20);
+
+// JSON notification to a binary downstream frame, once per event per fan-out.
+// Bytes are the JSON input; a 10-level delta encodes to about a third of it.
+void BM_EncodeWireBook(benchmark::State& state) {
+    std::string frame = make_book(false, static_cast<int>(state.range(0)));
+    std::string wire;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(encode_wire_notification(1, frame, wire));
+    }
+    state.SetBytesProcessed(state.iterations() * frame.size());
+}
+BENCHMARK(BM_EncodeWireBook)->Arg(1)->Arg(10)->Arg(50);
+
+// Name to id on every inbound notification.
+void BM_RegistryFind(benchmark::State& state) {
+    InstrumentRegistry& registry = getInstrumentRegistry();
+    for (int i = 0; i < state.range(0); ++i) {
+        registry.intern("BTC-" + std::to_string(i));
+    }
+    registry.intern(kInstrument);
+    StrRef name{kInstrument, std::strlen(kInstrument)};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(registry.find(name));
+    }
+}
+BENCHMARK(BM_RegistryFind)->Arg(10)->Arg(5000);
+
+// ---- Order state --------------------------------------------------------------
+
+// One user.orders notification: parse, look up by order id, update in place.
+void BM_OrderUpdate(benchmark::State& state) {
+    static const char kFrame[] =
+        "{\"jsonrpc\":\"2.0\",\"method\":\"subscription\",\"params\":{\"channel\":\"user.orders.any.any.raw\","
+        "\"data\":{\"order_id\":\"31337\",\"order_state\":\"open\",\"order_type\":\"limit\","
+        "\"direction\":\"buy\",\"instrument_name\":\"BTC-PERPETUAL\",\"price\":64250.5,\"amount\":100.0,"
+        "\"filled_amount\":20.0,\"average_price\":64250.5,\"label\":\"bench\","
+        "\"creation_timestamp\":1700000000000,\"last_update_timestamp\":1700000000000}}}";
+    OrderManager& orders = getOrderManager();
+    Notification note;
+    for (auto _ : state) {
+        parse_notification(kFrame, sizeof(kFrame) - 1, note);
+        orders.on_notification(note);
+    }
+}
+BENCHMARK(BM_OrderUpdate);
+
+// get_open_orders for one instrument with N resting orders.
+void BM_OpenOrders(benchmark::State& state) {
+    OrderManager& orders = getOrderManager();
+    std::string id;
+    for (int i = 0; i < state.range(0); ++i) {
+        id = "open-" + std::to_string(i);
+        OrderUpdate update = OrderUpdate();
+        update.order_id = StrRef{id.data(), id.size()};
+        update.instrument = StrRef{"ETH-PERPETUAL", 13};
+        update.order_state = StrRef{"open", 4};
+        update.amount = 1.0;
+        orders.apply_order(update);
+    }
+    uint32_t instrument = getInstrumentRegistry().find(std::string("ETH-PERPETUAL"));
+    std::vector<OrderRecord> out;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(orders.open_orders(instrument, out));
+    }
+}
+BENCHMARK(BM_OpenOrders)->Arg(10)->Arg(1000);
+
+// Full pre-trade check with every limit enabled, including its own timing.
+void BM_RiskCheck(benchmark::State& state) {
+    RiskGate& gate = getRiskGate();
+    uint32_t instrument = getInstrumentRegistry().intern(kInstrument);
+    RiskLimits limits;
+    limits.max_order_amount = 1e9;
+    limits.max_notional = 1e15;
+    limits.price_band_bps = 500;
+    limits.max_position = 1e12;
+    gate.set_limits(instrument, limits);
+    gate.set_mid(instrument, 64250.0);
+    gate.set_exposure_loaded(true);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(gate.check(1, instrument, OrderSide::BUY, 100.0, 64250.5));
+    }
+}
+BENCHMARK(BM_RiskCheck);
+
+// The credit check every outbound request pays. The budget is sized so the
+// bucket never runs dry and the CAS always succeeds.
+void BM_CreditAcquire(benchmark::State& state) {
+    RateLimiter limiter;
+    limiter.configure(RequestClass::MATCHING, CreditPolicy{1, 1000000000, 1000000000});
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(limiter.try_acquire(RequestClass::MATCHING));
+    }
+}
+BENCHMARK(BM_CreditAcquire);
+
+// ---- Downstream fan-out ---------------------------------------------------
+
+// A WebSocketServer on loopback with N plain WebSocket clients subscribed to
+// one instrument. Measures broadcast() on the calling thread: framing once and
+// queueing the frame on every connection. Timing pauses every kDrainBatch
+// messages until the clients have read everything, so write queues stay short.
+class FanoutFixture {
+public:
+    typedef websocketpp::client<websocketpp::config::asio_client> client;
+
+    static const int kDrainBatch = 256;
+
+    // Every fixture listens on a fresh port so a previous run's TIME_WAIT
+    // sockets cannot make the bind fail.
+    explicit FanoutFixture(int subscribers) : subscribers_(subscribers), port_(next_port_++) {
+        server_thread_ = std::thread([this]() { server_.run(port_); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        client_.clear_access_channels(websocketpp::log::alevel::all);
+        client_.init_asio();
+        client_.set_open_handler([this](websocketpp::connection_hdl hdl) {
+            client_.send(hdl, std::string("{\"action\":\"subscribe\",\"instrument\":\"") + kInstrument + "\"}",
+                         websocketpp::frame::opcode::text);
+            ++opened_;
+        });
+        client_.set_message_handler([this](websocketpp::connection_hdl, client::message_ptr) {
+            received_.fetch_add(1, std::memory_order_relaxed);
+        });
+        for (int i = 0; i < subscribers_; ++i) {
+            websocketpp::lib::error_code ec;
+            client::connection_ptr con = client_.get_connection("ws://127.0.0.1:" + std::to_string(port_), ec);
+            if (!ec) client_.connect(con);
+        }
+        client_thread_ = std::thread([this]() { client_.run(); });
+        while (opened_ < subscribers_) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        // Let the subscribe messages land.
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+
+    ~FanoutFixture() {
+        client_.stop();
+        server_.stop();
+        client_thread_.join();
+        server_thread_.join();
+    }
+
+    void broadcast(const std::string& message) {
+        server_.broadcast(kInstrument, message);
+        ++sent_;
+    }
+
+    void drain() {
+        uint64_t expected = sent_ * static_cast<uint64_t>(subscribers_);
+        while (received_.load(std::memory_order_relaxed) < expected) {
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    static uint16_t next_port_;
+
+    int subscribers_;
+    uint16_t port_;
+    WebSocketServer server_;
+    client client_;
+    std::thread server_thread_;
+    std::thread client_thread_;
+    std::atomic<int> opened_{0};
+    std::atomic<uint64_t> received_{0};
+    uint64_t sent_{0};
+};
+
+uint16_t FanoutFixture::next_port_ = 18765;
+
+void BM_Broadcast(benchmark::State& state) {
+    std::unique_ptr<FanoutFixture> fixture(new FanoutFixture(static_cast<int>(state.range(0))));
+    std::string message = make_book(false, 10);
+    int batch = 0;
+    for (auto _ : state) {
+        fixture->broadcast(message);
+        if (++batch == FanoutFixture::kDrainBatch) {
+            state.PauseTiming();
+            fixture->drain();
+            batch = 0;
+            state.ResumeTiming();
+        }
+    }
+    state.PauseTiming();
+    fixture->drain();
+    state.ResumeTiming();
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Broadcast)->Arg(1)->Arg(10)->Arg(100)->UseRealTime();
+
+// ---- Latency tracking -----------------------------------------------------
+
+void BM_LatencyClockNow(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(LatencyClock::now());
+    }
+}
+BENCHMARK(BM_LatencyClockNow);
+
+void BM_LatencyStartStop(benchmark::State& state) {
+    LatencyTracker& tracker = getLatencyTracker();
+    for (auto _ : state) {
+        tracker.start_measurement(LatencyTracker::MARKET_DATA_PROCESSING);
+        tracker.stop_measurement(LatencyTracker::MARKET_DATA_PROCESSING);
+    }
+}
+BENCHMARK(BM_LatencyStartStop);
+
+void BM_LatencyStartStopKeyed(benchmark::State& state) {
+    LatencyTracker& tracker = getLatencyTracker();
+    const std::string key = "order-1234567890";
+    for (auto _ : state) {
+        tracker.start_measurement(LatencyTracker::ORDER_PLACEMENT, key);
+        tracker.stop_measurement(LatencyTracker::ORDER_PLACEMENT, key);
+    }
+}
+BENCHMARK(BM_LatencyStartStopKeyed);
+
+void BM_LatencyRecordSince(benchmark::State& state) {
+    LatencyTracker& tracker = getLatencyTracker();
+    for (auto _ : state) {
+        tracker.record_since(LatencyTracker::WEBSOCKET_MESSAGE_PROPAGATION, LatencyClock::now());
+    }
+}
+BENCHMARK(BM_LatencyRecordSince)->Threads(1)->Threads(4);
+
+// ---- REST URLs ------------------------------------------------------------
+
+void BM_PlaceOrderUrl(benchmark::State& state) {
+    for (auto _ : state) {
+        std::string url = place_order_url(kInstrument, 10.0, "buy", "limit", 64250.5);
+        benchmark::DoNotOptimize(url.data());
+    }
+}
+BENCHMARK(BM_PlaceOrderUrl);
+
+void BM_CancelOrderUrl(benchmark::State& state) {
+    for (auto _ : state) {
+        std::string url = cancel_order_url("USDC-1234567890");
+        benchmark::DoNotOptimize(url.data());
+    }
+}
+BENCHMARK(BM_CancelOrderUrl);
+
+void BM_ModifyOrderUrl(benchmark::State& state) {
+    for (auto _ : state) {
+        std::string url = modify_order_url("USDC-1234567890", 20.0, 64251.0);
+        benchmark::DoNotOptimize(url.data());
+    }
+}
+BENCHMARK(BM_ModifyOrderUrl);
+
+void BM_OrderBookUrl(benchmark::State& state) {
+    for (auto _ : state) {
+        std::string url = order_book_url(kInstrument, 10);
+        benchmark::DoNotOptimize(url.data());
+    }
+}
+BENCHMARK(BM_OrderBookUrl);
+
+} // namespace
+
+BENCHMARK_MAIN();
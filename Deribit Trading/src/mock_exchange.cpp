@@ -0,0 +1,887 @@
+#include "mock_exchange.hpp"
+#include "logger.hpp"
+#include <openssl/evp.h>
+#include <openssl/ec.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+using json = nlohmann::json;
+
+namespace {
+
+std::string url_decode(const std::string& in) {
+    std::string out;
+    out.reserve(in.size());
+    for (size_t i = 0; i < in.size(); ++i) {
+        if (in[i] == '+') {
+            out.push_back(' ');
+        } else if (in[i] == '%' && i + 2 < in.size()) {
+            out.push_back(static_cast<char>(std::strtol(in.substr(i + 1, 2).c_str(), nullptr, 16)));
+            i += 2;
+        } else {
+            out.push_back(in[i]);
+        }
+    }
+    return out;
+}
+
+// Query values stay strings; the number() and text() accessors accept either.
+json parse_query(const std::string& query) {
+    json params = json::object();
+    size_t start = 0;
+    while (start < query.size()) {
+        size_t end = query.find('&', start);
+        if (end == std::string::npos) end = query.size();
+        std::string pair = query.substr(start, end - start);
+        size_t eq = pair.find('=');
+        if (eq != std::string::npos) {
+            params[url_decode(pair.substr(0, eq))] = url_decode(pair.substr(eq + 1));
+        }
+        start = end + 1;
+    }
+    return params;
+}
+
+double number(const json& params, const char* key, double fallback = 0.0) {
+    auto it = params.find(key);
+    if (it == params.end()) return fallback;
+    if (it->is_number()) return it->get<double>();
+    if (it->is_string()) return std::atof(it->get<std::string>().c_str());
+    return fallback;
+}
+
+std::string text(const json& params, const char* key, const std::string& fallback = "") {
+    auto it = params.find(key);
+    if (it == params.end()) return fallback;
+    if (it->is_string()) return it->get<std::string>();
+    return it->dump();
+}
+
+const char* state_name(MockOrderState state) {
+    switch (state) {
+    case MockOrderState::OPEN: return "open";
+    case MockOrderState::FILLED: return "filled";
+    case MockOrderState::CANCELLED: return "cancelled";
+    }
+    return "open";
+}
+
+std::string random_token(std::mt19937& rng) {
+    static const char digits[] = "0123456789abcdef";
+    std::string token(32, '0');
+    for (char& c : token) c = digits[rng() & 15];
+    return token;
+}
+
+} // namespace
+
+const uint32_t MockExchange::kSyntheticAccount;
+const uint64_t MockExchange::kOrderIdStride;
+const int MockExchange::kChurnTickMs;
+const int MockExchange::kBookIntervalMs;
+
+MockExchange::MockExchange(const MockExchangeOptions& options)
+    : options_(options), rng_(options.seed) {
+    for (size_t i = 0; i < options_.instruments.size(); ++i) {
+        std::unique_ptr<Instrument> instrument(new Instrument());
+        instrument->name = options_.instruments[i];
+        instrument->engine.reset(new MatchingEngine(instrument->name, options_.tick_size, (i + 1) * kOrderIdStride));
+        instrument->engine->set_transient_account(kSyntheticAccount);
+        instrument->mid = options_.mid_price;
+        instruments_by_name_[instrument->name] = instrument.get();
+        instruments_.push_back(std::move(instrument));
+    }
+    for (auto& instrument : instruments_) {
+        seed_book(*instrument);
+    }
+    tls_context_ = make_tls_context();
+}
+
+void MockExchange::run() {
+    m_server.clear_access_channels(websocketpp::log::alevel::all);
+    m_server.init_asio();
+    m_server.set_reuse_addr(true);
+    m_server.set_tls_init_handler([this](connection_hdl) { return tls_context_; });
+    m_server.set_open_handler(std::bind(&MockExchange::on_open, this, std::placeholders::_1));
+    m_server.set_close_handler(std::bind(&MockExchange::on_close, this, std::placeholders::_1));
+    m_server.set_message_handler(std::bind(&MockExchange::on_message, this, std::placeholders::_1, std::placeholders::_2));
+    m_server.set_http_handler(std::bind(&MockExchange::on_http, this, std::placeholders::_1));
+
+    m_server.listen(options_.port);
+    m_server.start_accept();
+    schedule_churn();
+    schedule_book_flush();
+
+    LOG_INFO("[Mock] Exchange listening on port {} with {} instrument(s)", options_.port, instruments_.size());
+    m_server.run();
+}
+
+void MockExchange::stop() {
+    m_server.stop();
+}
+
+std::shared_ptr<asio::ssl::context> MockExchange::make_tls_context() {
+    auto ctx = std::make_shared<asio::ssl::context>(asio::ssl::context::tlsv12);
+    ctx->set_options(asio::ssl::context::default_workarounds | asio::ssl::context::no_sslv2 |
+                     asio::ssl::context::no_sslv3 | asio::ssl::context::single_dh_use);
+    if (!options_.cert_file.empty()) {
+        ctx->use_certificate_chain_file(options_.cert_file);
+        ctx->use_private_key_file(options_.key_file.empty() ? options_.cert_file : options_.key_file,
+                                  asio::ssl::context::pem);
+        return ctx;
+    }
+
+    // Throwaway P-256 key and self-signed certificate; clients run with
+    // DERIBIT_TLS_VERIFY=0 against it.
+    EVP_PKEY* key = nullptr;
+    EVP_PKEY_CTX* key_ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+    if (!key_ctx || EVP_PKEY_keygen_init(key_ctx) <= 0 ||
+        EVP_PKEY_CTX_set_ec_paramgen_curve_nid(key_ctx, NID_X9_62_prime256v1) <= 0 ||
+        EVP_PKEY_keygen(key_ctx, &key) <= 0) {
+        EVP_PKEY_CTX_free(key_ctx);
+        throw std::runtime_error("Cannot generate TLS key");
+    }
+    EVP_PKEY_CTX_free(key_ctx);
+
+    X509* cert = X509_new();
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 365L * 24 * 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    X509_sign(cert, key, EVP_sha256());
+
+    bool ok = SSL_CTX_use_certificate(ctx->native_handle(), cert) == 1 &&
+              SSL_CTX_use_PrivateKey(ctx->native_handle(), key) == 1;
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    if (!ok) throw std::runtime_error("Cannot install TLS certificate");
+    return ctx;
+}
+
+void MockExchange::on_open(connection_hdl hdl) {
+    sessions_[hdl] = Session();
+}
+
+void MockExchange::on_close(connection_hdl hdl) {
+    sessions_.erase(hdl);
+    for (auto& pair : channels_) {
+        pair.second->subscribers.erase(hdl);
+    }
+}
+
+void MockExchange::on_message(connection_hdl hdl, server::message_ptr msg) {
+    json request = json::parse(msg->get_payload(), nullptr, false);
+    CallContext context;
+    context.session = &sessions_[hdl];
+    context.account = context.session->account;
+    context.hdl = hdl;
+
+    json response;
+    if (request.is_discarded() || !request.is_object()) {
+        response = {{"jsonrpc", "2.0"}, {"id", nullptr}, {"error", {{"code", -32700}, {"message", "Parse error"}}}};
+    } else {
+        json params = request.contains("params") ? request["params"] : json::object();
+        json id = request.contains("id") ? request["id"] : json(nullptr);
+        response = execute(text(request, "method"), params, id, context);
+    }
+    send_to(hdl, response.dump());
+    for (Channel* channel : context.snapshots) {
+        send_to(hdl, snapshot_notification(*channel));
+    }
+}
+
+void MockExchange::on_http(connection_hdl hdl) {
+    server::connection_ptr con = m_server.get_con_from_hdl(hdl);
+    const std::string& resource = con->get_resource();
+    static const std::string kPrefix = "/api/v2/";
+
+    size_t query = resource.find('?');
+    std::string path = resource.substr(0, query);
+    if (path.compare(0, kPrefix.size(), kPrefix) != 0) {
+        con->set_status(websocketpp::http::status_code::not_found);
+        return;
+    }
+
+    json params = parse_query(query == std::string::npos ? "" : resource.substr(query + 1));
+    const std::string& body = con->get_request_body();
+    if (!body.empty()) {
+        json parsed = json::parse(body, nullptr, false);
+        if (parsed.is_object()) {
+            const json& body_params = parsed.contains("params") ? parsed["params"] : parsed;
+            for (auto it = body_params.begin(); it != body_params.end(); ++it) {
+                params[it.key()] = it.value();
+            }
+        }
+    }
+
+    CallContext context;
+    std::string authorization = con->get_request_header("Authorization");
+    if (authorization.compare(0, 7, "Bearer ") == 0) {
+        auto it = access_tokens_.find(authorization.substr(7));
+        if (it != access_tokens_.end() && it->second.expires_ms > now_ms()) {
+            context.account = it->second.account;
+        }
+    }
+
+    json response = execute(path.substr(kPrefix.size()), params, json(nullptr), context);
+    con->set_status(response.contains("error") ? websocketpp::http::status_code::bad_request
+                                               : websocketpp::http::status_code::ok);
+    con->append_header("Content-Type", "application/json");
+    con->set_body(response.dump());
+}
+
+json MockExchange::execute(const std::string& method, const json& params, const json& id, CallContext& context) {
+    uint64_t us_in = now_us();
+    json response = {{"jsonrpc", "2.0"}, {"id", id}};
+    try {
+        response["result"] = dispatch(method, params, context);
+    } catch (const RpcError& e) {
+        response["error"] = {{"code", e.code}, {"message", e.what()}};
+    } catch (const std::exception& e) {
+        response["error"] = {{"code", -32602}, {"message", std::string("Invalid params: ") + e.what()}};
+    }
+    uint64_t us_out = now_us();
+    response["usIn"] = us_in;
+    response["usOut"] = us_out;
+    response["usDiff"] = us_out - us_in;
+    response["testnet"] = true;
+    return response;
+}
+
+json MockExchange::dispatch(const std::string& method, const json& params, CallContext& context) {
+    if (method == "public/test") return {{"version", "mock"}};
+    if (method == "public/get_time") return now_ms();
+    if (method == "public/auth") return rpc_auth(params, context);
+    if (method == "public/get_order_book") return rpc_order_book(params);
+    if (method == "public/get_instruments") return rpc_instruments(params);
+    if (method == "public/subscribe") return rpc_subscribe(params, context, true);
+    if (method == "public/unsubscribe") return rpc_subscribe(params, context, false);
+    if (method == "private/subscribe") return rpc_subscribe(params, context, true);
+    if (method == "private/unsubscribe") return rpc_subscribe(params, context, false);
+    if (method == "private/buy") return rpc_order(true, params, require_account(params, context));
+    if (method == "private/sell") return rpc_order(false, params, require_account(params, context));
+    if (method == "private/cancel") return rpc_cancel(params, require_account(params, context));
+    if (method == "private/edit") return rpc_edit(params, require_account(params, context));
+    if (method == "private/get_positions") return rpc_positions(params, require_account(params, context));
+    if (method == "private/get_open_orders") return rpc_open_orders(params, require_account(params, context));
+    throw RpcError(-32601, "Method not found");
+}
+
+// Accepts a token authenticated on the connection, an Authorization header,
+// or one embedded in params as older clients send it.
+uint32_t MockExchange::require_account(const json& params, CallContext& context) {
+    if (params.contains("access_token")) {
+        auto it = access_tokens_.find(text(params, "access_token"));
+        if (it != access_tokens_.end() && it->second.expires_ms > now_ms()) {
+            return it->second.account;
+        }
+        throw RpcError(13009, "unauthorized");
+    }
+    if (context.account == 0) throw RpcError(13009, "unauthorized");
+    return context.account;
+}
+
+json MockExchange::rpc_auth(const json& params, CallContext& context) {
+    std::string grant_type = text(params, "grant_type", "client_credentials");
+    uint32_t account = 0;
+    if (grant_type == "client_credentials") {
+        std::string client_id = text(params, "client_id");
+        if (client_id.empty() || text(params, "client_secret").empty()) {
+            throw RpcError(13004, "invalid_credentials");
+        }
+        auto it = accounts_.find(client_id);
+        account = it != accounts_.end() ? it->second : (accounts_[client_id] = next_account_++);
+    } else if (grant_type == "refresh_token") {
+        auto it = refresh_tokens_.find(text(params, "refresh_token"));
+        if (it == refresh_tokens_.end()) throw RpcError(13009, "unauthorized");
+        account = it->second.account;
+        refresh_tokens_.erase(it);
+    } else {
+        throw RpcError(-32602, "Invalid params: grant_type");
+    }
+
+    uint64_t expires_ms = now_ms() + static_cast<uint64_t>(options_.token_ttl_s) * 1000;
+    std::string access_token = random_token(rng_);
+    std::string refresh_token = random_token(rng_);
+    access_tokens_[access_token] = Token{account, expires_ms};
+    refresh_tokens_[refresh_token] = Token{account, expires_ms + 7ULL * 24 * 3600 * 1000};
+
+    // Authenticating over WebSocket authenticates the connection itself.
+    if (context.session) {
+        context.session->account = account;
+    }
+    context.account = account;
+    return {
+        {"access_token", access_token},
+        {"refresh_token", refresh_token},
+        {"expires_in", options_.token_ttl_s},
+        {"scope", "connection mainaccount"},
+        {"token_type", "bearer"}
+    };
+}
+
+json MockExchange::rpc_order(bool buy, const json& params, uint32_t account) {
+    Instrument& instrument = instrument_for(text(params, "instrument_name"));
+    double amount = number(params, "amount");
+    std::string type = text(params, "type", "limit");
+    bool market = type == "market";
+    if (amount <= 0.0) throw RpcError(-32602, "Invalid params: amount");
+    if (!market && type != "limit") throw RpcError(-32602, "Invalid params: type");
+    double price = number(params, "price");
+    if (!market && price <= 0.0) throw RpcError(-32602, "Invalid params: price");
+    check_grid(amount, price, market);
+
+    fills_.clear();
+    MockOrder order = instrument.engine->submit(account, buy, market, price, amount, text(params, "label"),
+                                                now_ms(), fills_);
+    apply_fills(instrument, fills_);
+    notify_order(instrument, order);
+    json result = {{"order", order_json(instrument, order)}, {"trades", trades_json(instrument, order, fills_)}};
+    after_book_change(instrument);
+    return result;
+}
+
+json MockExchange::rpc_cancel(const json& params, uint32_t account) {
+    uint64_t order_id = std::strtoull(text(params, "order_id").c_str(), nullptr, 10);
+    Instrument& instrument = instrument_for_order(order_id);
+    MockOrder order;
+    if (!instrument.engine->cancel(order_id, account, now_ms(), order)) {
+        throw RpcError(10004, "order_not_found");
+    }
+    notify_order(instrument, order);
+    after_book_change(instrument);
+    return order_json(instrument, order);
+}
+
+json MockExchange::rpc_edit(const json& params, uint32_t account) {
+    uint64_t order_id = std::strtoull(text(params, "order_id").c_str(), nullptr, 10);
+    Instrument& instrument = instrument_for_order(order_id);
+    const MockOrder* current = instrument.engine->find(order_id);
+    if (!current) throw RpcError(10004, "order_not_found");
+    double amount = number(params, "amount", current->amount);
+    double price = number(params, "price", current->price);
+    check_grid(amount, price, current->market);
+
+    fills_.clear();
+    MockOrder order;
+    if (!instrument.engine->edit(order_id, account, amount, price, now_ms(), fills_, order)) {
+        throw RpcError(10004, "order_not_found");
+    }
+    apply_fills(instrument, fills_);
+    notify_order(instrument, order);
+    json result = {{"order", order_json(instrument, order)}, {"trades", trades_json(instrument, order, fills_)}};
+    after_book_change(instrument);
+    return result;
+}
+
+json MockExchange::rpc_positions(const json& params, uint32_t account) {
+    std::string currency = text(params, "currency");
+    json result = json::array();
+    for (const auto& instrument : instruments_) {
+        if (!currency.empty() && currency != "any" && instrument->name.compare(0, currency.size(), currency) != 0) {
+            continue;
+        }
+        auto it = positions_.find(std::make_pair(account, instrument->name));
+        Position position = it == positions_.end() ? Position() : it->second;
+        double mark = instrument->mid;
+        result.push_back({
+            {"instrument_name", instrument->name},
+            {"kind", "future"},
+            {"size", position.size},
+            {"direction", position.size > 0 ? "buy" : position.size < 0 ? "sell" : "zero"},
+            {"average_price", position.average_price},
+            {"mark_price", mark},
+            {"index_price", mark},
+            {"floating_profit_loss", position.average_price > 0
+                ? position.size * (1.0 / position.average_price - 1.0 / mark) : 0.0}
+        });
+    }
+    return result;
+}
+
+json MockExchange::rpc_open_orders(const json& params, uint32_t account) {
+    std::string currency = text(params, "currency");
+    json result = json::array();
+    std::vector<MockOrder> orders;
+    for (const auto& instrument : instruments_) {
+        if (!currency.empty() && currency != "any" && instrument->name.compare(0, currency.size(), currency) != 0) {
+            continue;
+        }
+        orders.clear();
+        instrument->engine->open_orders(account, orders);
+        for (const MockOrder& order : orders) {
+            result.push_back(order_json(*instrument, order));
+        }
+    }
+    return result;
+}
+
+json MockExchange::rpc_instruments(const json& params) {
+    std::string currency = text(params, "currency", "any");
+    json result = json::array();
+    for (const auto& instrument : instruments_) {
+        if (currency != "any" && instrument->name.compare(0, currency.size(), currency) != 0) continue;
+        std::string base = instrument->name.substr(0, instrument->name.find('-'));
+        result.push_back({
+            {"instrument_name", instrument->name},
+            {"kind", "future"},
+            {"settlement_period", "perpetual"},
+            {"base_currency", base},
+            {"quote_currency", "USD"},
+            {"settlement_currency", base},
+            {"tick_size", options_.tick_size},
+            {"contract_size", options_.contract_size},
+            {"min_trade_amount", options_.contract_size},
+            {"is_active", true},
+            {"expiration_timestamp", 32503680000000ULL}
+        });
+    }
+    return result;
+}
+
+// Deribit refuses prices off the tick grid and amounts that are not whole
+// contracts instead of rounding them, and so does the mock.
+void MockExchange::check_grid(double amount, double price, bool market) const {
+    double contracts = amount / options_.contract_size;
+    if (std::fabs(contracts - std::round(contracts)) > 1e-9) {
+        throw RpcError(-32602, "Invalid params: amount must be a multiple of contract size");
+    }
+    double ticks = price / options_.tick_size;
+    if (!market && std::fabs(ticks - std::round(ticks)) > 1e-9) {
+        throw RpcError(10043, "price_wrong_tick");
+    }
+}
+
+json MockExchange::rpc_order_book(const json& params) {
+    Instrument& instrument = instrument_for(text(params, "instrument_name"));
+    size_t depth = static_cast<size_t>(number(params, "depth", 10));
+    std::vector<std::pair<double, double>> levels;
+    json bids = json::array();
+    json asks = json::array();
+    instrument.engine->levels(true, depth, levels);
+    for (const auto& level : levels) bids.push_back({level.first, level.second});
+    instrument.engine->levels(false, depth, levels);
+    for (const auto& level : levels) asks.push_back({level.first, level.second});
+
+    const MatchingEngine& engine = *instrument.engine;
+    return {
+        {"instrument_name", instrument.name},
+        {"timestamp", now_ms()},
+        {"change_id", engine.change_id()},
+        {"state", "open"},
+        {"bids", bids},
+        {"asks", asks},
+        {"best_bid_price", engine.best_bid()},
+        {"best_bid_amount", bids.empty() ? 0.0 : bids[0][1].get<double>()},
+        {"best_ask_price", engine.best_ask()},
+        {"best_ask_amount", asks.empty() ? 0.0 : asks[0][1].get<double>()},
+        {"last_price", engine.last_price()},
+        {"mark_price", instrument.mid},
+        {"index_price", instrument.mid}
+    };
+}
+
+json MockExchange::rpc_subscribe(const json& params, CallContext& context, bool subscribe) {
+    if (!context.session) throw RpcError(-32601, "Subscriptions need a WebSocket connection");
+    json result = json::array();
+    if (!params.contains("channels") || !params["channels"].is_array()) return result;
+
+    for (const auto& entry : params["channels"]) {
+        if (!entry.is_string()) continue;
+        if (subscribe_user(entry.get<std::string>(), params, context, subscribe)) {
+            result.push_back(entry);
+            continue;
+        }
+        Channel* channel = channel_for(entry.get<std::string>());
+        if (!channel) continue;
+        if (subscribe) {
+            // Bring existing subscribers up to date so the snapshot lines up
+            // with the channel's change_id sequence.
+            flush_channel(*channel);
+            channel->subscribers.insert(context.hdl);
+            context.snapshots.push_back(channel);
+        } else {
+            channel->subscribers.erase(context.hdl);
+        }
+        result.push_back(channel->name);
+    }
+    return result;
+}
+
+// user.orders.<instrument or kind>.<...> and user.trades.<instrument or kind>.<...>.
+// Returns false for any other channel.
+bool MockExchange::subscribe_user(const std::string& name, const json& params, CallContext& context, bool subscribe) {
+    if (name.compare(0, 12, "user.orders.") != 0 && name.compare(0, 12, "user.trades.") != 0) {
+        return false;
+    }
+    if (subscribe) {
+        // A token in params authenticates the connection for its notifications.
+        context.session->account = require_account(params, context);
+        context.session->user_channels.insert(name);
+    } else {
+        context.session->user_channels.erase(name);
+    }
+    return true;
+}
+
+MockExchange::Instrument& MockExchange::instrument_for(const std::string& name) {
+    auto it = instruments_by_name_.find(name);
+    if (it == instruments_by_name_.end()) throw RpcError(-32602, "Invalid params: instrument_name");
+    return *it->second;
+}
+
+MockExchange::Instrument& MockExchange::instrument_for_order(uint64_t order_id) {
+    uint64_t index = order_id / kOrderIdStride;
+    if (index == 0 || index > instruments_.size()) throw RpcError(10004, "order_not_found");
+    return *instruments_[index - 1];
+}
+
+json MockExchange::order_json(const Instrument& instrument, const MockOrder& order) const {
+    json price = order.market ? json("market_price") : json(order.price);
+    return {
+        {"order_id", std::to_string(order.id)},
+        {"order_state", state_name(order.state)},
+        {"order_type", order.market ? "market" : "limit"},
+        {"direction", order.buy ? "buy" : "sell"},
+        {"instrument_name", instrument.name},
+        {"price", price},
+        {"amount", order.amount},
+        {"filled_amount", order.filled},
+        {"average_price", order.average_price()},
+        {"label", order.label},
+        {"creation_timestamp", order.created_ms},
+        {"last_update_timestamp", order.updated_ms},
+        {"time_in_force", "good_til_cancelled"},
+        {"post_only", false},
+        {"reduce_only", false},
+        {"api", true}
+    };
+}
+
+json MockExchange::fill_json(const Instrument& instrument, const MockFill& fill, bool maker) const {
+    uint64_t order_id = maker ? fill.maker_order : fill.taker_order;
+    const MockOrder* order = instrument.engine->find(order_id);
+    bool buy = maker ? !fill.taker_buy : fill.taker_buy;
+    return {
+        {"trade_id", std::to_string(fill.trade_id)},
+        {"trade_seq", fill.trade_id % kOrderIdStride},
+        {"order_id", std::to_string(order_id)},
+        {"instrument_name", instrument.name},
+        {"direction", buy ? "buy" : "sell"},
+        {"price", fill.price},
+        {"amount", fill.amount},
+        {"timestamp", fill.timestamp_ms},
+        {"liquidity", maker ? "M" : "T"},
+        {"order_type", order && order->market ? "market" : "limit"},
+        {"state", order ? state_name(order->state) : "filled"},
+        {"fee", 0.0},
+        {"fee_currency", "BTC"},
+        {"index_price", instrument.mid},
+        {"mark_price", instrument.mid}
+    };
+}
+
+json MockExchange::trades_json(const Instrument& instrument, const MockOrder& order,
+                               const std::vector<MockFill>& fills) const {
+    json trades = json::array();
+    for (const MockFill& fill : fills) {
+        if (fill.taker_order != order.id) continue;
+        trades.push_back(fill_json(instrument, fill, false));
+    }
+    return trades;
+}
+
+void MockExchange::apply_fills(const Instrument& instrument, const std::vector<MockFill>& fills) {
+    for (const MockFill& fill : fills) {
+        uint32_t accounts[2] = {fill.taker_account, fill.maker_account};
+        bool buys[2] = {fill.taker_buy, !fill.taker_buy};
+        for (int i = 0; i < 2; ++i) {
+            if (accounts[i] == kSyntheticAccount) continue;
+            Position& position = positions_[std::make_pair(accounts[i], instrument.name)];
+            double signed_amount = buys[i] ? fill.amount : -fill.amount;
+            if (position.size == 0.0 || (position.size > 0) == (signed_amount > 0)) {
+                // Opening or adding: volume-weighted entry price.
+                double total = std::fabs(position.size) + fill.amount;
+                position.average_price = (position.average_price * std::fabs(position.size) + fill.price * fill.amount) / total;
+            } else if (std::fabs(signed_amount) > std::fabs(position.size)) {
+                // Flipped through zero: the remainder opens at this price.
+                position.average_price = fill.price;
+            }
+            position.size += signed_amount;
+            if (std::fabs(position.size) < 1e-9) {
+                position = Position();
+            }
+
+            notify_user(accounts[i], instrument, "user.trades.", json::array({fill_json(instrument, fill, i == 1)}));
+            if (i == 1) {
+                // The taker's own update goes out with its RPC; resting orders
+                // only hear about fills this way.
+                if (const MockOrder* maker = instrument.engine->find(fill.maker_order)) {
+                    notify_order(instrument, *maker);
+                }
+            }
+        }
+    }
+}
+
+void MockExchange::notify_order(const Instrument& instrument, const MockOrder& order) {
+    if (order.account == kSyntheticAccount) return;
+    notify_user(order.account, instrument, "user.orders.", order_json(instrument, order));
+}
+
+// Raw order channels carry one order object, every other user channel an array.
+void MockExchange::notify_user(uint32_t account, const Instrument& instrument, const char* prefix, const json& data) {
+    size_t prefix_size = std::strlen(prefix);
+    for (const auto& pair : sessions_) {
+        const Session& session = pair.second;
+        if (session.account != account) continue;
+        for (const std::string& channel : session.user_channels) {
+            if (channel.compare(0, prefix_size, prefix) != 0) continue;
+            // Third segment is an instrument name or a kind ("any", "future", ...).
+            size_t dot = channel.find('.', prefix_size);
+            std::string scope = channel.substr(prefix_size, dot == std::string::npos ? std::string::npos : dot - prefix_size);
+            if (instruments_by_name_.count(scope) && scope != instrument.name) continue;
+
+            bool raw = channel.size() >= 4 && channel.compare(channel.size() - 4, 4, ".raw") == 0;
+            json notification = {
+                {"jsonrpc", "2.0"},
+                {"method", "subscription"},
+                {"params", {
+                    {"channel", channel},
+                    {"data", data.is_array() || raw ? data : json::array({data})}
+                }}
+            };
+            send_to(pair.first, notification.dump());
+        }
+    }
+}
+
+MockExchange::Channel* MockExchange::channel_for(const std::string& name) {
+    auto existing = channels_.find(name);
+    if (existing != channels_.end()) return existing->second.get();
+
+    // book.<instrument>.<interval>
+    if (name.compare(0, 5, "book.") != 0) return nullptr;
+    size_t dot = name.rfind('.');
+    if (dot <= 5) return nullptr;
+    std::string interval = name.substr(dot + 1);
+    auto instrument = instruments_by_name_.find(name.substr(5, dot - 5));
+    if (instrument == instruments_by_name_.end()) return nullptr;
+    if (interval != "raw" && interval != "100ms") return nullptr;
+
+    std::unique_ptr<Channel> channel(new Channel());
+    channel->name = name;
+    channel->instrument = instrument->second;
+    channel->interval_ms = interval == "raw" ? 0 : kBookIntervalMs;
+    channel->last_change_id = instrument->second->engine->change_id();
+    std::vector<std::pair<double, double>> levels;
+    for (int side = 0; side < 2; ++side) {
+        instrument->second->engine->levels(side == 0, 0, levels);
+        for (const auto& level : levels) {
+            channel->published[std::make_pair(side == 0, level.first)] = level.second;
+        }
+    }
+    instrument->second->channels.push_back(channel.get());
+    Channel* raw = channel.get();
+    channels_[name] = std::move(channel);
+    return raw;
+}
+
+void MockExchange::after_book_change(Instrument& instrument) {
+    changes_.clear();
+    instrument.engine->take_changes(changes_);
+    if (changes_.empty()) return;
+    for (Channel* channel : instrument.channels) {
+        for (const MockLevelChange& change : changes_) {
+            channel->pending[std::make_pair(change.bid, change.price)] = change.amount;
+        }
+        if (channel->interval_ms == 0) {
+            flush_channel(*channel);
+        }
+    }
+}
+
+void MockExchange::flush_channel(Channel& channel) {
+    if (channel.pending.empty()) return;
+
+    json bids = json::array();
+    json asks = json::array();
+    for (const auto& pair : channel.pending) {
+        bool bid = pair.first.first;
+        double price = pair.first.second;
+        double amount = pair.second;
+        auto published = channel.published.find(pair.first);
+        const char* action;
+        if (amount <= 0.0) {
+            if (published == channel.published.end()) continue;     // Appeared and vanished in between
+            action = "delete";
+            channel.published.erase(published);
+        } else {
+            if (published != channel.published.end() && published->second == amount) continue;
+            action = published == channel.published.end() ? "new" : "change";
+            channel.published[pair.first] = amount;
+        }
+        (bid ? bids : asks).push_back({action, price, amount});
+    }
+    channel.pending.clear();
+    if (bids.empty() && asks.empty()) return;
+
+    uint64_t change_id = channel.instrument->engine->change_id();
+    json notification = {
+        {"jsonrpc", "2.0"},
+        {"method", "subscription"},
+        {"params", {
+            {"channel", channel.name},
+            {"data", {
+                {"type", "change"},
+                {"timestamp", now_ms()},
+                {"prev_change_id", channel.last_change_id},
+                {"instrument_name", channel.instrument->name},
+                {"change_id", change_id},
+                {"bids", bids},
+                {"asks", asks}
+            }}
+        }}
+    };
+    channel.last_change_id = change_id;
+
+    std::string message = notification.dump();
+    for (const connection_hdl& hdl : channel.subscribers) {
+        send_to(hdl, message);
+    }
+}
+
+std::string MockExchange::snapshot_notification(Channel& channel) {
+    json bids = json::array();
+    json asks = json::array();
+    for (const auto& pair : channel.published) {
+        json level = {"new", pair.first.second, pair.second};
+        if (pair.first.first) {
+            bids.insert(bids.begin(), level);       // published is ascending; bids go best first
+        } else {
+            asks.push_back(level);
+        }
+    }
+    json notification = {
+        {"jsonrpc", "2.0"},
+        {"method", "subscription"},
+        {"params", {
+            {"channel", channel.name},
+            {"data", {
+                {"type", "snapshot"},
+                {"timestamp", now_ms()},
+                {"instrument_name", channel.instrument->name},
+                {"change_id", channel.last_change_id},
+                {"bids", bids},
+                {"asks", asks}
+            }}
+        }}
+    };
+    return notification.dump();
+}
+
+void MockExchange::send_to(connection_hdl hdl, const std::string& message) {
+    websocketpp::lib::error_code ec;
+    m_server.send(hdl, message, websocketpp::frame::opcode::text, ec);
+}
+
+void MockExchange::seed_book(Instrument& instrument) {
+    std::uniform_int_distribution<int> size(1, 100);
+    for (int i = 1; i <= options_.initial_levels; ++i) {
+        for (int side = 0; side < 2; ++side) {
+            bool buy = side == 0;
+            double price = instrument.mid + (buy ? -i : i) * options_.tick_size;
+            fills_.clear();
+            MockOrder order = instrument.engine->submit(kSyntheticAccount, buy, false, price,
+                                                        options_.contract_size * size(rng_), "", now_ms(), fills_);
+            instrument.synthetic_orders.push_back(order.id);
+        }
+    }
+    changes_.clear();
+    instrument.engine->take_changes(changes_);
+}
+
+void MockExchange::schedule_churn() {
+    m_server.set_timer(kChurnTickMs, [this](const websocketpp::lib::error_code& ec) {
+        if (ec) return;
+        double events = options_.churn_per_second * kChurnTickMs / 1000.0;
+        for (auto& instrument : instruments_) {
+            instrument->churn_credit += events;
+            while (instrument->churn_credit >= 1.0) {
+                instrument->churn_credit -= 1.0;
+                churn(*instrument);
+            }
+        }
+        schedule_churn();
+    });
+}
+
+void MockExchange::schedule_book_flush() {
+    m_server.set_timer(kBookIntervalMs, [this](const websocketpp::lib::error_code& ec) {
+        if (ec) return;
+        for (auto& pair : channels_) {
+            if (pair.second->interval_ms > 0) {
+                flush_channel(*pair.second);
+            }
+        }
+        schedule_book_flush();
+    });
+}
+
+// One synthetic event: mostly passive adds and cancels around a randomly
+// walking mid, with the odd marketable order so trades happen too.
+void MockExchange::churn(Instrument& instrument) {
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::uniform_int_distribution<int> size(1, 100);
+    std::uniform_int_distribution<int> offset(1, std::max(1, options_.initial_levels));
+    const double tick = options_.tick_size;
+    MatchingEngine& engine = *instrument.engine;
+
+    double roll = unit(rng_);
+    if (roll < 0.02) {
+        instrument.mid += unit(rng_) < 0.5 ? -tick : tick;
+    }
+
+    bool too_many = instrument.synthetic_orders.size() > static_cast<size_t>(options_.initial_levels) * 8;
+    bool buy = unit(rng_) < 0.5;
+    fills_.clear();
+    if (!too_many && roll < 0.55) {
+        double price = instrument.mid + (buy ? -offset(rng_) : offset(rng_)) * tick;
+        MockOrder order = engine.submit(kSyntheticAccount, buy, false, price, options_.contract_size * size(rng_), "", now_ms(), fills_);
+        if (order.state == MockOrderState::OPEN) {
+            instrument.synthetic_orders.push_back(order.id);
+        }
+    } else if (too_many || roll < 0.9) {
+        if (instrument.synthetic_orders.empty()) return;
+        std::uniform_int_distribution<size_t> pick(0, instrument.synthetic_orders.size() - 1);
+        size_t index = pick(rng_);
+        uint64_t order_id = instrument.synthetic_orders[index];
+        instrument.synthetic_orders[index] = instrument.synthetic_orders.back();
+        instrument.synthetic_orders.pop_back();
+        MockOrder cancelled;
+        engine.cancel(order_id, kSyntheticAccount, now_ms(), cancelled);    // May have traded away already
+    } else {
+        engine.submit(kSyntheticAccount, buy, true, 0.0, options_.contract_size * (1 + size(rng_) / 5), "", now_ms(), fills_);
+    }
+    apply_fills(instrument, fills_);
+    after_book_change(instrument);
+}
+
+uint64_t MockExchange::now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+uint64_t MockExchange::now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,66 @@
+#include "mock_exchange.hpp"
+#include "logger.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Runs the local mock exchange. Point the clients at it with
+//
+//   DERIBIT_REST_URL=https://localhost:8443/api/v2
+//   DERIBIT_WS_URL=wss://localhost:8443/ws/api/v2
+//   DERIBIT_TLS_VERIFY=0
+//
+//   mock_exchange [--port P] [--instruments A,B] [--mid X] [--tick X] [--contract X]
+//                 [--levels N] [--churn N] [--seed N] [--cert PEM --key PEM]
+int main(int argc, char** argv) {
+    MockExchangeOptions options;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--port" && has_value) {
+            options.port = static_cast<uint16_t>(std::atoi(argv[++i]));
+        } else if (arg == "--instruments" && has_value) {
+            options.instruments.clear();
+            std::stringstream list(argv[++i]);
+            std::string name;
+            while (std::getline(list, name, ',')) {
+                if (!name.empty()) options.instruments.push_back(name);
+            }
+        } else if (arg == "--mid" && has_value) {
+            options.mid_price = std::atof(argv[++i]);
+        } else if (arg == "--tick" && has_value) {
+            options.tick_size = std::atof(argv[++i]);
+        } else if (arg == "--contract" && has_value) {
+            options.contract_size = std::atof(argv[++i]);
+        } else if (arg == "--levels" && has_value) {
+            options.initial_levels = std::atoi(argv[++i]);
+        } else if (arg == "--churn" && has_value) {
+            options.churn_per_second = std::atof(argv[++i]);
+        } else if (arg == "--seed" && has_value) {
+            options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--cert" && has_value) {
+            options.cert_file = argv[++i];
+        } else if (arg == "--key" && has_value) {
+            options.key_file = argv[++i];
+        } else {
+            std::cerr << "Usage: mock_exchange [--port P] [--instruments A,B] [--mid X] [--tick X] [--contract X]\n"
+                         "                     [--levels N] [--churn N] [--seed N] [--cert PEM --key PEM]\n";
+            return 1;
+        }
+    }
+    if (options.instruments.empty() || options.tick_size <= 0.0 || options.contract_size <= 0.0) {
+        std::cerr << "Need at least one instrument and a positive tick and contract size\n";
+        return 1;
+    }
+
+    try {
+        MockExchange exchange(options);
+        exchange.run();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,478 @@
+#include "notification_parser.hpp"
+#include <cstdlib>
+
+namespace {
+
+const double kPow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+inline const char* skip_ws(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) ++p;
+    return p;
+}
+
+// p must point at the opening quote. The result is the raw, still escaped contents.
+bool scan_string(const char*& p, const char* end, StrRef& out) {
+    if (p >= end || *p != '"') return false;
+    const char* start = ++p;
+    while (p < end) {
+        // memchr is vectorised by libc, so long strings are skipped 16-32 bytes at a time.
+        const char* quote = static_cast<const char*>(std::memchr(p, '"', end - p));
+        if (!quote) return false;
+        size_t backslashes = 0;
+        for (const char* b = quote; b > start && b[-1] == '\\'; --b) ++backslashes;
+        p = quote + 1;
+        if (backslashes % 2 == 0) {
+            out.data = start;
+            out.size = quote - start;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool skip_value(const char*& p, const char* end) {
+    p = skip_ws(p, end);
+    if (p >= end) return false;
+
+    StrRef ignored;
+    if (*p == '"') return scan_string(p, end, ignored);
+
+    if (*p == '{' || *p == '[') {
+        int depth = 0;
+        while (p < end) {
+            char c = *p;
+            if (c == '"') {
+                if (!scan_string(p, end, ignored)) return false;
+                continue;
+            }
+            if (c == '{' || c == '[') {
+                ++depth;
+            } else if (c == '}' || c == ']') {
+                if (--depth == 0) {
+                    ++p;
+                    return true;
+                }
+            }
+            ++p;
+        }
+        return false;
+    }
+
+    const char* start = p;
+    while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\n' && *p != '\r' && *p != '\t') ++p;
+    return p != start;
+}
+
+bool capture_value(const char*& p, const char* end, StrRef& out) {
+    p = skip_ws(p, end);
+    const char* start = p;
+    if (!skip_value(p, end)) return false;
+    out.data = start;
+    out.size = p - start;
+    return true;
+}
+
+bool parse_null(const char*& p, const char* end) {
+    if (end - p >= 4 && std::memcmp(p, "null", 4) == 0) {
+        p += 4;
+        return true;
+    }
+    return false;
+}
+
+// Exact for up to 15 significant digits and |exponent| <= 22, which covers every
+// price and amount Deribit sends; anything else goes through strtod.
+bool parse_double(const char*& p, const char* end, double& out) {
+    p = skip_ws(p, end);
+    if (parse_null(p, end)) {
+        out = 0.0;
+        return true;
+    }
+
+    const char* start = p;
+    bool negative = p < end && *p == '-';
+    if (negative) ++p;
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool any = false;
+
+    for (; p < end && is_digit(*p); ++p) {
+        any = true;
+        if (mantissa == 0 && *p == '0') continue;
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+        } else {
+            ++exponent;
+        }
+        ++digits;
+    }
+    if (p < end && *p == '.') {
+        for (++p; p < end && is_digit(*p); ++p) {
+            any = true;
+            if (mantissa == 0 && *p == '0') {
+                --exponent;
+                continue;
+            }
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                --exponent;
+            }
+            ++digits;
+        }
+    }
+    if (!any) return false;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        bool negative_exp = p < end && *p == '-';
+        if (p < end && (*p == '-' || *p == '+')) ++p;
+        int e = 0;
+        for (; p < end && is_digit(*p); ++p) {
+            if (e < 10000) e = e * 10 + (*p - '0');
+        }
+        exponent += negative_exp ? -e : e;
+    }
+
+    if (digits <= 15 && exponent >= -22 && exponent <= 22) {
+        double value = static_cast<double>(mantissa);
+        value = exponent < 0 ? value / kPow10[-exponent] : value * kPow10[exponent];
+        out = negative ? -value : value;
+        return true;
+    }
+
+    char buffer[64];
+    size_t length = p - start;
+    if (length >= sizeof(buffer)) return false;
+    std::memcpy(buffer, start, length);
+    buffer[length] = '\0';
+    out = std::strtod(buffer, nullptr);
+    return true;
+}
+
+bool parse_int(const char*& p, const char* end, int64_t& out) {
+    p = skip_ws(p, end);
+    if (parse_null(p, end)) {
+        out = 0;
+        return true;
+    }
+    bool negative = p < end && *p == '-';
+    if (negative) ++p;
+    const char* start = p;
+    int64_t value = 0;
+    for (; p < end && is_digit(*p); ++p) value = value * 10 + (*p - '0');
+    if (p == start) return false;
+    out = negative ? -value : value;
+    return true;
+}
+
+// Calls on_field(key, p) for each member with p at the value; the callback must
+// consume the value. p ends just past the closing brace.
+template <typename OnField>
+bool for_each_field(const char*& p, const char* end, OnField on_field) {
+    p = skip_ws(p, end);
+    if (p >= end || *p != '{') return false;
+    p = skip_ws(p + 1, end);
+    if (p < end && *p == '}') {
+        ++p;
+        return true;
+    }
+    while (p < end) {
+        StrRef key;
+        p = skip_ws(p, end);
+        if (!scan_string(p, end, key)) return false;
+        p = skip_ws(p, end);
+        if (p >= end || *p != ':') return false;
+        p = skip_ws(p + 1, end);
+        if (!on_field(key, p)) return false;
+        p = skip_ws(p, end);
+        if (p >= end) return false;
+        if (*p == ',') {
+            ++p;
+        } else if (*p == '}') {
+            ++p;
+            return true;
+        } else {
+            return false;
+        }
+    }
+    return false;
+}
+
+// Positions p at the next array element, or returns false at the closing bracket.
+bool next_element(const char*& p, const char* end) {
+    p = skip_ws(p, end);
+    if (p < end && *p == ',') p = skip_ws(p + 1, end);
+    return p < end && *p != ']';
+}
+
+bool expect(const char*& p, const char* end, char c) {
+    p = skip_ws(p, end);
+    if (p >= end || *p != c) return false;
+    ++p;
+    return true;
+}
+
+bool parse_book(StrRef data, BookNotification& book) {
+    const char* p = data.data;
+    const char* end = data.data + data.size;
+    return for_each_field(p, end, [&book, end](StrRef key, const char*& v) {
+        if (key.equals("type")) {
+            StrRef type;
+            if (!scan_string(v, end, type)) return false;
+            book.snapshot = type.equals("snapshot");
+            return true;
+        }
+        if (key.equals("timestamp")) return parse_int(v, end, book.timestamp);
+        if (key.equals("change_id")) return parse_int(v, end, book.change_id);
+        if (key.equals("prev_change_id")) return parse_int(v, end, book.prev_change_id);
+        if (key.equals("bids")) return capture_value(v, end, book.bids);
+        if (key.equals("asks")) return capture_value(v, end, book.asks);
+        return skip_value(v, end);
+    });
+}
+
+bool parse_ticker(StrRef data, TickerNotification& ticker) {
+    const char* p = data.data;
+    const char* end = data.data + data.size;
+    return for_each_field(p, end, [&ticker, end](StrRef key, const char*& v) {
+        if (key.equals("timestamp")) return parse_int(v, end, ticker.timestamp);
+        if (key.equals("best_bid_price")) return parse_double(v, end, ticker.best_bid_price);
+        if (key.equals("best_bid_amount")) return parse_double(v, end, ticker.best_bid_amount);
+        if (key.equals("best_ask_price")) return parse_double(v, end, ticker.best_ask_price);
+        if (key.equals("best_ask_amount")) return parse_double(v, end, ticker.best_ask_amount);
+        if (key.equals("last_price")) return parse_double(v, end, ticker.last_price);
+        if (key.equals("mark_price")) return parse_double(v, end, ticker.mark_price);
+        if (key.equals("index_price")) return parse_double(v, end, ticker.index_price);
+        return skip_value(v, end);
+    });
+}
+
+} // namespace
+
+LevelCursor::LevelCursor(StrRef array)
+    : pos_(array.data), end_(array.data + array.size) {
+    pos_ = skip_ws(pos_, end_);
+    if (pos_ < end_ && *pos_ == '[') {
+        ++pos_;
+    } else {
+        pos_ = end_;
+    }
+}
+
+bool LevelCursor::next(BookLevel& level) {
+    if (!next_element(pos_, end_)) return false;
+    if (!expect(pos_, end_, '[')) return false;
+
+    pos_ = skip_ws(pos_, end_);
+    bool has_action = pos_ < end_ && *pos_ == '"';
+    if (has_action) {
+        StrRef action;
+        if (!scan_string(pos_, end_, action) || action.empty()) return false;
+        level.action = action.data[0] == 'n' ? BookLevel::NEW
+                     : action.data[0] == 'd' ? BookLevel::DELETE
+                     : BookLevel::CHANGE;
+        if (!expect(pos_, end_, ',')) return false;
+    }
+    if (!parse_double(pos_, end_, level.price)) return false;
+    if (!expect(pos_, end_, ',')) return false;
+    if (!parse_double(pos_, end_, level.amount)) return false;
+    if (!expect(pos_, end_, ']')) return false;
+
+    if (!has_action) {
+        level.action = level.amount == 0.0 ? BookLevel::DELETE : BookLevel::CHANGE;
+    }
+    return true;
+}
+
+TradeCursor::TradeCursor(StrRef array)
+    : pos_(array.data), end_(array.data + array.size) {
+    pos_ = skip_ws(pos_, end_);
+    if (pos_ < end_ && *pos_ == '[') {
+        ++pos_;
+    } else {
+        pos_ = end_;
+    }
+}
+
+bool TradeCursor::next(Trade& trade) {
+    if (!next_element(pos_, end_)) return false;
+
+    trade = Trade();
+    const char* end = end_;
+    return for_each_field(pos_, end_, [&trade, end](StrRef key, const char*& v) {
+        if (key.equals("timestamp")) return parse_int(v, end, trade.timestamp);
+        if (key.equals("trade_seq")) return parse_int(v, end, trade.trade_seq);
+        if (key.equals("price")) return parse_double(v, end, trade.price);
+        if (key.equals("amount")) return parse_double(v, end, trade.amount);
+        if (key.equals("trade_id")) {
+            v = skip_ws(v, end);
+            if (v < end && *v == '"') return scan_string(v, end, trade.trade_id);
+            return capture_value(v, end, trade.trade_id);
+        }
+        if (key.equals("direction")) {
+            StrRef direction;
+            if (!scan_string(v, end, direction)) return false;
+            trade.buy = direction.equals("buy");
+            return true;
+        }
+        return skip_value(v, end);
+    });
+}
+
+OrderCursor::OrderCursor(StrRef data)
+    : pos_(data.data), end_(data.data + data.size), single_(false) {
+    pos_ = skip_ws(pos_, end_);
+    if (pos_ < end_ && *pos_ == '{') {
+        single_ = true;
+    } else if (pos_ < end_ && *pos_ == '[') {
+        ++pos_;
+    } else {
+        pos_ = end_;
+    }
+}
+
+bool OrderCursor::next(OrderUpdate& order) {
+    if (single_) {
+        if (pos_ >= end_) return false;
+    } else if (!next_element(pos_, end_)) {
+        return false;
+    }
+
+    order = OrderUpdate();
+    const char* end = end_;
+    bool ok = for_each_field(pos_, end_, [&order, end](StrRef key, const char*& v) {
+        if (key.equals("order_id")) return scan_string(v, end, order.order_id);
+        if (key.equals("instrument_name")) return scan_string(v, end, order.instrument);
+        if (key.equals("order_state")) return scan_string(v, end, order.order_state);
+        if (key.equals("order_type")) return scan_string(v, end, order.order_type);
+        if (key.equals("label")) {
+            if (v < end && *v == '"') return scan_string(v, end, order.label);
+            return skip_value(v, end);
+        }
+        if (key.equals("direction")) {
+            StrRef direction;
+            if (!scan_string(v, end, direction)) return false;
+            order.buy = direction.equals("buy");
+            return true;
+        }
+        if (key.equals("price")) {
+            if (v < end && *v == '"') return skip_value(v, end);   // "market_price"
+            return parse_double(v, end, order.price);
+        }
+        if (key.equals("amount")) return parse_double(v, end, order.amount);
+        if (key.equals("filled_amount")) return parse_double(v, end, order.filled_amount);
+        if (key.equals("average_price")) return parse_double(v, end, order.average_price);
+        if (key.equals("creation_timestamp")) return parse_int(v, end, order.creation_timestamp);
+        if (key.equals("last_update_timestamp")) return parse_int(v, end, order.last_update_timestamp);
+        return skip_value(v, end);
+    });
+    if (single_) pos_ = end_;
+    return ok;
+}
+
+UserTradeCursor::UserTradeCursor(StrRef array)
+    : pos_(array.data), end_(array.data + array.size) {
+    pos_ = skip_ws(pos_, end_);
+    if (pos_ < end_ && *pos_ == '[') {
+        ++pos_;
+    } else {
+        pos_ = end_;
+    }
+}
+
+bool UserTradeCursor::next(UserTrade& trade) {
+    if (!next_element(pos_, end_)) return false;
+
+    trade = UserTrade();
+    const char* end = end_;
+    return for_each_field(pos_, end_, [&trade, end](StrRef key, const char*& v) {
+        if (key.equals("trade_id")) {
+            if (v < end && *v == '"') return scan_string(v, end, trade.trade_id);
+            return capture_value(v, end, trade.trade_id);
+        }
+        if (key.equals("order_id")) return scan_string(v, end, trade.order_id);
+        if (key.equals("instrument_name")) return scan_string(v, end, trade.instrument);
+        if (key.equals("state")) return scan_string(v, end, trade.order_state);
+        if (key.equals("direction")) {
+            StrRef direction;
+            if (!scan_string(v, end, direction)) return false;
+            trade.buy = direction.equals("buy");
+            return true;
+        }
+        if (key.equals("liquidity")) {
+            StrRef liquidity;
+            if (!scan_string(v, end, liquidity)) return false;
+            trade.maker = liquidity.equals("M");
+            return true;
+        }
+        if (key.equals("price")) return parse_double(v, end, trade.price);
+        if (key.equals("amount")) return parse_double(v, end, trade.amount);
+        if (key.equals("fee")) return parse_double(v, end, trade.fee);
+        if (key.equals("timestamp")) return parse_int(v, end, trade.timestamp);
+        return skip_value(v, end);
+    });
+}
+
+bool parse_notification(const char* frame, size_t size, Notification& out) {
+    const char* p = frame;
+    const char* end = frame + size;
+    bool is_subscription = false;
+    StrRef params;
+
+    out = Notification();
+    bool ok = for_each_field(p, end, [&](StrRef key, const char*& v) {
+        if (key.equals("method")) {
+            StrRef method;
+            if (!scan_string(v, end, method)) return false;
+            is_subscription = method.equals("subscription");
+            return true;
+        }
+        if (key.equals("params")) return capture_value(v, end, params);
+        return skip_value(v, end);
+    });
+    if (!ok || !is_subscription || params.empty()) return false;
+
+    p = params.data;
+    const char* params_end = params.data + params.size;
+    ok = for_each_field(p, params_end, [&](StrRef key, const char*& v) {
+        if (key.equals("channel")) return scan_string(v, params_end, out.channel);
+        if (key.equals("data")) return capture_value(v, params_end, out.data);
+        return skip_value(v, params_end);
+    });
+    if (!ok || out.channel.empty() || out.data.empty()) return false;
+
+    const StrRef& channel = out.channel;
+    if (channel.starts_with("book.")) {
+        out.kind = NotificationKind::BOOK;
+    } else if (channel.starts_with("ticker.")) {
+        out.kind = NotificationKind::TICKER;
+    } else if (channel.starts_with("trades.")) {
+        out.kind = NotificationKind::TRADES;
+    } else if (channel.starts_with("user.")) {
+        out.kind = NotificationKind::USER;
+    } else {
+        out.kind = NotificationKind::OTHER;
+    }
+
+    if (out.kind != NotificationKind::USER) {
+        // "<kind>.<instrument>.<interval>[...]"
+        const char* first = static_cast<const char*>(std::memchr(channel.data, '.', channel.size));
+        if (first) {
+            const char* rest = first + 1;
+            size_t rest_size = channel.data + channel.size - rest;
+            const char* second = static_cast<const char*>(std::memchr(rest, '.', rest_size));
+            out.instrument.data = rest;
+            out.instrument.size = second ? second - rest : rest_size;
+        }
+    }
+
+    if (out.kind == NotificationKind::BOOK) return parse_book(out.data, out.book);
+    if (out.kind == NotificationKind::TICKER) return parse_ticker(out.data, out.ticker);
+    return true;
+}
@@ -0,0 +1,124 @@
+#include "order_book.hpp"
+#include "instruments.hpp"
+#include <algorithm>
+
+namespace {
+
+struct Ascending {
+    bool operator()(const PriceLevel& level, double price) const { return level.price < price; }
+};
+
+struct Descending {
+    bool operator()(const PriceLevel& level, double price) const { return level.price > price; }
+};
+
+template <typename Compare>
+void upsert_level(std::vector<PriceLevel>& levels, double price, double amount, Compare before) {
+    auto it = std::lower_bound(levels.begin(), levels.end(), price, before);
+    bool found = it != levels.end() && it->price == price;
+
+    if (amount == 0.0) {
+        if (found) levels.erase(it);
+    } else if (found) {
+        it->amount = amount;
+    } else {
+        levels.insert(it, PriceLevel{price, amount});
+    }
+}
+
+} // namespace
+
+void OrderBook::begin_snapshot(int64_t change_id, int64_t timestamp) {
+    bids_.clear();
+    asks_.clear();
+    change_id_ = change_id;
+    timestamp_ = timestamp;
+    valid_ = false;
+}
+
+void OrderBook::add_snapshot_level(Side side, double price, double amount) {
+    if (amount == 0.0) return;
+    (side == BID ? bids_ : asks_).push_back(PriceLevel{price, amount});
+}
+
+void OrderBook::end_snapshot() {
+    std::sort(bids_.begin(), bids_.end(),
+              [](const PriceLevel& a, const PriceLevel& b) { return a.price < b.price; });
+    std::sort(asks_.begin(), asks_.end(),
+              [](const PriceLevel& a, const PriceLevel& b) { return a.price > b.price; });
+    valid_ = true;
+}
+
+bool OrderBook::begin_delta(int64_t prev_change_id, int64_t change_id, int64_t timestamp) {
+    if (!valid_ || prev_change_id != change_id_) {
+        invalidate();
+        return false;
+    }
+    change_id_ = change_id;
+    timestamp_ = timestamp;
+    return true;
+}
+
+void OrderBook::apply_level(Side side, double price, double amount) {
+    if (side == BID) {
+        upsert_level(bids_, price, amount, Ascending());
+    } else {
+        upsert_level(asks_, price, amount, Descending());
+    }
+}
+
+void OrderBook::invalidate() {
+    valid_ = false;
+}
+
+size_t OrderBook::top(Side side, PriceLevel* out, size_t n) const {
+    const std::vector<PriceLevel>& levels = side == BID ? bids_ : asks_;
+    size_t count = std::min(n, levels.size());
+    std::reverse_copy(levels.end() - count, levels.end(), out);
+    return count;
+}
+
+OrderBookStore::OrderBookStore()
+    : books_(new std::atomic<Entry*>[InstrumentRegistry::kMaxInstruments]) {
+    for (uint32_t i = 0; i < InstrumentRegistry::kMaxInstruments; ++i) {
+        books_[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+OrderBookStore::~OrderBookStore() {
+    for (uint32_t i = 0; i < InstrumentRegistry::kMaxInstruments; ++i) {
+        delete books_[i].load(std::memory_order_relaxed);
+    }
+}
+
+OrderBookStore::Entry* OrderBookStore::get_or_create(uint32_t instrument) {
+    if (instrument >= InstrumentRegistry::kMaxInstruments) return nullptr;
+    Entry* entry = books_[instrument].load(std::memory_order_acquire);
+    if (entry) return entry;
+
+    std::lock_guard<std::mutex> lock(create_mutex_);
+    entry = books_[instrument].load(std::memory_order_relaxed);
+    if (!entry) {
+        entry = new Entry();
+        books_[instrument].store(entry, std::memory_order_release);
+    }
+    return entry;
+}
+
+OrderBookStore::Entry* OrderBookStore::find(uint32_t instrument) {
+    if (instrument >= InstrumentRegistry::kMaxInstruments) return nullptr;
+    return books_[instrument].load(std::memory_order_acquire);
+}
+
+OrderBookStore::Entry* OrderBookStore::get_or_create(const std::string& instrument) {
+    return get_or_create(getInstrumentRegistry().intern(instrument));
+}
+
+OrderBookStore::Entry* OrderBookStore::find(const std::string& instrument) {
+    return find(getInstrumentRegistry().find(instrument));
+}
+
+OrderBookStore& getOrderBookStore() {
+    static OrderBookStore store;
+    return store;
+}
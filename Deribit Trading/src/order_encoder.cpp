@@ -0,0 +1,261 @@
+#include "order_encoder.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const char kDigitPairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+const uint64_t kDecimalScale = 100000000ULL;   // 10^kDecimalPlaces
+
+// Above this the scaled value no longer fits comfortably in 64 bits.
+const double kMaxScaledValue = 9.0e10;
+
+// Bounded writer over a template buffer. Any overflow sticks, so a whole
+// message can be written and checked once at the end.
+struct Cursor {
+    char* pos;
+    char* end;
+    bool ok;
+
+    Cursor(char* begin, char* finish) : pos(begin), end(finish), ok(true) {}
+
+    void put(const char* data, size_t size) {
+        if (static_cast<size_t>(end - pos) < size) {
+            ok = false;
+            return;
+        }
+        std::memcpy(pos, data, size);
+        pos += size;
+    }
+    template <size_t N>
+    void literal(const char (&text)[N]) { put(text, N - 1); }
+
+    // Strings that would need escaping are refused rather than escaped.
+    void string(const std::string& value) {
+        for (char c : value) {
+            if (c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20) {
+                ok = false;
+                return;
+            }
+        }
+        put(value.data(), value.size());
+    }
+    void uint(uint64_t value) {
+        if (end - pos < 20) {
+            ok = false;
+            return;
+        }
+        pos += format_uint(value, pos);
+    }
+    void decimal(double value) {
+        if (end - pos < 32) {
+            ok = false;
+            return;
+        }
+        pos += format_decimal(value, pos);
+    }
+    void scaled(int64_t value_e8) {
+        if (end - pos < 32) {
+            ok = false;
+            return;
+        }
+        pos += format_scaled(value_e8, pos);
+    }
+};
+
+} // namespace
+
+size_t format_uint(uint64_t value, char* out) {
+    char digits[20];
+    char* p = digits + sizeof(digits);
+    while (value >= 100) {
+        size_t pair = (value % 100) * 2;
+        value /= 100;
+        *--p = kDigitPairs[pair + 1];
+        *--p = kDigitPairs[pair];
+    }
+    if (value >= 10) {
+        *--p = kDigitPairs[value * 2 + 1];
+        *--p = kDigitPairs[value * 2];
+    } else {
+        *--p = static_cast<char>('0' + value);
+    }
+    size_t size = digits + sizeof(digits) - p;
+    std::memcpy(out, p, size);
+    return size;
+}
+
+size_t format_decimal(double value, char* out) {
+    if (!(std::fabs(value) < kMaxScaledValue)) {
+        // Out of range or not finite; not worth a fast path.
+        return static_cast<size_t>(std::snprintf(out, 32, "%.17g", value));
+    }
+    return format_scaled(std::llround(value * static_cast<double>(kDecimalScale)), out);
+}
+
+size_t format_scaled(int64_t value_e8, char* out) {
+    char* p = out;
+    uint64_t scaled;
+    if (value_e8 < 0) {
+        *p++ = '-';
+        scaled = 0 - static_cast<uint64_t>(value_e8);
+    } else {
+        scaled = static_cast<uint64_t>(value_e8);
+    }
+    p += format_uint(scaled / kDecimalScale, p);
+
+    uint64_t fraction = scaled % kDecimalScale;
+    if (fraction != 0) {
+        int places = kDecimalPlaces;
+        while (fraction % 10 == 0) {
+            fraction /= 10;
+            --places;
+        }
+        *p++ = '.';
+        for (int i = places - 1; i >= 0; --i) {
+            p[i] = static_cast<char>('0' + fraction % 10);
+            fraction /= 10;
+        }
+        p += places;
+    }
+    return p - out;
+}
+
+OrderEncoder::OrderEncoder() {
+    rebuild_templates();
+}
+
+void OrderEncoder::set_access_token(const std::string& token) {
+    if (token.size() == token_size_ && std::memcmp(token.data(), token_, token_size_) == 0) {
+        return;
+    }
+    token_valid_ = token.size() <= kMaxTokenSize;
+    token_size_ = token_valid_ ? token.size() : 0;
+    std::memcpy(token_, token.data(), token_size_);
+    rebuild_templates();
+}
+
+void OrderEncoder::rebuild_templates() {
+    build_template(templates_[BUY_LIMIT], "private/buy", "limit");
+    build_template(templates_[BUY_MARKET], "private/buy", "market");
+    build_template(templates_[SELL_LIMIT], "private/sell", "limit");
+    build_template(templates_[SELL_MARKET], "private/sell", "market");
+    build_template(templates_[CANCEL], "private/cancel", nullptr);
+    build_template(templates_[EDIT], "private/edit", nullptr);
+}
+
+// {"jsonrpc":"2.0","method":"<method>","params":{["access_token":"<token>",]["type":"<type>",]
+// Field order is free in JSON, so everything constant goes first. Without a
+// token the request relies on the connection's own authentication.
+void OrderEncoder::build_template(Template& t, const char* method, const char* type) {
+    Cursor out(t.buffer, t.buffer + kMaxMessage);
+    out.literal("{\"jsonrpc\":\"2.0\",\"method\":\"");
+    out.put(method, std::strlen(method));
+    out.literal("\",\"params\":{");
+    if (token_size_) {
+        out.literal("\"access_token\":\"");
+        out.put(token_, token_size_);
+        out.literal("\",");
+    }
+    if (type) {
+        out.literal("\"type\":\"");
+        out.put(type, std::strlen(type));
+        out.literal("\",");
+    }
+    t.prefix = out.ok ? out.pos - t.buffer : 0;
+}
+
+OrderEncoder::Template& OrderEncoder::place_template(OrderSide side, OrderType type) {
+    bool limit = type == OrderType::LIMIT;
+    return templates_[side == OrderSide::BUY ? (limit ? BUY_LIMIT : BUY_MARKET)
+                                             : (limit ? SELL_LIMIT : SELL_MARKET)];
+}
+
+StrRef OrderEncoder::place_order(uint64_t id, OrderSide side, OrderType type, const std::string& instrument,
+                                 double amount, double price) {
+    bool limit = type == OrderType::LIMIT;
+    Template& t = place_template(side, type);
+    Cursor out(t.buffer + t.prefix, t.buffer + kMaxMessage);
+    out.literal("\"instrument_name\":\"");
+    out.string(instrument);
+    out.literal("\",\"amount\":");
+    out.decimal(amount);
+    if (limit) {
+        out.literal(",\"price\":");
+        out.decimal(price);
+    }
+    out.literal("},\"id\":");
+    out.uint(id);
+    out.literal("}");
+    if (!out.ok || !token_valid_ || t.prefix == 0) return StrRef();
+    return StrRef{t.buffer, static_cast<size_t>(out.pos - t.buffer)};
+}
+
+StrRef OrderEncoder::cancel_order(uint64_t id, const std::string& order_id) {
+    Template& t = templates_[CANCEL];
+    Cursor out(t.buffer + t.prefix, t.buffer + kMaxMessage);
+    out.literal("\"order_id\":\"");
+    out.string(order_id);
+    out.literal("\"},\"id\":");
+    out.uint(id);
+    out.literal("}");
+    if (!out.ok || !token_valid_ || t.prefix == 0) return StrRef();
+    return StrRef{t.buffer, static_cast<size_t>(out.pos - t.buffer)};
+}
+
+StrRef OrderEncoder::modify_order(uint64_t id, const std::string& order_id, double amount, double price) {
+    Template& t = templates_[EDIT];
+    Cursor out(t.buffer + t.prefix, t.buffer + kMaxMessage);
+    out.literal("\"order_id\":\"");
+    out.string(order_id);
+    out.literal("\",\"amount\":");
+    out.decimal(amount);
+    out.literal(",\"price\":");
+    out.decimal(price);
+    out.literal("},\"id\":");
+    out.uint(id);
+    out.literal("}");
+    if (!out.ok || !token_valid_ || t.prefix == 0) return StrRef();
+    return StrRef{t.buffer, static_cast<size_t>(out.pos - t.buffer)};
+}
+
+StrRef OrderEncoder::place_order(uint64_t id, OrderSide side, OrderType type, const InstrumentSpec& instrument,
+                                 Qty amount, Price price) {
+    Template& t = place_template(side, type);
+    Cursor out(t.buffer + t.prefix, t.buffer + kMaxMessage);
+    out.literal("\"instrument_name\":\"");
+    out.string(instrument.name);
+    out.literal("\",\"amount\":");
+    out.scaled(amount.lots * instrument.lot_e8);
+    if (type == OrderType::LIMIT) {
+        out.literal(",\"price\":");
+        out.scaled(price.ticks * instrument.tick_e8);
+    }
+    out.literal("},\"id\":");
+    out.uint(id);
+    out.literal("}");
+    if (!out.ok || !token_valid_ || t.prefix == 0) return StrRef();
+    return StrRef{t.buffer, static_cast<size_t>(out.pos - t.buffer)};
+}
+
+StrRef OrderEncoder::modify_order(uint64_t id, const std::string& order_id, const InstrumentSpec& instrument,
+                                  Qty amount, Price price) {
+    Template& t = templates_[EDIT];
+    Cursor out(t.buffer + t.prefix, t.buffer + kMaxMessage);
+    out.literal("\"order_id\":\"");
+    out.string(order_id);
+    out.literal("\",\"amount\":");
+    out.scaled(amount.lots * instrument.lot_e8);
+    out.literal(",\"price\":");
+    out.scaled(price.ticks * instrument.tick_e8);
+    out.literal("},\"id\":");
+    out.uint(id);
+    out.literal("}");
+    if (!out.ok || !token_valid_ || t.prefix == 0) return StrRef();
+    return StrRef{t.buffer, static_cast<size_t>(out.pos - t.buffer)};
+}
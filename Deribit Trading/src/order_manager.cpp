@@ -0,0 +1,344 @@
+#include "order_manager.hpp"
+#include "logger.hpp"
+#include "risk_gate.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// What the order could still add to the position if it filled completely.
+double open_exposure(const OrderRecord& record) {
+    return record.is_open() ? std::max(0.0, record.remaining()) : 0.0;
+}
+
+template <size_t N>
+uint8_t copy_text(char (&out)[N], StrRef text) {
+    size_t size = std::min(text.size, N);
+    std::memcpy(out, text.data, size);
+    return static_cast<uint8_t>(size);
+}
+
+} // namespace
+
+const char* order_state_name(OrderState state) {
+    switch (state) {
+    case OrderState::OPEN: return "open";
+    case OrderState::UNTRIGGERED: return "untriggered";
+    case OrderState::FILLED: return "filled";
+    case OrderState::CANCELLED: return "cancelled";
+    case OrderState::REJECTED: return "rejected";
+    }
+    return "open";
+}
+
+OrderState parse_order_state(StrRef state) {
+    if (state.equals("open")) return OrderState::OPEN;
+    if (state.equals("filled")) return OrderState::FILLED;
+    if (state.equals("cancelled")) return OrderState::CANCELLED;
+    if (state.equals("rejected")) return OrderState::REJECTED;
+    if (state.equals("untriggered")) return OrderState::UNTRIGGERED;
+    return OrderState::OPEN;
+}
+
+const size_t OrderRecord::kMaxOrderId;
+const size_t OrderRecord::kMaxLabel;
+const size_t FillRecord::kMaxTradeId;
+const uint32_t OrderManager::kMaxOrders;
+const size_t OrderManager::kMaxFills;
+const uint32_t OrderManager::kSlotCount;
+const uint32_t OrderManager::kNone;
+
+OrderManager::OrderManager()
+    : nodes_(new Node[kMaxOrders]),
+      slots_(new uint32_t[kSlotCount]()),
+      open_head_(new uint32_t[InstrumentRegistry::kMaxInstruments]),
+      open_tail_(new uint32_t[InstrumentRegistry::kMaxInstruments]),
+      fills_(new FillRecord[kMaxFills]) {
+    free_.reserve(kMaxOrders);
+    for (uint32_t i = kMaxOrders; i > 0; --i) {
+        free_.push_back(i - 1);
+    }
+    std::fill(open_head_.get(), open_head_.get() + InstrumentRegistry::kMaxInstruments, kNone);
+    std::fill(open_tail_.get(), open_tail_.get() + InstrumentRegistry::kMaxInstruments, kNone);
+}
+
+void OrderManager::on_notification(const Notification& note) {
+    if (note.channel.starts_with("user.orders.")) {
+        OrderUpdate update;
+        for (OrderCursor orders(note.data); orders.next(update);) {
+            apply_order(update);
+        }
+    } else if (note.channel.starts_with("user.trades.")) {
+        UserTrade trade;
+        for (UserTradeCursor trades(note.data); trades.next(trade);) {
+            apply_trade(trade);
+        }
+    }
+}
+
+void OrderManager::apply_order(const OrderUpdate& update) {
+    if (update.order_id.empty() || update.order_id.size > OrderRecord::kMaxOrderId) {
+        LOG_EVERY_MS(LOG_LEVEL_WARN, 1000, "[Orders] Ignoring order id {} ({} more since last warning)",
+                     LogText(update.order_id.data, update.order_id.size));
+        return;
+    }
+    uint32_t instrument = getInstrumentRegistry().intern(update.instrument);
+    if (instrument == InstrumentRegistry::kInvalidId) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t index = lookup(update.order_id);
+    if (index == kNone) {
+        index = allocate(update.order_id);
+        if (index == kNone) {
+            LOG_EVERY_MS(LOG_LEVEL_WARN, 1000, "[Orders] Order table full of open orders, dropping {} ({} more since last warning)",
+                         LogText(update.order_id.data, update.order_id.size));
+            return;
+        }
+        OrderRecord& record = nodes_[index].record;
+        record.instrument = instrument;
+        record.state = parse_order_state(update.order_state);
+        record.side = update.buy ? OrderSide::BUY : OrderSide::SELL;
+        place(index);
+    } else if (update.last_update_timestamp < nodes_[index].record.last_update_timestamp) {
+        // Grouped channels can deliver an older state after a newer one.
+        return;
+    }
+
+    Node& node = nodes_[index];
+    OrderRecord& record = node.record;
+    double exposure_before = open_exposure(record);
+    OrderState state = parse_order_state(update.order_state);
+    bool reopens = !record.is_open() && (state == OrderState::OPEN || state == OrderState::UNTRIGGERED);
+    if (state != record.state && !reopens) {
+        remove(index);
+        record.state = state;
+        place(index);
+    }
+    record.side = update.buy ? OrderSide::BUY : OrderSide::SELL;
+    record.type = update.order_type.equals("market") ? OrderType::MARKET : OrderType::LIMIT;
+    record.label_size = copy_text(record.label, update.label);
+    record.price = update.price;
+    record.amount = update.amount;
+    record.average_price = update.average_price;
+    record.creation_timestamp = update.creation_timestamp;
+    record.last_update_timestamp = update.last_update_timestamp;
+    node.reported_filled = update.filled_amount;
+    update_fill(node);
+    getRiskGate().add_open(instrument, record.side, open_exposure(record) - exposure_before);
+}
+
+void OrderManager::apply_trade(const UserTrade& trade) {
+    uint32_t instrument = getInstrumentRegistry().intern(trade.instrument);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    FillRecord& fill = fills_[fill_total_ % kMaxFills];
+    fill.trade_id_size = copy_text(fill.trade_id, trade.trade_id);
+    fill.order_id_size = copy_text(fill.order_id, trade.order_id);
+    fill.instrument = instrument;
+    fill.side = trade.buy ? OrderSide::BUY : OrderSide::SELL;
+    fill.maker = trade.maker;
+    fill.price = trade.price;
+    fill.amount = trade.amount;
+    fill.fee = trade.fee;
+    fill.timestamp = trade.timestamp;
+    ++fill_total_;
+
+    getRiskGate().add_position(instrument, trade.buy ? trade.amount : -trade.amount);
+
+    // A trade for an order not seen yet is only logged as a fill; its
+    // user.orders update follows and creates the record.
+    uint32_t index = lookup(trade.order_id);
+    if (index == kNone) return;
+    Node& node = nodes_[index];
+    double exposure_before = open_exposure(node.record);
+    node.traded += trade.amount;
+    node.traded_notional += trade.amount * trade.price;
+    ++node.record.fill_count;
+    update_fill(node);
+
+    // Trades carry the order's state after the fill; only let them close it.
+    OrderState state = trade.order_state.empty() ? node.record.state : parse_order_state(trade.order_state);
+    if (node.record.is_open() && state != OrderState::OPEN && state != OrderState::UNTRIGGERED) {
+        remove(index);
+        node.record.state = state;
+        place(index);
+    }
+    getRiskGate().add_open(node.record.instrument, node.record.side, open_exposure(node.record) - exposure_before);
+}
+
+void OrderManager::update_fill(Node& node) {
+    OrderRecord& record = node.record;
+    if (node.traded > node.reported_filled) {
+        record.filled_amount = node.traded;
+        record.average_price = node.traded_notional / node.traded;
+    } else {
+        record.filled_amount = node.reported_filled;
+    }
+}
+
+bool OrderManager::find(StrRef order_id, OrderRecord& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t index = lookup(order_id);
+    if (index == kNone) return false;
+    out = nodes_[index].record;
+    return true;
+}
+
+size_t OrderManager::open_orders(uint32_t instrument, std::vector<OrderRecord>& out) const {
+    out.clear();
+    uint32_t first = instrument;
+    uint32_t last = instrument + 1;
+    if (instrument == InstrumentRegistry::kInvalidId) {
+        first = 0;
+        last = getInstrumentRegistry().size();
+    } else if (instrument >= InstrumentRegistry::kMaxInstruments) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (uint32_t id = first; id < last; ++id) {
+        for (uint32_t index = open_head_[id]; index != kNone; index = nodes_[index].next) {
+            out.push_back(nodes_[index].record);
+        }
+    }
+    return out.size();
+}
+
+size_t OrderManager::fills(uint32_t instrument, StrRef order_id, size_t max, std::vector<FillRecord>& out) const {
+    out.clear();
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t available = std::min<uint64_t>(fill_total_, kMaxFills);
+    for (uint64_t i = 0; i < available && out.size() < max; ++i) {
+        const FillRecord& fill = fills_[(fill_total_ - 1 - i) % kMaxFills];
+        if (instrument != InstrumentRegistry::kInvalidId && fill.instrument != instrument) continue;
+        if (!order_id.empty() && (fill.order_id_size != order_id.size ||
+                                  std::memcmp(fill.order_id, order_id.data, order_id.size) != 0)) {
+            continue;
+        }
+        out.push_back(fill);
+    }
+    return out.size();
+}
+
+OrderManagerStats OrderManager::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return OrderManagerStats{open_count_, tracked_, fill_total_, recycled_};
+}
+
+// FNV-1a, as for instrument names.
+uint32_t OrderManager::hash(StrRef order_id) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < order_id.size; ++i) {
+        h = (h ^ static_cast<unsigned char>(order_id.data[i])) * 16777619u;
+    }
+    return h;
+}
+
+uint32_t OrderManager::find_slot(StrRef order_id) const {
+    for (uint32_t slot = hash(order_id) & (kSlotCount - 1);; slot = (slot + 1) & (kSlotCount - 1)) {
+        uint32_t entry = slots_[slot];
+        if (entry == 0) return slot;
+        const OrderRecord& record = nodes_[entry - 1].record;
+        if (record.order_id_size == order_id.size && std::memcmp(record.order_id, order_id.data, order_id.size) == 0) {
+            return slot;
+        }
+    }
+}
+
+uint32_t OrderManager::lookup(StrRef order_id) const {
+    uint32_t entry = slots_[find_slot(order_id)];
+    return entry == 0 ? kNone : entry - 1;
+}
+
+uint32_t OrderManager::allocate(StrRef order_id) {
+    uint32_t index;
+    if (!free_.empty()) {
+        index = free_.back();
+        free_.pop_back();
+    } else if (finished_head_ != kNone) {
+        index = finished_head_;
+        const OrderRecord& old = nodes_[index].record;
+        unlink(finished_head_, finished_tail_, index);
+        erase_slot(find_slot(StrRef{old.order_id, old.order_id_size}));
+        --tracked_;
+        ++recycled_;
+    } else {
+        return kNone;
+    }
+
+    Node& node = nodes_[index];
+    node = Node();
+    node.record.order_id_size = copy_text(node.record.order_id, order_id);
+    slots_[find_slot(order_id)] = index + 1;
+    ++tracked_;
+    return index;
+}
+
+// Linear probing delete: later entries of the same run move back into the
+// hole unless that would put them before their home slot.
+void OrderManager::erase_slot(uint32_t slot) {
+    uint32_t hole = slot;
+    for (uint32_t next = (hole + 1) & (kSlotCount - 1); slots_[next] != 0; next = (next + 1) & (kSlotCount - 1)) {
+        const OrderRecord& record = nodes_[slots_[next] - 1].record;
+        uint32_t home = hash(StrRef{record.order_id, record.order_id_size}) & (kSlotCount - 1);
+        bool stays = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next);
+        if (!stays) {
+            slots_[hole] = slots_[next];
+            hole = next;
+        }
+    }
+    slots_[hole] = 0;
+}
+
+void OrderManager::place(uint32_t index) {
+    OrderRecord& record = nodes_[index].record;
+    if (record.is_open()) {
+        link(open_head_[record.instrument], open_tail_[record.instrument], index);
+        ++open_count_;
+    } else {
+        link(finished_head_, finished_tail_, index);
+    }
+}
+
+void OrderManager::remove(uint32_t index) {
+    OrderRecord& record = nodes_[index].record;
+    if (record.is_open()) {
+        unlink(open_head_[record.instrument], open_tail_[record.instrument], index);
+        --open_count_;
+    } else {
+        unlink(finished_head_, finished_tail_, index);
+    }
+}
+
+void OrderManager::link(uint32_t& head, uint32_t& tail, uint32_t index) {
+    Node& node = nodes_[index];
+    node.prev = tail;
+    node.next = kNone;
+    if (tail != kNone) {
+        nodes_[tail].next = index;
+    } else {
+        head = index;
+    }
+    tail = index;
+}
+
+void OrderManager::unlink(uint32_t& head, uint32_t& tail, uint32_t index) {
+    Node& node = nodes_[index];
+    if (node.prev != kNone) {
+        nodes_[node.prev].next = node.next;
+    } else {
+        head = node.next;
+    }
+    if (node.next != kNone) {
+        nodes_[node.next].prev = node.prev;
+    } else {
+        tail = node.prev;
+    }
+    node.prev = kNone;
+    node.next = kNone;
+}
+
+OrderManager& getOrderManager() {
+    static OrderManager manager;
+    return manager;
+}
@@ -0,0 +1,130 @@
+#include "notification_parser.hpp"
+#include <iostream>
+#include <iomanip>
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+using namespace std::chrono;
+
+// Compares the nlohmann path the Deribit message handler used to take with the
+// allocation-free notification scanner, on representative frames.
+
+static std::string make_book(bool snapshot, int levels) {
+    std::string frame = "{\"jsonrpc\":\"2.0\",\"method\":\"subscription\",\"params\":{\"channel\":\"book.BTC-PERPETUAL.100ms\","
+                        "\"data\":{\"type\":\"";
+    frame += snapshot ? "snapshot" : "change";
+    frame += "\",\"timestamp\":1712345678901,\"prev_change_id\":68371981230,\"instrument_name\":\"BTC-PERPETUAL\","
+             "\"change_id\":68371981231,\"bids\":[";
+    for (int i = 0; i < levels; ++i) {
+        if (i) frame += ",";
+        frame += "[\"" + std::string(snapshot ? "new" : "change") + "\"," + std::to_string(64250 - i) + ".5,"
+               + std::to_string(1000 + i * 10) + ".0]";
+    }
+    frame += "],\"asks\":[";
+    for (int i = 0; i < levels; ++i) {
+        if (i) frame += ",";
+        frame += "[\"" + std::string(snapshot ? "new" : "change") + "\"," + std::to_string(64251 + i) + ".0,"
+               + std::to_string(2000 + i * 10) + ".0]";
+    }
+    frame += "]}}}";
+    return frame;
+}
+
+static const char* kTicker =
+    "{\"jsonrpc\":\"2.0\",\"method\":\"subscription\",\"params\":{\"channel\":\"ticker.BTC-PERPETUAL.100ms\","
+    "\"data\":{\"timestamp\":1712345678901,\"stats\":{\"volume_usd\":123456789.0,\"volume\":1923.5,\"price_change\":1.25,"
+    "\"low\":63000.0,\"high\":65000.5},\"state\":\"open\",\"settlement_price\":64000.12,\"open_interest\":987654321,"
+    "\"min_price\":63290.5,\"max_price\":65210.0,\"mark_price\":64250.73,\"last_price\":64251.0,"
+    "\"instrument_name\":\"BTC-PERPETUAL\",\"index_price\":64230.11,\"funding_8h\":0.0001,\"current_funding\":0.0,"
+    "\"best_bid_price\":64250.5,\"best_bid_amount\":12340.0,\"best_ask_price\":64251.0,\"best_ask_amount\":5600.0}}}";
+
+static const char* kTrades =
+    "{\"jsonrpc\":\"2.0\",\"method\":\"subscription\",\"params\":{\"channel\":\"trades.BTC-PERPETUAL.100ms\","
+    "\"data\":[{\"trade_seq\":30289432,\"trade_id\":\"48079254\",\"timestamp\":1712345678901,\"tick_direction\":0,"
+    "\"price\":64251.0,\"mark_price\":64250.73,\"instrument_name\":\"BTC-PERPETUAL\",\"index_price\":64230.11,"
+    "\"direction\":\"buy\",\"amount\":120.0},{\"trade_seq\":30289433,\"trade_id\":\"48079255\",\"timestamp\":1712345678902,"
+    "\"tick_direction\":1,\"price\":64251.5,\"mark_price\":64250.73,\"instrument_name\":\"BTC-PERPETUAL\","
+    "\"index_price\":64230.11,\"direction\":\"sell\",\"amount\":40.0}]}}";
+
+// What the message handler did before: copy, full DOM, substr, then read the levels.
+static double nlohmann_path(const std::string& frame) {
+    std::string payload = frame;
+    json j = json::parse(payload);
+    double checksum = 0.0;
+    if (j.contains("params") && j["params"].contains("channel")) {
+        std::string channel = j["params"]["channel"];
+        std::string instrument = channel.substr(5, channel.size() - 5 - 6);
+        (void)instrument;
+        const json& data = j["params"]["data"];
+        if (channel.compare(0, 5, "book.") == 0) {
+            for (const auto& level : data["bids"]) checksum += level[1].get<double>() + level[2].get<double>();
+            for (const auto& level : data["asks"]) checksum += level[1].get<double>() + level[2].get<double>();
+        } else if (channel.compare(0, 7, "ticker.") == 0) {
+            checksum += data["best_bid_price"].get<double>() + data["best_ask_price"].get<double>();
+        } else if (channel.compare(0, 7, "trades.") == 0) {
+            for (const auto& trade : data) checksum += trade["price"].get<double>() + trade["amount"].get<double>();
+        }
+    }
+    return checksum;
+}
+
+static double fast_path(const std::string& frame) {
+    Notification note;
+    double checksum = 0.0;
+    if (!parse_notification(frame.data(), frame.size(), note)) return checksum;
+    if (note.kind == NotificationKind::BOOK) {
+        BookLevel level;
+        for (LevelCursor bids(note.book.bids); bids.next(level);) checksum += level.price + level.amount;
+        for (LevelCursor asks(note.book.asks); asks.next(level);) checksum += level.price + level.amount;
+    } else if (note.kind == NotificationKind::TICKER) {
+        checksum += note.ticker.best_bid_price + note.ticker.best_ask_price;
+    } else if (note.kind == NotificationKind::TRADES) {
+        Trade trade;
+        for (TradeCursor trades(note.data); trades.next(trade);) checksum += trade.price + trade.amount;
+    }
+    return checksum;
+}
+
+template <typename Fn>
+static double time_ns(const std::string& frame, int iterations, Fn fn, double& checksum) {
+    auto start = high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        checksum += fn(frame);
+    }
+    auto end = high_resolution_clock::now();
+    return duration_cast<nanoseconds>(end - start).count() / static_cast<double>(iterations);
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::stoi(argv[1]) : 100000;
+
+    struct Case { const char* name; std::string frame; };
+    std::vector<Case> cases = {
+        {"book delta (3 levels)", make_book(false, 3)},
+        {"book snapshot (50 levels)", make_book(true, 50)},
+        {"ticker", kTicker},
+        {"trades (2)", kTrades}
+    };
+
+    std::cout << "Notification Parsing Benchmark (" << iterations << " iterations)\n";
+    std::cout << "------------------------------\n\n";
+    for (const auto& c : cases) {
+        double slow_sum = 0.0, fast_sum = 0.0;
+        double slow = time_ns(c.frame, iterations, nlohmann_path, slow_sum);
+        double fast = time_ns(c.frame, iterations, fast_path, fast_sum);
+
+        std::cout << c.name << " (" << c.frame.size() << " bytes):\n";
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "  nlohmann::json: " << slow << " ns/msg\n";
+        std::cout << "  fast scanner:   " << fast << " ns/msg\n";
+        std::cout << "  speedup:        " << slow / fast << "x\n";
+        if (slow_sum != fast_sum) {
+            std::cout << "  WARNING: checksums differ (" << slow_sum << " vs " << fast_sum << ")\n";
+        }
+        std::cout << "\n";
+    }
+    return 0;
+}
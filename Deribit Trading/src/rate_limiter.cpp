@@ -0,0 +1,157 @@
+#include "rate_limiter.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+// Deribit's published defaults: non-matching requests cost 500 of 50000
+// credits refilled at 10000/s (20 requests/s, bursts of 100); the lowest
+// matching-engine tier allows 5 requests/s with bursts of 20.
+const CreditPolicy kDefaultMatching{1, 20, 5};
+const CreditPolicy kDefaultNonMatching{500, 50000, 10000};
+
+const int64_t kNanosPerSecond = 1000000000LL;
+
+} // namespace
+
+const char* request_class_name(RequestClass request_class) {
+    switch (request_class) {
+    case RequestClass::MATCHING: return "matching";
+    case RequestClass::NON_MATCHING: return "non_matching";
+    case RequestClass::CLASS_COUNT: break;
+    }
+    return "unknown";
+}
+
+int64_t CreditBucket::now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void CreditBucket::configure(const CreditPolicy& policy) {
+    policy_ = policy;
+    cost_ns_ = policy.cost * kNanosPerSecond / policy.refill_per_second;
+    capacity_ns_ = policy.max_credits * kNanosPerSecond / policy.refill_per_second;
+    full_at_ns_.store(0, std::memory_order_relaxed);
+}
+
+bool CreditBucket::try_acquire() {
+    int64_t now = now_ns();
+    int64_t full_at = full_at_ns_.load(std::memory_order_relaxed);
+    for (;;) {
+        int64_t next = std::max(full_at, now) + cost_ns_;
+        if (next - now > capacity_ns_) return false;
+        if (full_at_ns_.compare_exchange_weak(full_at, next, std::memory_order_relaxed)) return true;
+    }
+}
+
+uint64_t CreditBucket::wait_ns() const {
+    int64_t now = now_ns();
+    int64_t over = std::max(full_at_ns_.load(std::memory_order_relaxed), now) + cost_ns_ - now - capacity_ns_;
+    return over > 0 ? static_cast<uint64_t>(over) : 0;
+}
+
+int64_t CreditBucket::available() const {
+    int64_t now = now_ns();
+    int64_t used_ns = std::max(full_at_ns_.load(std::memory_order_relaxed), now) - now;
+    return (capacity_ns_ - used_ns) * policy_.refill_per_second / kNanosPerSecond;
+}
+
+void CreditBucket::drain() {
+    int64_t empty_at = now_ns() + capacity_ns_;
+    int64_t full_at = full_at_ns_.load(std::memory_order_relaxed);
+    while (full_at < empty_at && !full_at_ns_.compare_exchange_weak(full_at, empty_at, std::memory_order_relaxed)) {
+    }
+}
+
+RateLimiter::RateLimiter() {
+    configure(RequestClass::MATCHING, kDefaultMatching);
+    configure(RequestClass::NON_MATCHING, kDefaultNonMatching);
+}
+
+void RateLimiter::configure(RequestClass request_class, const CreditPolicy& policy) {
+    if (policy.cost <= 0 || policy.max_credits < policy.cost || policy.refill_per_second <= 0) {
+        throw std::invalid_argument(std::string("Bad credit policy for ") + request_class_name(request_class));
+    }
+    buckets_[index(request_class)].configure(policy);
+    LOG_INFO("[RateLimit] {}: {} credits per request, {} max, {} per second", request_class_name(request_class),
+             policy.cost, policy.max_credits, policy.refill_per_second);
+}
+
+void RateLimiter::configure_from_env() {
+    const char* names[] = {"DERIBIT_CREDITS_MATCHING", "DERIBIT_CREDITS_NON_MATCHING"};
+    for (size_t i = 0; i < 2; ++i) {
+        const char* value = std::getenv(names[i]);
+        if (!value) continue;
+        long long max_credits = 0, refill = 0, cost = 0;
+        if (std::sscanf(value, "%lld:%lld:%lld", &max_credits, &refill, &cost) != 3) {
+            throw std::invalid_argument(std::string(names[i]) + " must be <max_credits>:<refill_per_second>:<cost>");
+        }
+        configure(static_cast<RequestClass>(i), CreditPolicy{cost, max_credits, refill});
+    }
+}
+
+bool RateLimiter::try_acquire(RequestClass request_class) {
+    if (!buckets_[index(request_class)].try_acquire()) return false;
+    counters_[index(request_class)].sent.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+uint64_t RateLimiter::wait_ns(RequestClass request_class) const {
+    return buckets_[index(request_class)].wait_ns();
+}
+
+bool RateLimiter::acquire(RequestClass request_class, std::chrono::nanoseconds max_wait) {
+    auto deadline = std::chrono::steady_clock::now() + max_wait;
+    bool counted = false;
+    while (!try_acquire(request_class)) {
+        auto wait = std::chrono::nanoseconds(wait_ns(request_class));
+        if (std::chrono::steady_clock::now() + wait > deadline) {
+            on_shed(request_class);
+            return false;
+        }
+        if (!counted) {
+            on_queued(request_class);
+            counted = true;
+        }
+        std::this_thread::sleep_for(wait);
+    }
+    return true;
+}
+
+void RateLimiter::on_queued(RequestClass request_class) {
+    counters_[index(request_class)].queued.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RateLimiter::on_shed(RequestClass request_class) {
+    counters_[index(request_class)].shed.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RateLimiter::on_exchange_reject(RequestClass request_class) {
+    counters_[index(request_class)].exchange_rejects.fetch_add(1, std::memory_order_relaxed);
+    buckets_[index(request_class)].drain();
+    LOG_EVERY_MS(LOG_LEVEL_WARN, 1000, "[RateLimit] Deribit rejected a {} request for credits ({} more since last warning)",
+                 request_class_name(request_class));
+}
+
+CreditStats RateLimiter::stats(RequestClass request_class) const {
+    const CreditBucket& bucket = buckets_[index(request_class)];
+    const Counters& counters = counters_[index(request_class)];
+    return CreditStats{
+        bucket.available(),
+        bucket.policy().max_credits,
+        counters.sent.load(std::memory_order_relaxed),
+        counters.queued.load(std::memory_order_relaxed),
+        counters.shed.load(std::memory_order_relaxed),
+        counters.exchange_rejects.load(std::memory_order_relaxed)
+    };
+}
+
+RateLimiter& getRateLimiter() {
+    static RateLimiter limiter;
+    return limiter;
+}
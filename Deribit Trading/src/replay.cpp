@@ -0,0 +1,111 @@
+#include "journal.hpp"
+#include "logger.hpp"
+#include "tracker.hpp"
+#include "websocket_client.hpp"
+#include "websocket_server.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono;
+
+WebSocketClient* g_ws_client = nullptr;
+WebSocketServer* g_ws_server = nullptr;
+
+// Replays a capture journal through WebSocketClient::on_frame, so the parse,
+// order book and fan-out paths run exactly as they do live, without a network.
+//
+//   replay <prefix|segment.jrnl>... [--paced] [--speed X] [--loops N] [--port P]
+//
+// By default frames are fed as fast as possible. --paced keeps the recorded
+// inter-arrival times (divided by --speed). --port also serves the replayed
+// stream to downstream WebSocket clients on that port, waiting for Enter so
+// they can connect and subscribe first. With no connection to resync over, a
+// change_id gap in the journal is applied over and counted.
+int main(int argc, char** argv) {
+    std::vector<std::string> segments;
+    bool paced = false;
+    double speed = 1.0;
+    int loops = 1;
+    int port = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--paced") {
+            paced = true;
+        } else if (arg == "--speed" && i + 1 < argc) {
+            speed = std::atof(argv[++i]);
+        } else if (arg == "--loops" && i + 1 < argc) {
+            loops = std::atoi(argv[++i]);
+        } else if (arg == "--port" && i + 1 < argc) {
+            port = std::atoi(argv[++i]);
+        } else if (arg.size() > 5 && arg.compare(arg.size() - 5, 5, ".jrnl") == 0) {
+            segments.push_back(arg);
+        } else {
+            std::vector<std::string> found = JournalReplay::segments_for(arg);
+            segments.insert(segments.end(), found.begin(), found.end());
+        }
+    }
+    if (segments.empty()) {
+        std::cerr << "Usage: replay <prefix|segment.jrnl>... [--paced] [--speed X] [--loops N] [--port P]\n";
+        return 1;
+    }
+    if (speed <= 0.0) speed = 1.0;
+
+    WebSocketClient ws_client;
+    ws_client.set_offline(true);
+    WebSocketServer ws_server;
+    g_ws_client = &ws_client;
+    g_ws_server = &ws_server;
+
+    std::thread serverThread;
+    if (port > 0) {
+        serverThread = std::thread([&ws_server, port]() { ws_server.run(port); });
+        std::cout << "Serving on port " << port << ", press Enter to start the replay" << std::endl;
+        std::cin.get();
+    } else {
+        ws_server.start_fanout();
+    }
+
+    JournalReplay replay(segments);
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+    auto start = steady_clock::now();
+    try {
+        for (int loop = 0; loop < loops; ++loop) {
+            frames += replay.run([&ws_client, &bytes](std::string& payload) {
+                bytes += payload.size();
+                ws_client.on_frame(payload, LatencyClock::now());
+            }, paced, speed);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    double seconds = duration_cast<nanoseconds>(steady_clock::now() - start).count() / 1e9;
+
+    // Let the fan-out thread drain before reading its histograms.
+    while (ws_server.fanout_stats().depth > 0) {
+        std::this_thread::sleep_for(milliseconds(1));
+    }
+    getLogger().flush();
+
+    std::cout << "Replayed " << frames << " frames (" << bytes / (1024.0 * 1024.0) << " MB) from "
+              << segments.size() << " segment(s) in " << seconds << " s: "
+              << (seconds > 0 ? frames / seconds : 0.0) << " frames/s\n";
+    FanoutStats stats = ws_server.fanout_stats();
+    std::cout << "Fan-out queue: high water " << stats.high_water_mark << "/" << stats.capacity
+              << ", drops " << stats.drops << "\n";
+    std::cout << "Book gaps applied over: " << ws_client.book_gaps() << "\n\n";
+    std::cout << getLatencyTracker().generate_report() << std::endl;
+
+    if (serverThread.joinable()) {
+        ws_server.stop();
+        serverThread.join();
+    }
+    return 0;
+}
@@ -1,6 +1,93 @@
 #include "rest_client.hpp"
 #include "utils.hpp"
+#include "endpoints.hpp"
+#include "instruments.hpp"
+#include "order_encoder.hpp"
+#include "rate_limiter.hpp"
 #include <nlohmann/json.hpp>
+#include <stdexcept>
+
+namespace {
+
+// Same number formatting as the WebSocket order templates: exact, no
+// trailing zeros, and no locale or heap work.
+void append_decimal(std::string& url, double value) {
+    char digits[32];
+    url.append(digits, format_decimal(value, digits));
+}
+
+// These calls block anyway, so orders wait out the credit refill; queries
+// give up quickly rather than pile up behind them.
+const std::chrono::seconds kMatchingMaxWait(5);
+const std::chrono::milliseconds kQueryMaxWait(250);
+
+void acquire_credit(RequestClass request_class, std::chrono::nanoseconds max_wait) {
+    if (!getRateLimiter().acquire(request_class, max_wait)) {
+        throw std::runtime_error(std::string("Out of Deribit ") + request_class_name(request_class) +
+                                 " credits; request shed");
+    }
+}
+
+} // namespace
+
+std::string place_order_url(const std::string& instrument,
+                            double amount,
+                            const std::string& side,
+                            const std::string& order_type,
+                            double price) {
+    const std::string& base = rest_base_url();
+    std::string url;
+    url.reserve(base.size() + instrument.size() + 128);
+    url.append(base).append("/private/").append(side);
+
+    // Known instruments get their amount and price put on the grid here;
+    // an off-tick price would only come back as an error.
+    const InstrumentSpec* spec = getInstrumentCache().find(instrument);
+    char digits[32];
+    url.append("?amount=");
+    if (spec) {
+        url.append(digits, spec->format(spec->qty_from(amount), digits));
+    } else {
+        append_decimal(url, amount);
+    }
+    url.append("&instrument_name=").append(instrument);
+    url.append("&type=").append(order_type);
+
+    if (order_type == "limit") {
+        url.append("&price=");
+        if (spec) {
+            url.append(digits, spec->format(spec->price_from(price), digits));
+        } else {
+            append_decimal(url, price);
+        }
+    }
+    return url;
+}
+
+std::string cancel_order_url(const std::string& order_id) {
+    return rest_base_url() + "/private/cancel?order_id=" + order_id;
+}
+
+std::string modify_order_url(const std::string& order_id, double new_amount, double new_price) {
+    const std::string& base = rest_base_url();
+    std::string url;
+    url.reserve(base.size() + order_id.size() + 128);
+    url.append(base).append("/private/edit?order_id=").append(order_id);
+    url.append("&amount=");
+    append_decimal(url, new_amount);
+    url.append("&price=");
+    append_decimal(url, new_price);
+    return url;
+}
+
+std::string order_book_url(const std::string& instrument, int depth) {
+    return rest_base_url() + "/public/get_order_book?instrument_name="
+         + instrument + "&depth=" + std::to_string(depth);
+}
+
+std::string positions_url(const std::string& currency) {
+    return rest_base_url() + "/private/get_positions?currency=" + currency;
+}
 
 std::string place_order(const std::string& access_token,
                         const std::string& instrument,
@@ -8,50 +95,33 @@ std::string place_order(const std::string& access_token,
                         const std::string& side,
                         const std::string& order_type,
                         double price) {
-
-    std::string url = "https://test.deribit.com/api/v2/private/" + side;
-    
-    url += "?amount=" + std::to_string(amount);
-    url += "&instrument_name=" + instrument;
-    url += "&type=" + order_type;
-
-    if (order_type == "limit") {
-        url += "&price=" + std::to_string(price);
-    }
-
-    std::string response = http_post(url, "", access_token);
+    acquire_credit(RequestClass::MATCHING, kMatchingMaxWait);
+    std::string response = http_post(place_order_url(instrument, amount, side, order_type, price), "", access_token);
 
     return response;
 }
 
 std::string cancel_order(const std::string& access_token, const std::string& order_id) {
-    std::string url = "https://test.deribit.com/api/v2/private/cancel?order_id=" + order_id;
-
-    std::string response = http_post(url, "", access_token);
+    acquire_credit(RequestClass::MATCHING, kMatchingMaxWait);
+    std::string response = http_post(cancel_order_url(order_id), "", access_token);
 
     return response;
 }
 
 std::string modify_order(const std::string& access_token, const std::string& order_id, double new_amount, double new_price) {
-    std::string url = "https://test.deribit.com/api/v2/private/edit?order_id=" 
-                    + order_id + "&amount=" + std::to_string(new_amount)
-                    + "&price=" + std::to_string(new_price);
-
-    std::string response = http_post(url, "", access_token);
+    acquire_credit(RequestClass::MATCHING, kMatchingMaxWait);
+    std::string response = http_post(modify_order_url(order_id, new_amount, new_price), "", access_token);
     return response;
 }
 
 std::string get_order_book(const std::string& instrument, int depth) {
-    std::string url = "https://test.deribit.com/api/v2/public/get_order_book?instrument_name="
-                    + instrument + "&depth=" + std::to_string(depth);
-
-    std::string response = http_get(url);
+    acquire_credit(RequestClass::NON_MATCHING, kQueryMaxWait);
+    std::string response = http_get(order_book_url(instrument, depth));
     return response;
 }
 
 std::string get_positions(const std::string& access_token, const std::string& currency) {
-    std::string url = "https://test.deribit.com/api/v2/private/get_positions?currency=" + currency;
-
-    std::string response = http_get_with_auth(url, access_token);
+    acquire_credit(RequestClass::NON_MATCHING, kQueryMaxWait);
+    std::string response = http_get_with_auth(positions_url(currency), access_token);
     return response;
-}
\ No newline at end of file
+}
@@ -1,5 +1,8 @@
 #include "auth.hpp"
 #include "rest_client.hpp"
+#include "http_transport.hpp"
+#include "endpoints.hpp"
+#include "async_rest_client.hpp"
 #include "tracker.hpp"  
 #include <iostream>
 #include <nlohmann/json.hpp>
@@ -23,6 +26,9 @@ int main() {
         std::string token = get_access_token(client_id, client_secret);
         std::cout << "Access Token: " << token << "\n";
 
+        // Measure steady-state order latency, not the first connection setup.
+        getHttpTransport().warm_up(rest_base_url() + "/public/test");
+
         LatencyTracker& tracker = getLatencyTracker();
 
         // Place 10 market orders for BTC-PERPETUAL in a loop.
@@ -44,6 +50,31 @@ int main() {
 
         std::cout << tracker.generate_report() << std::endl;
 
+        // Same orders again, all in flight at once from a single event loop thread.
+        tracker.reset();
+        AsyncRestClient async_client(token);
+        const int batch_size = 10;
+        std::vector<std::future<std::string>> responses;
+        auto batch_start = steady_clock::now();
+        for (int i = 0; i < batch_size; ++i) {
+            uint64_t sent_at = LatencyClock::now();
+            async_client.place_order("BTC-PERPETUAL", 10, "buy", "market", 0.0, [&tracker, sent_at](HttpResult&&) {
+                tracker.record_since(LatencyTracker::ORDER_PLACEMENT, sent_at);
+            });
+            responses.push_back(async_client.get_positions("BTC"));
+        }
+        for (auto& response : responses) {
+            response.wait();
+        }
+        while (async_client.in_flight() > 0) {
+            std::this_thread::sleep_for(milliseconds(1));
+        }
+        auto batch_us = duration_cast<microseconds>(steady_clock::now() - batch_start).count();
+
+        std::cout << "Async batch: " << batch_size << " orders and " << batch_size
+                  << " position queries in " << batch_us << " us\n";
+        std::cout << tracker.generate_report() << std::endl;
+
     } catch(const std::exception& e) {
         std::cerr << "Error: " << e.what() << "\n";
     }
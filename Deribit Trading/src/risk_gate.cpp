@@ -0,0 +1,219 @@
+#include "risk_gate.hpp"
+#include "logger.hpp"
+#include "tracker.hpp"
+#include "utils.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Sets one RiskLimits field by name; false for an unknown key.
+bool set_field(RiskLimits& limits, const std::string& key, double value) {
+    if (key == "max_order_amount") limits.max_order_amount = value;
+    else if (key == "max_notional") limits.max_notional = value;
+    else if (key == "price_band_bps") limits.price_band_bps = value;
+    else if (key == "max_position") limits.max_position = value;
+    else return false;
+    return true;
+}
+
+// Relaxed read-modify-write for single-writer counters.
+void add_relaxed(std::atomic<double>& target, double delta) {
+    target.store(target.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+} // namespace
+
+const char* risk_result_name(RiskResult result) {
+    switch (result) {
+    case RiskResult::ACCEPTED: return "accepted";
+    case RiskResult::KILL_SWITCH: return "kill switch engaged";
+    case RiskResult::RATE_LIMIT: return "order rate limit";
+    case RiskResult::ORDER_SIZE: return "max order amount";
+    case RiskResult::NOTIONAL: return "max notional";
+    case RiskResult::PRICE_BAND: return "price outside band";
+    case RiskResult::POSITION: return "position limit";
+    case RiskResult::EXPOSURE_UNKNOWN: return "positions not loaded";
+    case RiskResult::NO_MARK: return "no mark to value market order";
+    case RiskResult::RESULT_COUNT: break;
+    }
+    return "unknown";
+}
+
+const size_t RiskGate::kSessionSlots;
+
+RiskGate::RiskGate()
+    : limits_(new RiskLimits[InstrumentRegistry::kMaxInstruments]),
+      exposure_(new Exposure[InstrumentRegistry::kMaxInstruments]),
+      sessions_(new SessionRate[kSessionSlots]) {
+    for (auto& count : rejects_) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+void RiskGate::load(const std::string& path) {
+    RiskLimits defaults;
+    std::vector<std::pair<std::string, double>> overrides;
+    read_config_file(path, "risk limits", [&](const std::string& key, const std::string& value_text,
+                                              const std::string& where) {
+        char* end = nullptr;
+        double value = std::strtod(value_text.c_str(), &end);
+        if (value_text.empty() || *end != '\0' || value < 0.0) {
+            throw std::runtime_error(where + "bad value for " + key);
+        }
+
+        if (key == "max_orders_per_second") {
+            set_session_rate(static_cast<uint32_t>(value));
+            return;
+        }
+        if (set_field(defaults, key, value)) return;
+
+        // <instrument>.<field>; applied once every default is known.
+        size_t dot = key.rfind('.');
+        RiskLimits probe;
+        if (dot == std::string::npos || !set_field(probe, key.substr(dot + 1), value)) {
+            throw std::runtime_error(where + "unknown key " + key);
+        }
+        overrides.emplace_back(key, value);
+    });
+
+    set_default_limits(defaults);
+    for (const auto& entry : overrides) {
+        size_t dot = entry.first.rfind('.');
+        uint32_t id = getInstrumentRegistry().intern(entry.first.substr(0, dot));
+        if (id == InstrumentRegistry::kInvalidId) continue;
+        set_field(limits_[id], entry.first.substr(dot + 1), entry.second);
+    }
+    LOG_INFO("[Risk] Loaded {}: {} instrument overrides, {} orders/s per session", path, overrides.size(),
+             session_rate_);
+}
+
+void RiskGate::set_default_limits(const RiskLimits& limits) {
+    for (uint32_t id = 0; id < InstrumentRegistry::kMaxInstruments; ++id) {
+        limits_[id] = limits;
+    }
+}
+
+void RiskGate::set_limits(uint32_t instrument, const RiskLimits& limits) {
+    if (instrument < InstrumentRegistry::kMaxInstruments) {
+        limits_[instrument] = limits;
+    }
+}
+
+RiskResult RiskGate::reject(RiskResult result) {
+    rejects_[static_cast<size_t>(result)].fetch_add(1, std::memory_order_relaxed);
+    return result;
+}
+
+RiskResult RiskGate::check_session(uint32_t session) {
+    if (killed_.load(std::memory_order_relaxed)) return reject(RiskResult::KILL_SWITCH);
+    if (session_rate_ == 0) return RiskResult::ACCEPTED;
+
+    SessionRate& rate = sessions_[session % kSessionSlots];
+    int64_t window = static_cast<int64_t>(LatencyClock::to_nanoseconds(LatencyClock::now()) / 1000000000ULL);
+    if (rate.session.load(std::memory_order_relaxed) != session || rate.window.load(std::memory_order_relaxed) != window) {
+        rate.session.store(session, std::memory_order_relaxed);
+        rate.window.store(window, std::memory_order_relaxed);
+        rate.count.store(0, std::memory_order_relaxed);
+    }
+    if (rate.count.fetch_add(1, std::memory_order_relaxed) >= session_rate_) {
+        return reject(RiskResult::RATE_LIMIT);
+    }
+    return RiskResult::ACCEPTED;
+}
+
+RiskResult RiskGate::check(uint32_t session, uint32_t instrument, OrderSide side, double amount, double price,
+                           double replaced) {
+    ScopedLatency latency(LatencyTracker::PRE_TRADE_RISK);
+    RiskResult result = check_session(session);
+    if (result != RiskResult::ACCEPTED || instrument >= InstrumentRegistry::kMaxInstruments) return result;
+
+    const RiskLimits& limits = limits_[instrument];
+    const Exposure& exposure = exposure_[instrument];
+    if (limits.max_order_amount > 0.0 && amount > limits.max_order_amount) {
+        return reject(RiskResult::ORDER_SIZE);
+    }
+
+    double mid = exposure.mid.load(std::memory_order_relaxed);
+    if (limits.max_notional > 0.0) {
+        const InstrumentSpec* spec = getInstrumentCache().find(instrument);
+        bool inverse = spec && spec->inverse;
+        double value_price = price > 0.0 ? price : mid;
+        if (!inverse && value_price <= 0.0) return reject(RiskResult::NO_MARK);
+        double notional = inverse ? amount : amount * value_price;
+        if (notional > limits.max_notional) return reject(RiskResult::NOTIONAL);
+    }
+
+    // Market orders trade at whatever the book offers. Without a mid, from
+    // a live book, a limit price cannot be checked against the band.
+    if (limits.price_band_bps > 0.0 && price > 0.0) {
+        if (mid <= 0.0) return reject(RiskResult::NO_MARK);
+        if (std::fabs(price - mid) * 10000.0 > limits.price_band_bps * mid) {
+            return reject(RiskResult::PRICE_BAND);
+        }
+    }
+
+    // Worst case: every open order on this side fills along with this one.
+    // Orders that bring an oversized position back toward the limit pass.
+    if (limits.max_position > 0.0) {
+        if (!exposure_loaded()) return reject(RiskResult::EXPOSURE_UNKNOWN);
+        double position = exposure.position.load(std::memory_order_relaxed);
+        double before = side == OrderSide::BUY
+            ? position + exposure.open_buy.load(std::memory_order_relaxed)
+            : position - exposure.open_sell.load(std::memory_order_relaxed);
+        double added = amount - replaced;
+        double after = side == OrderSide::BUY ? before + added : before - added;
+        if (std::fabs(after) > limits.max_position && std::fabs(after) > std::fabs(before)) {
+            return reject(RiskResult::POSITION);
+        }
+    }
+    return RiskResult::ACCEPTED;
+}
+
+void RiskGate::set_mid(uint32_t instrument, double mid) {
+    if (instrument < InstrumentRegistry::kMaxInstruments) {
+        exposure_[instrument].mid.store(mid, std::memory_order_relaxed);
+    }
+}
+
+void RiskGate::add_position(uint32_t instrument, double signed_amount) {
+    if (instrument < InstrumentRegistry::kMaxInstruments) {
+        add_relaxed(exposure_[instrument].position, signed_amount);
+    }
+}
+
+void RiskGate::load_positions(const std::vector<std::pair<uint32_t, double>>& positions) {
+    for (uint32_t id = 0; id < InstrumentRegistry::kMaxInstruments; ++id) {
+        exposure_[id].position.store(0.0, std::memory_order_relaxed);
+    }
+    for (const auto& position : positions) {
+        if (position.first < InstrumentRegistry::kMaxInstruments) {
+            exposure_[position.first].position.store(position.second, std::memory_order_relaxed);
+        }
+    }
+}
+
+void RiskGate::add_open(uint32_t instrument, OrderSide side, double amount_delta) {
+    if (instrument < InstrumentRegistry::kMaxInstruments) {
+        Exposure& exposure = exposure_[instrument];
+        add_relaxed(side == OrderSide::BUY ? exposure.open_buy : exposure.open_sell, amount_delta);
+    }
+}
+
+double RiskGate::mid(uint32_t instrument) const {
+    return instrument < InstrumentRegistry::kMaxInstruments
+        ? exposure_[instrument].mid.load(std::memory_order_relaxed) : 0.0;
+}
+
+double RiskGate::position(uint32_t instrument) const {
+    return instrument < InstrumentRegistry::kMaxInstruments
+        ? exposure_[instrument].position.load(std::memory_order_relaxed) : 0.0;
+}
+
+RiskGate& getRiskGate() {
+    static RiskGate gate;
+    return gate;
+}
@@ -0,0 +1,137 @@
+#include "threading.hpp"
+#include "logger.hpp"
+#include "utils.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <pthread.h>
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace {
+
+bool parse_role(const std::string& name, ThreadRole& role) {
+    for (size_t r = 0; r < static_cast<size_t>(ThreadRole::ROLE_COUNT); ++r) {
+        if (name == thread_role_name(static_cast<ThreadRole>(r))) {
+            role = static_cast<ThreadRole>(r);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Linux caps thread names at 15 characters; later instances of a role end
+// in their instance number.
+std::string thread_name(ThreadRole role, size_t instance) {
+    std::string name = thread_role_name(role);
+    if (instance == 0) return name;
+    std::string suffix = std::to_string(instance);
+    return name.substr(0, 14 - suffix.size()) + "." + suffix;
+}
+
+bool parse_int(const std::string& text, long& value) {
+    char* end = nullptr;
+    value = std::strtol(text.c_str(), &end, 10);
+    return !text.empty() && *end == '\0';
+}
+
+} // namespace
+
+const char* thread_role_name(ThreadRole role) {
+    switch (role) {
+    case ThreadRole::DERIBIT_INGRESS: return "deribit_ingress";
+    case ThreadRole::ORDER_EGRESS: return "order_egress";
+    case ThreadRole::FANOUT: return "fanout";
+    case ThreadRole::SERVER_IO: return "server_io";
+    case ThreadRole::ROLE_COUNT: break;
+    }
+    return "unknown";
+}
+
+void ThreadingConfig::load(const std::string& path) {
+    read_config_file(path, "thread config", [this](const std::string& setting, const std::string& value,
+                                                   const std::string& where) {
+        size_t dot = setting.find('.');
+        if (dot == std::string::npos) {
+            throw std::runtime_error(where + "expected <role>.<key> = value");
+        }
+        ThreadRole role;
+        if (!parse_role(trim(setting.substr(0, dot)), role)) {
+            throw std::runtime_error(where + "unknown thread " + trim(setting.substr(0, dot)));
+        }
+        std::string key = trim(setting.substr(dot + 1));
+
+        ThreadSettings& settings = settings_[static_cast<size_t>(role)];
+        long number_value = 0;
+        if (key == "cpu" && parse_int(value, number_value) && number_value >= -1) {
+            settings.cpu = static_cast<int>(number_value);
+        } else if (key == "rt_priority" && parse_int(value, number_value) && number_value >= 0 && number_value <= 99) {
+            settings.rt_priority = static_cast<int>(number_value);
+        } else if (key == "busy_poll" && (value == "1" || value == "true")) {
+            settings.busy_poll = true;
+        } else if (key == "busy_poll" && (value == "0" || value == "false")) {
+            settings.busy_poll = false;
+        } else {
+            throw std::runtime_error(where + "bad setting " + key + " = " + value);
+        }
+    });
+    LOG_INFO("[Threads] Loaded {}", path);
+}
+
+void ThreadingConfig::set(ThreadRole role, const ThreadSettings& settings) {
+    settings_[static_cast<size_t>(role)] = settings;
+}
+
+void ThreadingConfig::apply(ThreadRole role, size_t instance) const {
+    const ThreadSettings& config = settings(role);
+    std::string thread = thread_name(role, instance);
+    const char* name = thread.c_str();
+    int cpu = config.cpu >= 0 ? config.cpu + static_cast<int>(instance) : -1;
+#if defined(__linux__)
+    pthread_setname_np(pthread_self(), name);
+    if (cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        int rc = EINVAL;
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &cpus);
+            rc = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        }
+        if (rc != 0) {
+            LOG_WARN("[Threads] {}: cannot pin to CPU {}: {}", name, cpu, std::strerror(rc));
+        }
+    }
+    if (config.rt_priority > 0) {
+        sched_param param{};
+        param.sched_priority = config.rt_priority;
+        int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (rc != 0) {
+            LOG_WARN("[Threads] {}: SCHED_FIFO {} refused (needs CAP_SYS_NICE): {}", name, config.rt_priority,
+                     std::strerror(rc));
+        }
+    }
+#else
+#if defined(__APPLE__)
+    pthread_setname_np(name);
+#endif
+    if (cpu >= 0 || config.rt_priority > 0) {
+        LOG_WARN("[Threads] {}: CPU pinning and real-time priority are only applied on Linux", name);
+    }
+#endif
+    LOG_INFO("[Threads] {} started: cpu {}, rt priority {}, {}", name, cpu, config.rt_priority,
+             config.busy_poll ? "busy poll" : "blocking");
+}
+
+std::thread ThreadingConfig::spawn(ThreadRole role, std::function<void()> body, size_t instance) const {
+    return std::thread([this, role, body, instance]() {
+        apply(role, instance);
+        body();
+    });
+}
+
+ThreadingConfig& getThreadingConfig() {
+    static ThreadingConfig config;
+    return config;
+}
@@ -1,105 +1,287 @@
 #include "tracker.hpp"
 #include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <limits>
+#include <thread>
+
+#if defined(LATENCY_TRACKER_USE_TSC) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#include <x86intrin.h>
+#define LATENCY_TRACKER_HAVE_TSC 1
+#endif
+
+namespace {
+
+uint64_t steady_nanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#ifdef LATENCY_TRACKER_HAVE_TSC
+struct TscCalibration {
+    bool usable{false};
+    double nanoseconds_per_tick{1.0};
+
+    TscCalibration() {
+        unsigned eax, ebx, ecx, edx;
+        // CPUID 0x80000007 EDX bit 8: TSC runs at a constant rate in all power states.
+        if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1u << 8))) return;
+
+        uint64_t steady_start = steady_nanoseconds();
+        uint64_t tsc_start = __rdtsc();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        uint64_t steady_end = steady_nanoseconds();
+        uint64_t tsc_end = __rdtsc();
+
+        if (tsc_end <= tsc_start) return;
+        nanoseconds_per_tick = static_cast<double>(steady_end - steady_start) / (tsc_end - tsc_start);
+        usable = true;
+    }
+};
+
+const TscCalibration& tsc() {
+    static TscCalibration calibration;
+    return calibration;
+}
+#endif
+
+} // namespace
+
+uint64_t LatencyClock::now() {
+#ifdef LATENCY_TRACKER_HAVE_TSC
+    if (tsc().usable) return __rdtsc();
+#endif
+    return steady_nanoseconds();
+}
+
+uint64_t LatencyClock::to_nanoseconds(uint64_t ticks) {
+#ifdef LATENCY_TRACKER_HAVE_TSC
+    if (tsc().usable) return static_cast<uint64_t>(ticks * tsc().nanoseconds_per_tick);
+#endif
+    return ticks;
+}
+
+bool LatencyClock::using_tsc() {
+#ifdef LATENCY_TRACKER_HAVE_TSC
+    return tsc().usable;
+#else
+    return false;
+#endif
+}
+
+const int LatencyHistogram::kSubBucketBits;
+const uint64_t LatencyHistogram::kSubBucketCount;
+const uint64_t LatencyHistogram::kSubBucketHalf;
+const int LatencyHistogram::kMaxValueBits;
+const size_t LatencyHistogram::kBucketCount;
+
+LatencyHistogram::LatencyHistogram()
+    : counts_(new std::atomic<uint64_t>[kBucketCount]) {
+    reset();
+}
+
+LatencyHistogram::LatencyHistogram(const LatencyHistogram& other)
+    : counts_(new std::atomic<uint64_t>[kBucketCount]) {
+    reset();
+    merge(other);
+}
+
+LatencyHistogram& LatencyHistogram::operator=(const LatencyHistogram& other) {
+    if (this != &other) {
+        reset();
+        merge(other);
+    }
+    return *this;
+}
+
+size_t LatencyHistogram::index_of(uint64_t value) {
+    const uint64_t max_value = (1ULL << kMaxValueBits) - 1;
+    if (value > max_value) value = max_value;
+    if (value < kSubBucketCount) return static_cast<size_t>(value);
+
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - (kSubBucketBits - 1);
+    uint64_t sub_bucket = (value >> shift) - kSubBucketHalf;
+    return static_cast<size_t>(kSubBucketCount + (shift - 1) * kSubBucketHalf + sub_bucket);
+}
+
+uint64_t LatencyHistogram::highest_equivalent(size_t index) {
+    if (index < kSubBucketCount) return index;
+    uint64_t offset = index - kSubBucketCount;
+    int shift = static_cast<int>(offset / kSubBucketHalf) + 1;
+    uint64_t sub_bucket = offset % kSubBucketHalf + kSubBucketHalf;
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+// Single writer, so plain load/store pairs are enough; readers on other
+// threads see each counter atomically.
+void LatencyHistogram::record(uint64_t nanoseconds) {
+    std::atomic<uint64_t>& bucket = counts_[index_of(nanoseconds)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    sum_.store(sum_.load(std::memory_order_relaxed) + nanoseconds, std::memory_order_relaxed);
+    if (nanoseconds < min_.load(std::memory_order_relaxed)) min_.store(nanoseconds, std::memory_order_relaxed);
+    if (nanoseconds > max_.load(std::memory_order_relaxed)) max_.store(nanoseconds, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        uint64_t n = other.counts_[i].load(std::memory_order_relaxed);
+        if (n) counts_[i].fetch_add(n, std::memory_order_relaxed);
+    }
+    count_.fetch_add(other.count(), std::memory_order_relaxed);
+    sum_.fetch_add(other.sum_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    uint64_t other_min = other.min_.load(std::memory_order_relaxed);
+    if (other_min < min_.load(std::memory_order_relaxed)) min_.store(other_min, std::memory_order_relaxed);
+    if (other.max() > max()) max_.store(other.max(), std::memory_order_relaxed);
+}
+
+void LatencyHistogram::reset() {
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        counts_[i].store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    min_.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::min() const {
+    return count() ? min_.load(std::memory_order_relaxed) : 0;
+}
+
+double LatencyHistogram::mean() const {
+    uint64_t n = count();
+    return n ? static_cast<double>(sum_.load(std::memory_order_relaxed)) / n : 0.0;
+}
+
+uint64_t LatencyHistogram::value_at_percentile(double percentile) const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        total += counts_[i].load(std::memory_order_relaxed);
+    }
+    if (total == 0) return 0;
+
+    uint64_t target = static_cast<uint64_t>(percentile / 100.0 * total + 0.5);
+    if (target < 1) target = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        seen += counts_[i].load(std::memory_order_relaxed);
+        if (seen >= target) {
+            uint64_t value = highest_equivalent(i);
+            return value < max() ? value : max();
+        }
+    }
+    return max();
+}
+
+LatencyTracker::ThreadRecorder& LatencyTracker::thread_recorder() {
+    static thread_local ThreadRecorder* recorder = nullptr;
+    if (!recorder) {
+        std::lock_guard<std::mutex> lock(recorders_mutex_);
+        recorders_.emplace_back(new ThreadRecorder());
+        recorder = recorders_.back().get();
+    }
+    return *recorder;
+}
+
+void LatencyTracker::record(LatencyType type, uint64_t nanoseconds) {
+    thread_recorder().histograms[type].record(nanoseconds);
+}
+
+void LatencyTracker::record_since(LatencyType type, uint64_t start_ticks) {
+    record(type, LatencyClock::to_nanoseconds(LatencyClock::now() - start_ticks));
+}
 
 void LatencyTracker::start_measurement(LatencyType type, const std::string& unique_id) {
-    std::lock_guard<std::mutex> lock(metrics_mutex);
-    
-    LatencyMetric metric;
-    metric.start_time = std::chrono::high_resolution_clock::now();
-    
+    uint64_t now = LatencyClock::now();
     if (unique_id.empty()) {
-        latency_metrics[type].push_back(metric);
-    } else {
-        active_measurements[unique_id] = metric;
+        thread_recorder().pending_start[type] = now;
+        return;
     }
+    std::lock_guard<std::mutex> lock(keyed_mutex_);
+    keyed_starts_[unique_id] = now;
 }
 
 void LatencyTracker::stop_measurement(LatencyType type, const std::string& unique_id) {
-    std::lock_guard<std::mutex> lock(metrics_mutex);
-    auto end_time = std::chrono::high_resolution_clock::now();
-    
+    uint64_t now = LatencyClock::now();
+    uint64_t start;
     if (unique_id.empty()) {
-        for (auto& metric : latency_metrics[type]) {
-            if (!metric.completed) {
-                metric.end_time = end_time;
-                metric.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
-                    metric.end_time - metric.start_time
-                );
-                metric.completed = true;
-                break;
-            }
-        }
+        ThreadRecorder& recorder = thread_recorder();
+        start = recorder.pending_start[type];
+        if (start == 0) return;
+        recorder.pending_start[type] = 0;
     } else {
-        auto it = active_measurements.find(unique_id);
-        if (it != active_measurements.end()) {
-            it->second.end_time = end_time;
-            it->second.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
-                it->second.end_time - it->second.start_time
-            );
-            it->second.completed = true;
-            latency_metrics[type].push_back(it->second);
-            active_measurements.erase(it);
-        }
+        std::lock_guard<std::mutex> lock(keyed_mutex_);
+        auto it = keyed_starts_.find(unique_id);
+        if (it == keyed_starts_.end()) return;
+        start = it->second;
+        keyed_starts_.erase(it);
     }
+    record(type, LatencyClock::to_nanoseconds(now - start));
+}
+
+LatencyHistogram LatencyTracker::snapshot(LatencyType type) {
+    LatencyHistogram merged;
+    std::lock_guard<std::mutex> lock(recorders_mutex_);
+    for (const auto& recorder : recorders_) {
+        merged.merge(recorder->histograms[type]);
+    }
+    return merged;
 }
 
 std::string LatencyTracker::generate_report() {
-    std::lock_guard<std::mutex> lock(metrics_mutex);
-    
     std::ostringstream report;
     report << "Latency Benchmarking Report\n";
     report << "------------------------------\n\n";
 
     const char* type_names[] = {
         "Order Placement",
-        "Market Data Processing", 
-        "WebSocket Message Propagation", 
-        "Trading Loop End-to-End"
+        "Market Data Processing",
+        "WebSocket Message Propagation",
+        "Trading Loop End-to-End",
+        "Order Cancel",
+        "Order Modify",
+        "Pre-Trade Risk Check"
     };
+    const double percentiles[] = {50.0, 90.0, 99.0, 99.9, 99.99};
+    const char* percentile_names[] = {"p50", "p90", "p99", "p99.9", "p99.99"};
+
+    report << std::fixed << std::setprecision(3);
+    for (int t = 0; t < LATENCY_TYPE_COUNT; ++t) {
+        LatencyHistogram histogram = snapshot(static_cast<LatencyType>(t));
+        if (histogram.count() == 0) continue;
 
-    for (int t = 0; t < 4; ++t) {
-        auto type = static_cast<LatencyTracker::LatencyType>(t);
-        auto metrics = latency_metrics[type];
-        if (metrics.empty()) continue;
-        
-        std::vector<std::chrono::nanoseconds> durations;
-        for (const auto& metric : metrics) {
-            if (metric.completed) {
-                durations.push_back(metric.duration);
-            }
-        }
-        
-        if (durations.empty()) {
-            report << type_names[t] << " Latency: No completed measurements\n\n";
-            continue;
-        }
-        
-        std::sort(durations.begin(), durations.end());
-        size_t count = durations.size();
-        auto total = std::accumulate(durations.begin(), durations.end(), std::chrono::nanoseconds(0));
-        auto mean = total / count;
-        auto min_val = durations.front();
-        auto max_val = durations.back();
-        
         report << type_names[t] << ":\n";
-        report << "  Total Measurements: " << count << "\n";
-        report << "  Mean Latency: " << std::fixed << std::setprecision(3) << mean.count() / 1e6 << " ms\n";
-        report << "  Min Latency: " << min_val.count() / 1e6 << " ms\n";
-        report << "  Max Latency: " << max_val.count() / 1e6 << " ms\n";
+        report << "  Total Measurements: " << histogram.count() << "\n";
+        report << "  Mean Latency: " << histogram.mean() / 1e3 << " us\n";
+        report << "  Min Latency: " << histogram.min() / 1e3 << " us\n";
+        for (size_t p = 0; p < sizeof(percentiles) / sizeof(percentiles[0]); ++p) {
+            report << "  " << percentile_names[p] << " Latency: "
+                   << histogram.value_at_percentile(percentiles[p]) / 1e3 << " us\n";
+        }
+        report << "  Max Latency: " << histogram.max() / 1e3 << " us\n\n";
     }
-    
-    return report.str();
-}
 
-std::map<LatencyTracker::LatencyType, std::vector<LatencyTracker::LatencyMetric>> LatencyTracker::get_raw_metrics() {
-    std::lock_guard<std::mutex> lock(metrics_mutex);
-    return latency_metrics;
+    return report.str();
 }
 
+// Recording threads are not paused, so a value recorded concurrently with
+// reset() may survive it.
 void LatencyTracker::reset() {
-    std::lock_guard<std::mutex> lock(metrics_mutex);
-    latency_metrics.clear();
-    active_measurements.clear();
+    {
+        std::lock_guard<std::mutex> lock(recorders_mutex_);
+        for (const auto& recorder : recorders_) {
+            for (auto& histogram : recorder->histograms) {
+                histogram.reset();
+            }
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(keyed_mutex_);
+        keyed_starts_.clear();
+    }
     std::cout << "Latency metrics have been reset." << std::endl;
 }
 
@@ -1,13 +1,72 @@
 #include "websocket_client.hpp"
 #include <asio.hpp>
-#include <iostream>
+#include "logger.hpp"
 #include <nlohmann/json.hpp>
 #include "websocket_server.hpp" 
+#include "order_book.hpp"
+#include "order_manager.hpp"
+#include "risk_gate.hpp"
+#include "notification_parser.hpp"
+#include "tracker.hpp"
+#include "journal.hpp"
+#include "rate_limiter.hpp"
+#include "threading.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
 
 using json = nlohmann::json;
 
+namespace {
+
+bool valid_book_interval(const std::string& interval) {
+    return interval == "raw" || interval == "100ms" || interval == "agg2";
+}
+
+// Orders can be sent from any thread (the downstream server's IO thread,
+// the main thread), so each keeps its own encoder. The session is
+// authenticated, so the templates carry no token.
+OrderEncoder& thread_encoder() {
+    static thread_local OrderEncoder encoder;
+    return encoder;
+}
+
+} // namespace
+
 extern WebSocketServer* g_ws_server;
 
+void BookChannelConfig::configure(const std::string& spec) {
+    size_t begin = 0;
+    while (begin <= spec.size()) {
+        size_t end = spec.find(',', begin);
+        if (end == std::string::npos) end = spec.size();
+        std::string item = spec.substr(begin, end - begin);
+        begin = end + 1;
+        if (item.empty()) continue;
+        size_t eq = item.find('=');
+        std::string interval = eq == std::string::npos ? item : item.substr(eq + 1);
+        if (!valid_book_interval(interval)) {
+            throw std::invalid_argument("Unknown book interval " + interval + " (raw, 100ms or agg2)");
+        }
+        if (eq == std::string::npos) {
+            default_interval_ = interval;
+        } else {
+            intervals_[item.substr(0, eq)] = interval;
+        }
+    }
+    LOG_INFO("[Client] Book channels: {} by default, {} instrument override(s)", default_interval_, intervals_.size());
+}
+
+const std::string& BookChannelConfig::interval(const std::string& instrument) const {
+    auto it = intervals_.find(instrument);
+    return it != intervals_.end() ? it->second : default_interval_;
+}
+
+BookChannelConfig& getBookChannelConfig() {
+    static BookChannelConfig config;
+    return config;
+}
+
 websocketpp::lib::shared_ptr<asio::ssl::context> WebSocketClient::on_tls_init() {
     websocketpp::lib::shared_ptr<asio::ssl::context> ctx =
         websocketpp::lib::make_shared<asio::ssl::context>(asio::ssl::context::tlsv12);
@@ -15,42 +74,54 @@ websocketpp::lib::shared_ptr<asio::ssl::context> WebSocketClient::on_tls_init()
     return ctx;
 }
 
-WebSocketClient::WebSocketClient() {
+const size_t WebSocketClient::kPendingSlots;
+const size_t WebSocketClient::kMaxQueuedQueries;
+const uint64_t WebSocketClient::kMaxQueryWaitMs;
+const uint64_t WebSocketClient::kAwaitingSubscription;
+const size_t WebSocketClient::kMaxBufferedDeltas;
+const int WebSocketClient::kResyncDepth;
+const long WebSocketClient::kAuthRetryMs;
+const long WebSocketClient::kMaxAuthRetryMs;
+const long WebSocketClient::kSeedRetryMs;
+
+WebSocketClient::WebSocketClient(ThreadRole role)
+    : role_(role), pending_(new PendingRequest[kPendingSlots]) {
+    for (auto& count : scheduled_count_) {
+        count.store(0, std::memory_order_relaxed);
+    }
     ws_client.init_asio();
 
-    ws_client.set_message_handler([this](websocketpp::connection_hdl hdl, client::message_ptr msg) {
-        std::string payload = msg->get_payload();
-        std::cout << "[Deribit] Received: " << payload << std::endl;
-        
-        try {
-            json j = json::parse(payload);
-            if (j.contains("params") && j["params"].contains("channel")) {
-                std::string channel = j["params"]["channel"];
-                // Expect channel format: "book.<instrument>.100ms"
-                if (channel.size() > 11) {
-                    std::string instrument = channel.substr(5, channel.size() - 5 - 6);
-                    std::cout << "[Deribit] Broadcasting to " << instrument << ": " << payload << std::endl;
-                    if (g_ws_server) {
-                        g_ws_server->broadcast(instrument, payload);
-                    }
-                }
-            } else {
-            // This is a private response (e.g., for order management).
-            std::cout << "[Deribit] Private response: " << payload << std::endl;
-            // Broadcast private responses on a dedicated "private" channel.
-            if (g_ws_server) {
-                g_ws_server->broadcast("private", payload);
-            }
-         }
-        } catch (const std::exception& e) {
-            std::cerr << "[Deribit] Error parsing message: " << e.what() << std::endl;
+    ws_client.set_message_handler([this](websocketpp::connection_hdl, client::message_ptr msg) {
+        uint64_t received_at = LatencyClock::now();
+        std::string& payload = msg->get_raw_payload();
+        if (JournalWriter* journal = journal_.get()) {
+            journal->append(payload.data(), payload.size(), std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count());
         }
+        // The frame is ours once the handler runs, so downstream may take its buffer.
+        on_frame(payload, received_at);
     });
 
     ws_client.set_tls_init_handler(std::bind(&WebSocketClient::on_tls_init, this));
     ws_client.set_open_handler([this](websocketpp::connection_hdl hdl){
         hdl_ = hdl;
-        std::cout << "[Client] Connected clearly to Deribit." << std::endl;
+        LOG_INFO("[Client] Connected clearly to Deribit ({}).", thread_role_name(role_));
+        if (!client_id_.empty()) {
+            // A new connection starts unauthenticated, whatever the last one was.
+            ++connection_epoch_;
+            clear_session("new connection");
+            send_auth();
+        }
+    });
+    ws_client.set_close_handler([this](websocketpp::connection_hdl) {
+        LOG_WARN("[Client] Connection to Deribit closed ({}).", thread_role_name(role_));
+        ++connection_epoch_;
+        clear_session("connection closed");
+    });
+    ws_client.set_fail_handler([this](websocketpp::connection_hdl) {
+        LOG_ERROR("[Client] Connection to Deribit failed ({}).", thread_role_name(role_));
+        ++connection_epoch_;
+        clear_session("connection failed");
     });
 }
 
@@ -58,18 +129,352 @@ WebSocketClient::~WebSocketClient() {
     ws_client.stop();
 }
 
+void WebSocketClient::on_frame(std::string& payload, uint64_t received_at) {
+    LOG_EVERY_MS(LOG_LEVEL_INFO, 1000, "[Deribit] Received: {} ({} more since last sample)", LogText(payload));
+
+    // Subscription notifications take the allocation-free scanner; only RPC
+    // responses and anything it does not recognise go through nlohmann.
+    Notification note;
+    if (parse_notification(payload.data(), payload.size(), note)) {
+        if (note.kind == NotificationKind::USER) {
+            getOrderManager().on_notification(note);
+            return;
+        }
+        if (note.instrument.empty()) return;
+        // Interning is a lock-free lookup after the first frame for an instrument;
+        // everything downstream routes on the id.
+        uint32_t instrument = getInstrumentRegistry().intern(note.instrument);
+        if (instrument == InstrumentRegistry::kInvalidId) return;
+        MarketEvent event;
+        event.instrument = instrument;
+        bool book_snapshot = false;
+        if (note.kind == NotificationKind::BOOK) {
+            if (!apply_book_update(instrument, note.book, payload, received_at)) return;
+            book_snapshot = note.book.snapshot;
+            event.kind = MarketEvent::BOOK;
+            event.timestamp = note.book.timestamp;
+            event.change_id = note.book.change_id;
+        } else if (note.kind == NotificationKind::TICKER) {
+            event.kind = MarketEvent::TICKER;
+            event.timestamp = note.ticker.timestamp;
+        } else if (note.kind == NotificationKind::TRADES) {
+            event.kind = MarketEvent::TRADES;
+        }
+        LOG_DEBUG("[Deribit] Broadcasting to {}: {}", LogText(note.instrument.data, note.instrument.size), LogText(payload));
+        event.received_at = received_at;
+        if (g_ws_server) {
+            event.payload = std::move(payload);
+            g_ws_server->publish(std::move(event), producer_);
+        }
+        getLatencyTracker().record_since(LatencyTracker::MARKET_DATA_PROCESSING, received_at);
+        if (book_snapshot && !resync_.empty()) {
+            replay_buffered(instrument);
+        }
+        return;
+    }
+
+    try {
+        json j = json::parse(payload);
+        if (j.contains("id") && j["id"].is_number_unsigned()) {
+            bool throttled = j.contains("error") && j["error"].is_object() &&
+                             j["error"].value("code", 0) == 10028;
+            complete_request(j["id"].get<uint64_t>(), payload, throttled);
+        } else {
+            LOG_DEBUG("[Deribit] Unhandled message: {}", LogText(payload));
+        }
+    } catch (const std::exception& e) {
+        LOG_ERROR("[Deribit] Error parsing message: {}", e.what());
+    }
+}
+
+uint64_t WebSocketClient::begin_request(RequestKind kind, uint32_t origin) {
+    uint64_t id = next_request_id_.fetch_add(1, std::memory_order_relaxed);
+    PendingRequest& slot = pending_[id % kPendingSlots];
+    slot.kind.store(static_cast<uint8_t>(kind), std::memory_order_relaxed);
+    slot.origin.store(origin, std::memory_order_relaxed);
+    slot.sent_at.store(LatencyClock::now(), std::memory_order_relaxed);
+    slot.id.store(id, std::memory_order_release);
+    return id;
+}
+
+void WebSocketClient::complete_request(uint64_t id, std::string& payload, bool throttled) {
+    uint64_t now = LatencyClock::now();
+    PendingRequest& slot = pending_[id % kPendingSlots];
+    uint64_t expected = id;
+    if (slot.id.load(std::memory_order_acquire) != id) {
+        LOG_WARN("[Deribit] Response to unknown request {}: {}", id, LogText(payload));
+        return;
+    }
+    RequestKind kind = static_cast<RequestKind>(slot.kind.load(std::memory_order_relaxed));
+    uint32_t origin = slot.origin.load(std::memory_order_relaxed);
+    uint64_t sent_at = slot.sent_at.load(std::memory_order_relaxed);
+    if (!slot.id.compare_exchange_strong(expected, 0, std::memory_order_acq_rel)) {
+        return;
+    }
+    completed_requests_.fetch_add(1, std::memory_order_relaxed);
+    if (throttled) {
+        getRateLimiter().on_exchange_reject(class_of(priority_of(kind)));
+    }
+
+    uint64_t round_trip = LatencyClock::to_nanoseconds(now - sent_at);
+    if (kind == RequestKind::BUY || kind == RequestKind::SELL) {
+        getLatencyTracker().record(LatencyTracker::ORDER_PLACEMENT, round_trip);
+    } else if (kind == RequestKind::CANCEL) {
+        getLatencyTracker().record(LatencyTracker::ORDER_CANCEL, round_trip);
+    } else if (kind == RequestKind::EDIT) {
+        getLatencyTracker().record(LatencyTracker::ORDER_MODIFY, round_trip);
+    }
+
+    if (kind == RequestKind::BOOK_SNAPSHOT) {
+        on_book_snapshot(id, payload);
+        return;
+    }
+    // Carries the tokens, so it is never logged.
+    if (kind == RequestKind::AUTH) {
+        on_auth_response(payload);
+        return;
+    }
+    if (kind == RequestKind::SEED_POSITIONS || kind == RequestKind::SEED_OPEN_ORDERS) {
+        on_exposure(kind, payload);
+        return;
+    }
+    LOG_INFO("[Deribit] Response to request {} after {} ns: {}", id, round_trip, LogText(payload));
+    if (origin != 0 && g_ws_server) {
+        MarketEvent event;
+        event.kind = MarketEvent::PRIVATE;
+        event.target = origin;
+        event.order_response = kind == RequestKind::BUY || kind == RequestKind::SELL ||
+                               kind == RequestKind::EDIT || kind == RequestKind::CANCEL;
+        event.payload = std::move(payload);
+        publish_private(std::move(event));
+    }
+}
+
+void WebSocketClient::publish_private(MarketEvent&& event) {
+    if (!backlogged_.load(std::memory_order_acquire) && g_ws_server->publish(std::move(event), producer_)) {
+        return;
+    }
+    // A failed publish leaves the event untouched.
+    bool first;
+    size_t held;
+    {
+        std::lock_guard<std::mutex> lock(backlog_mutex_);
+        private_backlog_.push_back(HeldResponse{event.target, event.order_response, std::move(event.payload)});
+        held = private_backlog_.size();
+        first = !backlogged_.exchange(true, std::memory_order_acq_rel);
+    }
+    delayed_responses_.fetch_add(1, std::memory_order_relaxed);
+    LOG_EVERY_MS(LOG_LEVEL_WARN, 1000,
+                 "[Client] Fan-out queue full, {} responses held for retry ({} more since last warning)", held);
+    if (first) {
+        ws_client.set_timer(kBacklogRetryMs, [this](const websocketpp::lib::error_code& ec) {
+            if (!ec) flush_private_backlog();
+        });
+    }
+}
+
+void WebSocketClient::flush_private_backlog() {
+    std::lock_guard<std::mutex> lock(backlog_mutex_);
+    while (!private_backlog_.empty()) {
+        HeldResponse& held = private_backlog_.front();
+        MarketEvent event;
+        event.kind = MarketEvent::PRIVATE;
+        event.target = held.target;
+        event.order_response = held.order_response;
+        event.payload = std::move(held.payload);
+        if (!g_ws_server->publish(std::move(event), producer_)) {
+            held.payload = std::move(event.payload);
+            break;
+        }
+        private_backlog_.pop_front();
+    }
+    if (private_backlog_.empty()) {
+        backlogged_.store(false, std::memory_order_release);
+        return;
+    }
+    ws_client.set_timer(kBacklogRetryMs, [this](const websocketpp::lib::error_code& ec) {
+        if (!ec) flush_private_backlog();
+    });
+}
+
 void WebSocketClient::send(const std::string& message) {
-    ws_client.send(hdl_, message, websocketpp::frame::opcode::text);
+    websocketpp::lib::error_code ec;
+    ws_client.send(hdl_, message, websocketpp::frame::opcode::text, ec);
+    if (ec) {
+        LOG_WARN("[Client] Send failed: {}", ec.message());
+    }
+}
+
+void WebSocketClient::send(const char* data, size_t size) {
+    websocketpp::lib::error_code ec;
+    ws_client.send(hdl_, data, size, websocketpp::frame::opcode::text, ec);
+    if (ec) {
+        LOG_WARN("[Client] Send failed: {}", ec.message());
+    }
+}
+
+WebSocketClient::Priority WebSocketClient::priority_of(RequestKind kind) {
+    switch (kind) {
+    case RequestKind::CANCEL: return PRIORITY_CANCEL;
+    case RequestKind::BUY:
+    case RequestKind::SELL:
+    case RequestKind::EDIT: return PRIORITY_ORDER;
+    case RequestKind::AUTH:
+    case RequestKind::SUBSCRIBE:
+    case RequestKind::BOOK_SNAPSHOT:
+    case RequestKind::SEED_POSITIONS:
+    case RequestKind::SEED_OPEN_ORDERS: return PRIORITY_CONTROL;
+    default: return PRIORITY_QUERY;
+    }
+}
+
+bool WebSocketClient::session_ready(RequestKind kind) const {
+    switch (kind) {
+    case RequestKind::BUY:
+    case RequestKind::SELL:
+    case RequestKind::CANCEL:
+    case RequestKind::EDIT:
+    case RequestKind::GET_POSITIONS:
+    case RequestKind::SEED_POSITIONS:
+    case RequestKind::SEED_OPEN_ORDERS: return client_id_.empty() || authenticated();
+    default: return true;
+    }
+}
+
+void WebSocketClient::dispatch(uint64_t id, RequestKind kind, const std::string& message) {
+    dispatch(id, kind, message.data(), message.size());
+}
+
+void WebSocketClient::dispatch(uint64_t id, RequestKind kind, const char* data, size_t size) {
+    Priority priority = priority_of(kind);
+    RequestClass request_class = class_of(priority);
+    RateLimiter& limiter = getRateLimiter();
+
+    // Only queues drawing on the same credit budget can hold this one back.
+    bool waiting = false;
+    for (int p = 0; p <= priority; ++p) {
+        if (class_of(static_cast<Priority>(p)) == request_class &&
+            scheduled_count_[p].load(std::memory_order_relaxed) != 0) {
+            waiting = true;
+            break;
+        }
+    }
+    if (!waiting && session_ready(kind) && limiter.try_acquire(request_class)) {
+        send(data, size);
+        return;
+    }
+
+    bool full = false;
+    {
+        std::lock_guard<std::mutex> lock(schedule_mutex_);
+        std::deque<QueuedRequest>& queue = scheduled_[priority];
+        if (priority == PRIORITY_QUERY && queue.size() >= kMaxQueuedQueries) {
+            full = true;
+        } else {
+            queue.push_back(QueuedRequest{id, kind, LatencyClock::now(), std::string(data, size)});
+            scheduled_count_[priority].store(static_cast<uint32_t>(queue.size()), std::memory_order_relaxed);
+            limiter.on_queued(request_class);
+        }
+    }
+    if (full) {
+        shed(id, kind);
+        return;
+    }
+    if (!session_ready(kind)) {
+        LOG_EVERY_MS(LOG_LEVEL_WARN, 1000,
+                     "[Client] Session not authenticated yet, request {} held ({} more since last warning)", id);
+    } else {
+        LOG_EVERY_MS(LOG_LEVEL_WARN, 1000,
+                     "[Client] Out of {} credits, request {} queued ({} more since last warning)",
+                     request_class_name(request_class), id);
+    }
+    drain_scheduled();
+}
+
+void WebSocketClient::drain_scheduled() {
+    RateLimiter& limiter = getRateLimiter();
+    std::vector<std::pair<uint64_t, RequestKind>> stale;
+    uint64_t wait_ns = 0;
+    bool pending = false;
+    {
+        std::lock_guard<std::mutex> lock(schedule_mutex_);
+        uint64_t now = LatencyClock::now();
+        for (int p = 0; p < PRIORITY_COUNT; ++p) {
+            Priority priority = static_cast<Priority>(p);
+            RequestClass request_class = class_of(priority);
+            std::deque<QueuedRequest>& queue = scheduled_[p];
+            while (!queue.empty()) {
+                QueuedRequest& front = queue.front();
+                if (priority == PRIORITY_QUERY &&
+                    LatencyClock::to_nanoseconds(now - front.queued_at) > kMaxQueryWaitMs * 1000000ULL) {
+                    stale.emplace_back(front.id, front.kind);
+                    queue.pop_front();
+                    continue;
+                }
+                // Held for the session: on_auth_response drains again, so the
+                // timer is only needed to shed queries that go stale meanwhile.
+                if (!session_ready(front.kind)) {
+                    if (priority == PRIORITY_QUERY) {
+                        pending = true;
+                        uint64_t age = LatencyClock::to_nanoseconds(now - front.queued_at);
+                        uint64_t wait = kMaxQueryWaitMs * 1000000ULL - age + 1;
+                        wait_ns = wait_ns == 0 ? wait : std::min(wait_ns, wait);
+                    }
+                    break;
+                }
+                if (!limiter.try_acquire(request_class)) {
+                    pending = true;
+                    uint64_t wait = limiter.wait_ns(request_class);
+                    wait_ns = wait_ns == 0 ? wait : std::min(wait_ns, wait);
+                    break;
+                }
+                send(front.payload);
+                queue.pop_front();
+            }
+            scheduled_count_[p].store(static_cast<uint32_t>(queue.size()), std::memory_order_relaxed);
+        }
+
+        // One timer at a time; it re-arms itself until the queues are empty.
+        if (pending && !drain_pending_) {
+            drain_pending_ = true;
+            long wait_ms = std::max<long>(1, static_cast<long>((wait_ns + 999999) / 1000000));
+            ws_client.set_timer(wait_ms, [this](const websocketpp::lib::error_code& ec) {
+                {
+                    std::lock_guard<std::mutex> lock(schedule_mutex_);
+                    drain_pending_ = false;
+                }
+                if (!ec) drain_scheduled();
+            });
+        }
+    }
+    for (const auto& request : stale) {
+        shed(request.first, request.second);
+    }
 }
 
-std::string WebSocketClient::receive() {
-    std::unique_lock<std::mutex> lock(msg_mutex_);
-    while (messages_.empty()) {
-        msg_cond_.wait(lock);
+void WebSocketClient::shed(uint64_t id, RequestKind kind) {
+    getRateLimiter().on_shed(class_of(priority_of(kind)));
+    // Answered in Deribit's own shape so the origin sees one error format.
+    std::string payload = "{\"jsonrpc\":\"2.0\",\"id\":" + std::to_string(id) +
+        ",\"error\":{\"code\":10028,\"message\":\"too_many_requests\",\"data\":{\"reason\":\"shed locally\"}}}";
+    LOG_WARN("[Client] Request {} shed: out of credits", id);
+    complete_request(id, payload);
+}
+
+size_t WebSocketClient::scheduled_requests() const {
+    size_t total = 0;
+    for (const auto& count : scheduled_count_) {
+        total += count.load(std::memory_order_relaxed);
     }
-    std::string msg = messages_.front();
-    messages_.pop();
-    return msg;
+    return total;
+}
+
+void WebSocketClient::start_capture(const std::string& prefix, size_t segment_bytes) {
+    journal_.reset(new JournalWriter(prefix, segment_bytes));
+}
+
+void WebSocketClient::stop_capture() {
+    journal_.reset();
 }
 
 void WebSocketClient::connect(const std::string& uri) {
@@ -80,145 +485,577 @@ void WebSocketClient::connect(const std::string& uri) {
     }
     hdl_ = con->get_handle();
     ws_client.connect(con);
-    ws_client.run();
+    run_event_loop(ws_client, role_);
+}
+
+void WebSocketClient::stop() {
+    ws_client.stop();
 }
 
 void WebSocketClient::subscribe_orderbook(const std::string& instrument) {
+    // Raw book channels are only served to an authenticated session; until
+    // then they wait, and go out with the user streams.
+    if (!client_id_.empty() && getBookChannelConfig().interval(instrument) == "raw") {
+        std::lock_guard<std::mutex> lock(auth_mutex_);
+        if (!authenticated()) {
+            deferred_books_.push_back(instrument);
+            LOG_INFO("[Client] {} waits for the session to authenticate.", getBookChannelConfig().channel(instrument));
+            return;
+        }
+    }
+    uint64_t id = begin_request(RequestKind::SUBSCRIBE, 0);
+    std::string channel = getBookChannelConfig().channel(instrument);
     nlohmann::json subscribe_message = {
         {"jsonrpc", "2.0"},
-        {"id", 1},
+        {"id", id},
         {"method", "public/subscribe"},
         {"params", {
-            {"channels", {"book." + instrument + ".100ms"}}
+            {"channels", {channel}}
         }}
     };
 
-    ws_client.send(hdl_, subscribe_message.dump(), websocketpp::frame::opcode::text);
-    std::cout << "[Client] Subscribed explicitly to " << instrument << " orderbook.\n";
+    dispatch(id, RequestKind::SUBSCRIBE, subscribe_message.dump());
+    LOG_INFO("[Client] Subscribed explicitly to {}.", channel);
 }
 
 void WebSocketClient::unsubscribe_orderbook(const std::string& instrument) {
+    {
+        std::lock_guard<std::mutex> lock(auth_mutex_);
+        auto deferred = std::find(deferred_books_.begin(), deferred_books_.end(), instrument);
+        if (deferred != deferred_books_.end()) {
+            deferred_books_.erase(deferred);
+            return;
+        }
+    }
+    uint64_t id = begin_request(RequestKind::SUBSCRIBE, 0);
     nlohmann::json unsubscribe_message = {
         {"jsonrpc", "2.0"},
-        {"id", 1},
+        {"id", id},
         {"method", "public/unsubscribe"},
         {"params", {
-            {"channels", {"book." + instrument + ".100ms"}}
+            {"channels", {getBookChannelConfig().channel(instrument)}}
+        }}
+    };
+
+    dispatch(id, RequestKind::SUBSCRIBE, unsubscribe_message.dump());
+    LOG_INFO("[Client] Unsubscribed explicitly from {} orderbook.", instrument);
+
+    // Nothing keeps the local book current any more; readers fall back to
+    // public/get_order_book until a new subscription's snapshot arrives, and
+    // the risk gate has no mid to check against.
+    if (OrderBookStore::Entry* entry = getOrderBookStore().find(instrument)) {
+        std::lock_guard<std::mutex> lock(entry->mutex);
+        entry->book.invalidate();
+    }
+    getRiskGate().set_mid(getInstrumentRegistry().find(instrument), 0.0);
+}
+
+void WebSocketClient::subscribe_user_streams() {
+    uint64_t id = begin_request(RequestKind::SUBSCRIBE, 0);
+    json subscribe_message = {
+        {"jsonrpc", "2.0"},
+        {"id", id},
+        {"method", "private/subscribe"},
+        {"params", {
+            {"channels", {"user.orders.any.any.raw", "user.trades.any.any.raw"}}
+        }}
+    };
+
+    dispatch(id, RequestKind::SUBSCRIBE, subscribe_message.dump());
+    LOG_INFO("[Client] Subscribed to user order and trade streams.");
+}
+
+void WebSocketClient::resubscribe_orderbook(const std::string& instrument) {
+    // Deribit opens every new book subscription with a full snapshot.
+    unsubscribe_orderbook(instrument);
+    subscribe_orderbook(instrument);
+}
+
+bool WebSocketClient::apply_book_update(uint32_t instrument, const BookNotification& update, std::string& payload,
+                                        uint64_t received_at) {
+    BookResync* resync = nullptr;
+    if (!resync_.empty()) {
+        auto it = resync_.find(instrument);
+        if (it != resync_.end()) resync = &it->second;
+    }
+    if (resync && resync->request != 0 && !update.snapshot) {
+        // Oldest first out: if the snapshot turns out newer than what is
+        // left, the gap check below asks for another one.
+        if (resync->buffered.size() == kMaxBufferedDeltas) {
+            resync->buffered.pop_front();
+        }
+        resync->buffered.emplace_back(received_at, std::move(payload));
+        return false;
+    }
+
+    OrderBookStore::Entry& entry = *getOrderBookStore().get_or_create(instrument);
+    bool in_sync = true;
+    bool bridged = false;
+    {
+        std::lock_guard<std::mutex> lock(entry.mutex);
+        OrderBook& book = entry.book;
+        BookLevel level;
+
+        if (update.snapshot) {
+            if (resync) resync->request = 0;
+            book.begin_snapshot(update.change_id, update.timestamp);
+            for (LevelCursor bids(update.bids); bids.next(level);) {
+                book.add_snapshot_level(OrderBook::BID, level.price, level.amount);
+            }
+            for (LevelCursor asks(update.asks); asks.next(level);) {
+                book.add_snapshot_level(OrderBook::ASK, level.price, level.amount);
+            }
+            book.end_snapshot();
+        } else if (!book.is_valid()) {
+            // Still waiting for the snapshot that opens a subscription.
+            return false;
+        } else if (resync && update.change_id <= book.change_id()) {
+            // Already part of the snapshot.
+            return false;
+        } else {
+            // The first delta after a snapshot may straddle its change_id:
+            // Deribit levels carry absolute amounts, so applying the whole
+            // delta still lands on the right book.
+            bridged = resync && update.prev_change_id <= book.change_id();
+            int64_t prev_change_id = bridged ? book.change_id() : update.prev_change_id;
+            if (offline_ && prev_change_id != book.change_id()) {
+                // Nothing to ask for a snapshot: report the gap and carry on
+                // from this delta, which is exact for every level it names.
+                book_gaps_.fetch_add(1, std::memory_order_relaxed);
+                LOG_EVERY_MS(LOG_LEVEL_WARN, 1000, "[Deribit] Book {} out of sequence at change_id {}, applied "
+                             "over the gap ({} more since last warning)",
+                             getInstrumentRegistry().name(instrument), update.change_id);
+                prev_change_id = book.change_id();
+            }
+            if (book.begin_delta(prev_change_id, update.change_id, update.timestamp)) {
+                for (LevelCursor bids(update.bids); bids.next(level);) {
+                    book.apply_level(OrderBook::BID, level.price,
+                                     level.action == BookLevel::DELETE ? 0.0 : level.amount);
+                }
+                for (LevelCursor asks(update.asks); asks.next(level);) {
+                    book.apply_level(OrderBook::ASK, level.price,
+                                     level.action == BookLevel::DELETE ? 0.0 : level.amount);
+                }
+            } else {
+                in_sync = false;
+            }
+        }
+
+        // Reference price for the pre-trade price band.
+        const PriceLevel* bid = book.best_bid();
+        const PriceLevel* ask = book.best_ask();
+        if (in_sync && bid && ask) {
+            getRiskGate().set_mid(instrument, (bid->price + ask->price) * 0.5);
+        } else if (!in_sync) {
+            // Until the resync snapshot lands the last mid may be stale.
+            getRiskGate().set_mid(instrument, 0.0);
+        }
+    }
+
+    if (!in_sync) {
+        start_resync(instrument, payload, received_at);
+        return false;
+    }
+    if (bridged) {
+        resync_.erase(instrument);
+    }
+    return true;
+}
+
+void WebSocketClient::start_resync(uint32_t instrument, std::string& payload, uint64_t received_at) {
+    // The delta that showed the gap may well be newer than the snapshot.
+    BookResync& resync = resync_[instrument];
+    resync.buffered.clear();
+    resync.buffered.emplace_back(received_at, std::move(payload));
+
+    const std::string& name = getInstrumentRegistry().name(instrument);
+    book_resyncs_.fetch_add(1, std::memory_order_relaxed);
+    LOG_WARN("[Deribit] Book {} out of sequence, resyncing from a snapshot.", name);
+    resync.request = request_order_book(name, kResyncDepth, RequestKind::BOOK_SNAPSHOT, 0);
+}
+
+void WebSocketClient::on_book_snapshot(uint64_t id, const std::string& payload) {
+    auto it = std::find_if(resync_.begin(), resync_.end(),
+                           [id](const std::pair<const uint32_t, BookResync>& entry) { return entry.second.request == id; });
+    if (it == resync_.end()) {
+        LOG_DEBUG("[Deribit] Dropping superseded book snapshot {}", id);
+        return;
+    }
+    const std::string& name = getInstrumentRegistry().name(it->first);
+    json j = json::parse(payload, nullptr, false);
+    if (!j.is_object() || !j.contains("result") || !j["result"].is_object()) {
+        // Deribit opens every new subscription with a snapshot; deltas keep
+        // buffering until it arrives.
+        LOG_WARN("[Deribit] Snapshot of {} failed, resubscribing: {}", name, LogText(payload));
+        it->second.request = kAwaitingSubscription;
+        resubscribe_orderbook(name);
+        return;
+    }
+
+    // Fed back through on_frame as the channel's own snapshot notification, so
+    // the book, the risk gate's mid and downstream subscribers all take the
+    // usual path, and the buffered deltas follow it.
+    const json& result = j["result"];
+    json data = {
+        {"type", "snapshot"},
+        {"instrument_name", name},
+        {"change_id", result.value("change_id", int64_t(0))},
+        {"timestamp", result.value("timestamp", int64_t(0))},
+        {"bids", json::array()},
+        {"asks", json::array()}
+    };
+    for (const char* side : {"bids", "asks"}) {
+        if (!result.contains(side)) continue;
+        for (const auto& level : result[side]) {
+            data[side].push_back({"new", level[0], level[1]});
+        }
+    }
+    json notification = {
+        {"jsonrpc", "2.0"},
+        {"method", "subscription"},
+        {"params", {
+            {"channel", getBookChannelConfig().channel(name)},
+            {"data", data}
         }}
     };
+    std::string frame = notification.dump();
+    LOG_INFO("[Deribit] Book {} resynced at change_id {}, replaying {} buffered update(s)", name,
+             data["change_id"].get<int64_t>(), it->second.buffered.size());
+    it->second.request = 0;
+    on_frame(frame, LatencyClock::now());
+}
 
-    ws_client.send(hdl_, unsubscribe_message.dump(), websocketpp::frame::opcode::text);
-    std::cout << "[Client] Unsubscribed explicitly from " << instrument << " orderbook.\n";
+void WebSocketClient::replay_buffered(uint32_t instrument) {
+    auto it = resync_.find(instrument);
+    if (it == resync_.end() || it->second.buffered.empty()) return;
+    // A fresh gap during replay starts a new resync, which buffers the rest.
+    std::deque<std::pair<uint64_t, std::string>> frames;
+    frames.swap(it->second.buffered);
+    for (auto& frame : frames) {
+        on_frame(frame.second, frame.first);
+    }
 }
 
-void WebSocketClient::place_order(const std::string& instrument, double amount, const std::string& direction,
-                                    const std::string& order_type, double price) {
+std::string WebSocketClient::build_place_order(uint64_t id, const std::string& instrument, double amount,
+                                               const std::string& direction, const std::string& order_type, double price) {
     json request = {
         {"jsonrpc", "2.0"},
-        {"id", 2},
+        {"id", id},
         {"method", (direction == "buy" ? "private/buy" : "private/sell")},
         {"params", {
             {"instrument_name", instrument},
             {"amount", amount},
-            {"type", order_type},
-            {"access_token", access_token_}
+            {"type", order_type}
         }}
     };
     if (order_type == "limit") {
         request["params"]["price"] = price;
     }
-    send(request.dump());
-    std::cout << "[Client] Place order request sent: " << request.dump() << std::endl;
+    return request.dump();
 }
 
-void WebSocketClient::cancel_order(const std::string& order_id) {
+std::string WebSocketClient::build_cancel_order(uint64_t id, const std::string& order_id) {
     json request = {
         {"jsonrpc", "2.0"},
-        {"id", 3},
+        {"id", id},
         {"method", "private/cancel"},
         {"params", {
-            {"order_id", order_id},
-            {"access_token", access_token_}
+            {"order_id", order_id}
         }}
     };
-    send(request.dump());
-    std::cout << "[Client] Cancel order request sent: " << request.dump() << std::endl;
+    return request.dump();
 }
 
-void WebSocketClient::modify_order(const std::string& order_id, double new_amount, double new_price) {
+std::string WebSocketClient::build_modify_order(uint64_t id, const std::string& order_id, double new_amount,
+                                                double new_price) {
     json request = {
         {"jsonrpc", "2.0"},
-        {"id", 4},
+        {"id", id},
         {"method", "private/edit"},
         {"params", {
             {"order_id", order_id},
             {"amount", new_amount},
-            {"price", new_price},
-            {"access_token", access_token_}
+            {"price", new_price}
         }}
     };
-    send(request.dump());
-    std::cout << "[Client] Modify order request sent: " << request.dump() << std::endl;
+    return request.dump();
+}
+
+uint64_t WebSocketClient::place_order(const std::string& instrument, double amount, const std::string& direction,
+                                      const std::string& order_type, double price, uint32_t origin) {
+    OrderSide side = direction == "buy" ? OrderSide::BUY : OrderSide::SELL;
+    if (order_type == "limit" || order_type == "market") {
+        return place_order(instrument, amount, side, order_type == "limit" ? OrderType::LIMIT : OrderType::MARKET,
+                           price, origin);
+    }
+    // Order types without a template go out through the generic builder.
+    RequestKind kind = side == OrderSide::BUY ? RequestKind::BUY : RequestKind::SELL;
+    uint64_t id = begin_request(kind, origin);
+    dispatch(id, kind, build_place_order(id, instrument, amount, direction, order_type, price));
+    LOG_INFO("[Client] Place order request {} sent: {} {} {} {} price {}", id, direction, amount, instrument, order_type, price);
+    return id;
+}
+
+uint64_t WebSocketClient::place_order(const std::string& instrument, double amount, OrderSide side, OrderType type,
+                                      double price, uint32_t origin) {
+    if (const InstrumentSpec* spec = getInstrumentCache().find(instrument)) {
+        return place_order(*spec, side, type, spec->qty_from(amount), spec->price_from(price), origin);
+    }
+    bool buy = side == OrderSide::BUY;
+    bool limit = type == OrderType::LIMIT;
+    RequestKind kind = buy ? RequestKind::BUY : RequestKind::SELL;
+    uint64_t id = begin_request(kind, origin);
+    OrderEncoder& encoder = thread_encoder();
+    StrRef request = encoder.place_order(id, side, type, instrument, amount, price);
+    if (!request.empty()) {
+        dispatch(id, kind, request.data, request.size);
+    } else {
+        dispatch(id, kind, build_place_order(id, instrument, amount, buy ? "buy" : "sell", limit ? "limit" : "market", price));
+    }
+    LOG_INFO("[Client] Place order request {} sent: {} {} {} {} price {}", id, buy ? "buy" : "sell", amount, instrument,
+             limit ? "limit" : "market", price);
+    return id;
+}
+
+uint64_t WebSocketClient::place_order(const InstrumentSpec& instrument, OrderSide side, OrderType type, Qty amount,
+                                      Price price, uint32_t origin) {
+    bool buy = side == OrderSide::BUY;
+    bool limit = type == OrderType::LIMIT;
+    RequestKind kind = buy ? RequestKind::BUY : RequestKind::SELL;
+    uint64_t id = begin_request(kind, origin);
+    StrRef request = thread_encoder().place_order(id, side, type, instrument, amount, price);
+    if (!request.empty()) {
+        dispatch(id, kind, request.data, request.size);
+    } else {
+        dispatch(id, kind, build_place_order(id, instrument.name, instrument.to_double(amount), buy ? "buy" : "sell",
+                               limit ? "limit" : "market", instrument.to_double(price)));
+    }
+    LOG_INFO("[Client] Place order request {} sent: {} {} lots {} {} price {} ticks", id, buy ? "buy" : "sell",
+             amount.lots, instrument.name, limit ? "limit" : "market", price.ticks);
+    return id;
+}
+
+uint64_t WebSocketClient::cancel_order(const std::string& order_id, uint32_t origin) {
+    uint64_t id = begin_request(RequestKind::CANCEL, origin);
+    StrRef request = thread_encoder().cancel_order(id, order_id);
+    if (!request.empty()) {
+        dispatch(id, RequestKind::CANCEL, request.data, request.size);
+    } else {
+        dispatch(id, RequestKind::CANCEL, build_cancel_order(id, order_id));
+    }
+    LOG_INFO("[Client] Cancel order request {} sent: {}", id, order_id);
+    return id;
+}
+
+uint64_t WebSocketClient::modify_order(const std::string& order_id, double new_amount, double new_price, uint32_t origin) {
+    uint64_t id = begin_request(RequestKind::EDIT, origin);
+    StrRef request = thread_encoder().modify_order(id, order_id, new_amount, new_price);
+    if (!request.empty()) {
+        dispatch(id, RequestKind::EDIT, request.data, request.size);
+    } else {
+        dispatch(id, RequestKind::EDIT, build_modify_order(id, order_id, new_amount, new_price));
+    }
+    LOG_INFO("[Client] Modify order request {} sent: {} amount {} price {}", id, order_id, new_amount, new_price);
+    return id;
+}
+
+uint64_t WebSocketClient::modify_order(const std::string& order_id, const InstrumentSpec& instrument, Qty new_amount,
+                                       Price new_price, uint32_t origin) {
+    uint64_t id = begin_request(RequestKind::EDIT, origin);
+    StrRef request = thread_encoder().modify_order(id, order_id, instrument, new_amount, new_price);
+    if (!request.empty()) {
+        dispatch(id, RequestKind::EDIT, request.data, request.size);
+    } else {
+        dispatch(id, RequestKind::EDIT, build_modify_order(id, order_id, instrument.to_double(new_amount),
+                                instrument.to_double(new_price)));
+    }
+    LOG_INFO("[Client] Modify order request {} sent: {} {} lots price {} ticks", id, order_id, new_amount.lots,
+             new_price.ticks);
+    return id;
 }
 
-void WebSocketClient::get_positions() {
+uint64_t WebSocketClient::get_positions(uint32_t origin) {
+    uint64_t id = begin_request(RequestKind::GET_POSITIONS, origin);
     json request = {
         {"jsonrpc", "2.0"},
-        {"id", 5},
+        {"id", id},
         {"method", "private/get_positions"},
         {"params", {
-            {"currency", "BTC"},
-            {"access_token", access_token_}
+            {"currency", "BTC"}
         }}
     };
-    send(request.dump());
-    std::cout << "[Client] Get positions request sent: " << request.dump() << std::endl;
+    dispatch(id, RequestKind::GET_POSITIONS, request.dump());
+    LOG_INFO("[Client] Get positions request {} sent.", id);
+    return id;
 }
 
-void WebSocketClient::get_order_book(const std::string& instrument, int depth) {
+uint64_t WebSocketClient::get_order_book(const std::string& instrument, int depth, uint32_t origin) {
+    return request_order_book(instrument, depth, RequestKind::GET_ORDER_BOOK, origin);
+}
+
+uint64_t WebSocketClient::request_order_book(const std::string& instrument, int depth, RequestKind kind,
+                                             uint32_t origin) {
+    uint64_t id = begin_request(kind, origin);
     json request = {
         {"jsonrpc", "2.0"},
-        {"id", 6},
+        {"id", id},
         {"method", "public/get_order_book"},
         {"params", {
             {"instrument_name", instrument},
             {"depth", depth}
         }}
     };
-    send(request.dump());
-    std::cout << "[Client] Get orderbook request sent for " << instrument << " with depth " << depth << "\n";
+    dispatch(id, kind, request.dump());
+    LOG_INFO("[Client] Get orderbook request {} sent for {} with depth {}", id, instrument, depth);
+    return id;
 }
 
-#include <nlohmann/json.hpp>
-using json = nlohmann::json;
+void WebSocketClient::set_credentials(const std::string& client_id, const std::string& client_secret) {
+    client_id_ = client_id;
+    client_secret_ = client_secret;
+}
 
-void WebSocketClient::authenticate(const std::string& client_id, const std::string& client_secret) { //Not working though.
+void WebSocketClient::send_auth() {
+    uint64_t id = begin_request(RequestKind::AUTH, 0);
+    bool refresh = !refresh_token_.empty();
+    json params = refresh
+        ? json{{"grant_type", "refresh_token"}, {"refresh_token", refresh_token_}}
+        : json{{"grant_type", "client_credentials"}, {"client_id", client_id_}, {"client_secret", client_secret_}};
     json auth_request = {
         {"jsonrpc", "2.0"},
-        {"id", 1},
+        {"id", id},
         {"method", "public/auth"},
-        {"params", {
-            {"grant_type", "client_credentials"},
-            {"client_id", client_id},
-            {"client_secret", client_secret}
-        }}
+        {"params", params}
     };
+    dispatch(id, RequestKind::AUTH, auth_request.dump());
+    LOG_INFO("[Client] Authenticating session ({}) with {}", thread_role_name(role_),
+             refresh ? "refresh token" : "client credentials");
+}
 
-    send(auth_request.dump());
-    std::cout << "[Client] Sent authentication request: " << auth_request.dump() << std::endl;
+void WebSocketClient::schedule_auth(long delay_ms) {
+    uint64_t epoch = connection_epoch_;
+    ws_client.set_timer(delay_ms, [this, epoch](const websocketpp::lib::error_code& ec) {
+        if (!ec && epoch == connection_epoch_) send_auth();
+    });
+}
 
-    std::string response = receive();
-    std::cout << "[Client] Received auth response: " << response << std::endl;
-    
-    try {
-        json j = json::parse(response);
-        if (j.contains("result") && j["result"].contains("access_token")) {
-            access_token_ = j["result"]["access_token"];
-            std::cout << "[Client] Authentication successful. Access token stored." << std::endl;
-        } else {
-            std::cerr << "[Client] Authentication failed: " << response << std::endl;
+void WebSocketClient::clear_session(const char* reason) {
+    std::lock_guard<std::mutex> lock(auth_mutex_);
+    if (!authenticated_.exchange(false, std::memory_order_acq_rel)) return;
+    LOG_WARN("[Client] Session ({}) no longer authenticated: {}", thread_role_name(role_), reason);
+    if (user_streams_) {
+        // Fills may be missed until the streams are back; positions and open
+        // orders are loaded again after the next authentication.
+        positions_seeded_ = false;
+        orders_seeded_ = false;
+        getRiskGate().set_exposure_loaded(false);
+    }
+}
+
+void WebSocketClient::on_auth_response(const std::string& payload) {
+    json j = json::parse(payload, nullptr, false);
+    if (!j.is_object() || !j.contains("result") || !j["result"].is_object() ||
+        !j["result"].contains("access_token")) {
+        // A refresh token that was refused is not tried again. The session
+        // stays authenticated until the old token actually runs out, which
+        // the expiry timer set with it takes care of.
+        refresh_token_.clear();
+        long delay = std::min(kMaxAuthRetryMs, kAuthRetryMs << std::min<uint32_t>(auth_failures_++, 6));
+        std::string error = j.is_object() && j.contains("error") ? j["error"].dump() : payload;
+        LOG_ERROR("[Client] Authentication failed ({}), retrying in {} ms: {}", thread_role_name(role_), delay,
+                  LogText(error));
+        schedule_auth(delay);
+        return;
+    }
+
+    const json& result = j["result"];
+    refresh_token_ = result.value("refresh_token", "");
+    int64_t expires_in = result.value("expires_in", int64_t(0));
+    auth_failures_ = 0;
+    // Renewed halfway through the lifetime, so a slow or refused refresh
+    // leaves the other half for the backed-off retries. If none of them get
+    // through, the session stops counting as authenticated when it expires.
+    uint64_t serial = ++token_serial_;
+    if (expires_in > 0) {
+        schedule_auth(std::max<long>(1000, static_cast<long>(expires_in) * 500));
+        ws_client.set_timer(static_cast<long>(expires_in) * 1000, [this, serial](const websocketpp::lib::error_code& ec) {
+            if (!ec && serial == token_serial_) clear_session("access token expired");
+        });
+    }
+    LOG_INFO("[Client] Session authenticated ({}), token valid for {} s", thread_role_name(role_), expires_in);
+
+    std::vector<std::string> deferred;
+    {
+        std::lock_guard<std::mutex> lock(auth_mutex_);
+        if (authenticated_.exchange(true, std::memory_order_acq_rel)) return;
+        deferred.swap(deferred_books_);
+    }
+    // Orders placed while the session was authenticating.
+    drain_scheduled();
+    if (user_streams_) {
+        // Subscribed first, so anything the snapshots miss arrives as updates.
+        subscribe_user_streams();
+        request_exposure(RequestKind::SEED_POSITIONS);
+        request_exposure(RequestKind::SEED_OPEN_ORDERS);
+    }
+    for (const auto& instrument : deferred) {
+        subscribe_orderbook(instrument);
+    }
+}
+
+void WebSocketClient::request_exposure(RequestKind kind) {
+    uint64_t id = begin_request(kind, 0);
+    bool positions = kind == RequestKind::SEED_POSITIONS;
+    json request = {
+        {"jsonrpc", "2.0"},
+        {"id", id},
+        {"method", positions ? "private/get_positions" : "private/get_open_orders"},
+        {"params", positions ? json{{"currency", "any"}} : json::object()}
+    };
+    dispatch(id, kind, request.dump());
+}
+
+void WebSocketClient::on_exposure(RequestKind kind, const std::string& payload) {
+    bool positions = kind == RequestKind::SEED_POSITIONS;
+    json j = json::parse(payload, nullptr, false);
+    if (!j.is_object() || !j.contains("result") || !j["result"].is_array()) {
+        LOG_ERROR("[Client] Loading {} failed, retrying in {} ms: {}", positions ? "positions" : "open orders",
+                  kSeedRetryMs, LogText(payload));
+        ws_client.set_timer(kSeedRetryMs, [this, kind](const websocketpp::lib::error_code& ec) {
+            if (!ec) request_exposure(kind);
+        });
+        return;
+    }
+
+    const json& result = j["result"];
+    if (positions) {
+        // Responses and user.trades share this connection and arrive in
+        // order, so fills seen before now are already in these sizes.
+        std::vector<std::pair<uint32_t, double>> sizes;
+        for (const auto& position : result) {
+            uint32_t instrument = getInstrumentRegistry().intern(position.value("instrument_name", ""));
+            if (instrument != InstrumentRegistry::kInvalidId) {
+                sizes.emplace_back(instrument, position.value("size", 0.0));
+            }
         }
-    } catch (const std::exception& e) {
-        std::cerr << "[Client] Error parsing auth response: " << e.what() << std::endl;
+        getRiskGate().load_positions(sizes);
+        positions_seeded_ = true;
+        LOG_INFO("[Client] Loaded {} positions", sizes.size());
+    } else {
+        // Same shape as user.orders data; older states than what the stream
+        // already delivered are skipped by the OMS.
+        std::string orders = result.dump();
+        OrderCursor cursor(StrRef{orders.data(), orders.size()});
+        OrderUpdate order;
+        size_t count = 0;
+        while (cursor.next(order)) {
+            getOrderManager().apply_order(order);
+            ++count;
+        }
+        orders_seeded_ = true;
+        LOG_INFO("[Client] Loaded {} open orders", count);
+    }
+    if (positions_seeded_ && orders_seeded_) {
+        getRiskGate().set_exposure_loaded(true);
     }
 }
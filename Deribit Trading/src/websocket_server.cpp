@@ -1,87 +1,565 @@
 #include "websocket_server.hpp"
 #include <nlohmann/json.hpp>
-#include <iostream>
+#include "logger.hpp"
 #include "websocket_client.hpp"
+#include "connection_pool.hpp"
+#include "order_book.hpp"
+#include "order_manager.hpp"
+#include "risk_gate.hpp"
+#include "rate_limiter.hpp"
+#include "tracker.hpp"
+#include "threading.hpp"
+#include "instruments.hpp"
+#include "binary_protocol.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
 
 using json = nlohmann::json;
 
 extern WebSocketClient* g_ws_client;
 
+namespace {
+
+// Market-data requests go to the instrument's shard; without a pool (replay,
+// tools with a single connection) everything shares g_ws_client, which is
+// otherwise the order session.
+WebSocketClient* market_data_client(uint32_t instrument) {
+    ConnectionPool& pool = getConnectionPool();
+    if (pool.configured() && instrument != InstrumentRegistry::kInvalidId) {
+        return &pool.market_data(instrument);
+    }
+    return g_ws_client;
+}
+
+// Takes as long whatever the first difference, so a guess learns nothing from
+// the answer's timing.
+bool secret_matches(const std::string& expected, const std::string& given) {
+    if (expected.empty() || given.size() != expected.size()) return false;
+    unsigned char diff = 0;
+    for (size_t i = 0; i < expected.size(); ++i) {
+        diff |= static_cast<unsigned char>(expected[i] ^ given[i]);
+    }
+    return diff == 0;
+}
+
+// Same field names as Deribit's order and trade objects.
+json order_to_json(const OrderRecord& order) {
+    json result = {
+        {"order_id", std::string(order.order_id, order.order_id_size)},
+        {"instrument_name", getInstrumentRegistry().name(order.instrument)},
+        {"order_state", order_state_name(order.state)},
+        {"order_type", order.type == OrderType::MARKET ? "market" : "limit"},
+        {"direction", order.side == OrderSide::BUY ? "buy" : "sell"},
+        {"amount", order.amount},
+        {"filled_amount", order.filled_amount},
+        {"average_price", order.average_price},
+        {"label", std::string(order.label, order.label_size)},
+        {"creation_timestamp", order.creation_timestamp},
+        {"last_update_timestamp", order.last_update_timestamp}
+    };
+    if (order.type == OrderType::MARKET) {
+        result["price"] = "market_price";
+    } else {
+        result["price"] = order.price;
+    }
+    return result;
+}
+
+json fill_to_json(const FillRecord& fill) {
+    return {
+        {"trade_id", std::string(fill.trade_id, fill.trade_id_size)},
+        {"order_id", std::string(fill.order_id, fill.order_id_size)},
+        {"instrument_name", fill.instrument != InstrumentRegistry::kInvalidId
+            ? getInstrumentRegistry().name(fill.instrument) : std::string()},
+        {"direction", fill.side == OrderSide::BUY ? "buy" : "sell"},
+        {"liquidity", fill.maker ? "M" : "T"},
+        {"price", fill.price},
+        {"amount", fill.amount},
+        {"fee", fill.fee},
+        {"timestamp", fill.timestamp}
+    };
+}
+
+} // namespace
+
+WebSocketServer::WebSocketServer()
+    : subscribers_(InstrumentRegistry::kMaxInstruments) {
+    add_producer();
+}
+
+WebSocketServer::~WebSocketServer() {
+    fanout_running_ = false;
+    fanout_cond_.notify_one();
+    if (fanout_thread_.joinable()) {
+        fanout_thread_.join();
+    }
+}
+
 void WebSocketServer::on_open(connection_hdl hdl) {
-    std::cout << "[Server] Client connected clearly." << std::endl;
+    std::lock_guard<std::mutex> lock(connection_mutex_);
+    uint32_t session = next_session_id_++;
+    std::shared_ptr<Client> client = std::make_shared<Client>();
+    client->session = session;
+    client->hdl = hdl;
+    client->connection = m_server.get_con_from_hdl(hdl);
+    session_ids_[hdl] = session;
+    sessions_[session] = client;
+    LOG_INFO("[Server] Client connected clearly.");
 }
 
 void WebSocketServer::on_close(connection_hdl hdl) {
     std::lock_guard<std::mutex> lock(connection_mutex_);
-    for (auto& pair : subscriptions_) {
-        pair.second.erase(hdl);
+    auto it = session_ids_.find(hdl);
+    if (it == session_ids_.end()) return;
+    std::shared_ptr<Client> client = sessions_[it->second];
+    // Held frames die with the client; the fan-out thread drops it from behind_.
+    client->closing = true;
+    for (uint32_t id = 0, count = getInstrumentRegistry().size(); id < count; ++id) {
+        remove_subscriber(id, client);
     }
-    std::cout << "[Server] Client disconnected clearly." << std::endl;
+    sessions_.erase(it->second);
+    session_ids_.erase(it);
+    LOG_INFO("[Server] Client disconnected clearly.");
 }
 
 void WebSocketServer::on_message(connection_hdl hdl, server::message_ptr msg) {
     json received = json::parse(msg->get_payload());
     std::lock_guard<std::mutex> lock(connection_mutex_);
+    uint32_t session = session_ids_[hdl];
+    std::shared_ptr<Client> client = sessions_[session];
     
     if (received["action"] == "subscribe") {
         std::string instrument = received["instrument"];
-        subscriptions_[instrument].insert(hdl);
-        std::cout << "[Server] Client subscribed clearly to: " << instrument << std::endl;
+        uint32_t id = client_instrument(instrument);
+        if (id == InstrumentRegistry::kInvalidId) {
+            send_error(hdl, "subscribe", "unknown instrument " + instrument);
+            return;
+        }
+        int64_t depth = received.value("depth", int64_t(0));
+        int64_t interval_ms = received.value("interval_ms", int64_t(0));
+        if (depth < 0 || depth > kMaxViewDepth || interval_ms < 0 || interval_ms > kMaxViewIntervalMs) {
+            send_error(hdl, "subscribe", "depth must be 0 to " + std::to_string(kMaxViewDepth) +
+                       " and interval_ms 0 to " + std::to_string(kMaxViewIntervalMs));
+            return;
+        }
+        // Per connection; the instrument's id mapping goes out ahead of any
+        // update for it on the same send queue. A client switching to binary
+        // also gets the mappings for what it was already subscribed to, sent
+        // before the fan-out thread can see the new format.
+        bool binary = received.contains("format") ? received["format"] == "binary" : client->binary.load();
+        if (binary) {
+            std::vector<uint32_t> ids;
+            if (!client->binary) {
+                for (uint32_t other = 0, count = getInstrumentRegistry().size(); other < count; ++other) {
+                    std::shared_ptr<const SubscriberList> list = std::atomic_load(&subscribers_[other]);
+                    if (other != id && list && std::any_of(list->begin(), list->end(),
+                            [&client](const Subscriber& s) { return s.client == client; })) {
+                        ids.push_back(other);
+                    }
+                }
+            }
+            ids.push_back(id);
+            std::string wire;
+            for (uint32_t mapped : ids) {
+                if (encode_wire_instrument(mapped, getInstrumentRegistry().name(mapped), wire)) {
+                    websocketpp::lib::error_code ec;
+                    m_server.send(hdl, wire, websocketpp::frame::opcode::binary, ec);
+                }
+            }
+        }
+        client->binary = binary;
+        std::shared_ptr<ViewFeed> view = depth || interval_ms
+            ? find_view(id, static_cast<size_t>(depth), static_cast<uint32_t>(interval_ms)) : nullptr;
+        size_t subscribers = add_subscriber(id, client, view);
+        LOG_INFO("[Server] Client subscribed clearly to: {} (depth {}, interval {} ms)", instrument, depth,
+                 interval_ms);
         
-        if (g_ws_client && subscriptions_[instrument].size() == 1) {
-            g_ws_client->subscribe_orderbook(instrument);
+        WebSocketClient* feed = market_data_client(id);
+        if (feed && subscribers == 1) {
+            feed->subscribe_orderbook(instrument);
         }
     } else if (received["action"] == "unsubscribe") {
         std::string instrument = received["instrument"];
-        subscriptions_[instrument].erase(hdl);
-        std::cout << "[Server] Client unsubscribed from " << instrument << " clearly." << std::endl;
-        if (subscriptions_[instrument].empty() && g_ws_client) {
-            g_ws_client->unsubscribe_orderbook(instrument);
+        uint32_t id = getInstrumentRegistry().find(instrument);
+        size_t subscribers = id != InstrumentRegistry::kInvalidId ? remove_subscriber(id, client) : 0;
+        LOG_INFO("[Server] Client unsubscribed from {} clearly.", instrument);
+        WebSocketClient* feed = market_data_client(id);
+        if (subscribers == 0 && feed) {
+            feed->unsubscribe_orderbook(instrument);
         }
     } else if (received["action"] == "place_order") {
         std::string instrument = received["instrument"];
-        subscriptions_["private"].insert(hdl);
-        double amount = received["amount"];
         std::string direction = received["direction"];
         std::string order_type = received["order_type"];
-        double price = received.contains("price") ? received["price"].get<double>() : 0.0;
-        std::cout << "[Server] Received place_order request for " << instrument << std::endl;
-        if (g_ws_client) {
-            g_ws_client->place_order(instrument, amount, direction, order_type, price);
+        LOG_INFO("[Server] Received place_order request for {}", instrument);
+        OrderSide side = direction == "buy" ? OrderSide::BUY : OrderSide::SELL;
+        bool market = order_type == "market";
+        // Only limit and market orders have a fixed-point encoding; other
+        // types go out through the generic builder with the client's values.
+        bool typed = market || order_type == "limit";
+        uint32_t id = client_instrument(instrument);
+        const InstrumentSpec* spec = getInstrumentCache().find(id);
+        if (id == InstrumentRegistry::kInvalidId) {
+            send_error(hdl, "place_order", "unknown instrument " + instrument);
+        } else if (order_type == "limit" && !received.contains("price") && !received.contains("price_ticks")) {
+            send_error(hdl, "place_order", "limit orders need a price or price_ticks");
+        } else if (spec && typed) {
+            // Integer ticks and lots are taken as they are; decimal prices and
+            // amounts are put on the instrument's grid here, before sending.
+            Qty amount = received.contains("amount_lots") ? Qty{received["amount_lots"].get<int64_t>()}
+                                                          : spec->qty_from(received["amount"].get<double>());
+            Price price = received.contains("price_ticks") ? Price{received["price_ticks"].get<int64_t>()}
+                        : received.contains("price") ? spec->price_from(received["price"].get<double>()) : Price();
+            if (amount.lots <= 0) {
+                send_error(hdl, "place_order", "amount is below min_trade_amount of " + instrument);
+            } else if (pass_risk(hdl, "place_order", session, id, side, spec->to_double(amount),
+                                 market ? 0.0 : spec->to_double(price)) && g_ws_client) {
+                send_accepted(hdl, "place_order", g_ws_client->place_order(
+                    *spec, side, market ? OrderType::MARKET : OrderType::LIMIT, amount, price, session));
+            }
+        } else if (received.contains("amount_lots") || received.contains("price_ticks")) {
+            send_error(hdl, "place_order", spec ? "amount_lots and price_ticks need a limit or market order"
+                                                : "unknown instrument " + instrument);
+        } else {
+            double amount = received["amount"];
+            double price = received.contains("price") ? received["price"].get<double>() : 0.0;
+            if (pass_risk(hdl, "place_order", session, id, side, amount, market ? 0.0 : price) && g_ws_client) {
+                send_accepted(hdl, "place_order",
+                              g_ws_client->place_order(instrument, amount, direction, order_type, price, session));
+            }
         }
     } else if (received["action"] == "cancel_order") {
-        subscriptions_["private"].insert(hdl);
         std::string order_id = received["order_id"];
-        std::cout << "[Server] Received cancel_order request for order " << order_id << std::endl;
-        if (g_ws_client) {
-            g_ws_client->cancel_order(order_id);
+        LOG_INFO("[Server] Received cancel_order request for order {}", order_id);
+        OrderRecord known;
+        if (getOrderManager().find(order_id, known) && !known.is_open()) {
+            send_error(hdl, "cancel_order", "order " + order_id + " is already " + order_state_name(known.state));
+        } else if (g_ws_client) {
+            send_accepted(hdl, "cancel_order", g_ws_client->cancel_order(order_id, session));
         }
     } else if (received["action"] == "modify_order") {
-        subscriptions_["private"].insert(hdl);
         std::string order_id = received["order_id"];
-        double new_amount = received["new_amount"];
-        double new_price = received["new_price"];
-        std::cout << "[Server] Received modify_order request for order " << order_id << std::endl;
-        if (g_ws_client) {
-            g_ws_client->modify_order(order_id, new_amount, new_price);
+        LOG_INFO("[Server] Received modify_order request for order {}", order_id);
+        OrderRecord known;
+        bool is_known = getOrderManager().find(order_id, known);
+        // Edits do not name the instrument on Deribit; it comes from the order
+        // table, or from the client, for the same up-front rounding and
+        // integer fields as place_order.
+        const InstrumentSpec* spec = received.contains("instrument")
+            ? getInstrumentCache().find(received["instrument"].get<std::string>())
+            : is_known ? getInstrumentCache().find(known.instrument) : nullptr;
+        if (is_known && !known.is_open()) {
+            send_error(hdl, "modify_order", "order " + order_id + " is already " + order_state_name(known.state));
+        } else if (spec) {
+            Qty amount = received.contains("new_amount_lots") ? Qty{received["new_amount_lots"].get<int64_t>()}
+                                                              : spec->qty_from(received["new_amount"].get<double>());
+            Price price = received.contains("new_price_ticks") ? Price{received["new_price_ticks"].get<int64_t>()}
+                                                               : spec->price_from(received["new_price"].get<double>());
+            if (amount.lots <= 0) {
+                send_error(hdl, "modify_order", "amount is below min_trade_amount of " + spec->name);
+            } else if (modify_passes_risk(hdl, session, is_known ? &known : nullptr, spec->to_double(amount),
+                                          spec->to_double(price)) && g_ws_client) {
+                send_accepted(hdl, "modify_order", g_ws_client->modify_order(order_id, *spec, amount, price, session));
+            }
+        } else if (received.contains("new_amount_lots") || received.contains("new_price_ticks")) {
+            send_error(hdl, "modify_order", "integer fields need a known instrument");
+        } else {
+            double new_amount = received["new_amount"];
+            double new_price = received["new_price"];
+            if (modify_passes_risk(hdl, session, is_known ? &known : nullptr, new_amount, new_price) && g_ws_client) {
+                send_accepted(hdl, "modify_order", g_ws_client->modify_order(order_id, new_amount, new_price, session));
+            }
+        }
+    } else if (received["action"] == "get_instrument") {
+        std::string instrument = received["instrument"];
+        const InstrumentSpec* spec = getInstrumentCache().find(instrument);
+        if (!spec) {
+            send_error(hdl, "get_instrument", "unknown instrument " + instrument);
+            return;
+        }
+        json response = {
+            {"action", "get_instrument"},
+            {"instrument", spec->name},
+            {"kind", spec->kind},
+            {"tick_size", spec->tick_size},
+            {"contract_size", spec->contract_size},
+            {"min_trade_amount", spec->min_trade_amount}
+        };
+        m_server.send(hdl, response.dump(), websocketpp::frame::opcode::text);
+    } else if (received["action"] == "get_open_orders") {
+        uint32_t id = InstrumentRegistry::kInvalidId;
+        if (received.contains("instrument")) {
+            id = getInstrumentRegistry().find(received["instrument"].get<std::string>());
+        }
+        std::vector<OrderRecord> orders;
+        if (!received.contains("instrument") || id != InstrumentRegistry::kInvalidId) {
+            getOrderManager().open_orders(id, orders);
+        }
+        json response = {{"action", "get_open_orders"}, {"orders", json::array()}};
+        for (const OrderRecord& order : orders) {
+            response["orders"].push_back(order_to_json(order));
+        }
+        m_server.send(hdl, response.dump(), websocketpp::frame::opcode::text);
+    } else if (received["action"] == "get_order") {
+        std::string order_id = received["order_id"];
+        OrderRecord order;
+        if (!getOrderManager().find(order_id, order)) {
+            send_error(hdl, "get_order", "unknown order " + order_id);
+            return;
         }
+        json response = {{"action", "get_order"}, {"order", order_to_json(order)}};
+        m_server.send(hdl, response.dump(), websocketpp::frame::opcode::text);
+    } else if (received["action"] == "get_fills") {
+        uint32_t id = InstrumentRegistry::kInvalidId;
+        if (received.contains("instrument")) {
+            id = getInstrumentRegistry().find(received["instrument"].get<std::string>());
+        }
+        std::string order_id = received.contains("order_id") ? received["order_id"].get<std::string>() : "";
+        size_t count = received.contains("count") ? received["count"].get<size_t>() : 100;
+        std::vector<FillRecord> fills;
+        if (!received.contains("instrument") || id != InstrumentRegistry::kInvalidId) {
+            getOrderManager().fills(id, StrRef{order_id.data(), order_id.size()}, count, fills);
+        }
+        json response = {{"action", "get_fills"}, {"fills", json::array()}};
+        for (const FillRecord& fill : fills) {
+            response["fills"].push_back(fill_to_json(fill));
+        }
+        m_server.send(hdl, response.dump(), websocketpp::frame::opcode::text);
+    } else if (received["action"] == "authorize") {
+        std::string secret = received.value("secret", "");
+        if (!secret_matches(operator_secret_, secret)) {
+            LOG_WARN("[Server] Session {} failed operator authorization", session);
+            send_error(hdl, "authorize", "invalid operator secret");
+            return;
+        }
+        client->operator_session = true;
+        LOG_INFO("[Server] Session {} authorized as operator", session);
+        json response = {{"action", "authorize"}, {"operator", true}};
+        m_server.send(hdl, response.dump(), websocketpp::frame::opcode::text);
+    } else if (received["action"] == "kill_switch") {
+        // Account-wide either way, so neither engaging nor releasing is open to
+        // an ordinary client.
+        if (!client->operator_session) {
+            LOG_WARN("[Server] Kill switch refused for session {}: not an operator", session);
+            send_error(hdl, "kill_switch", "needs an operator session");
+            return;
+        }
+        bool engaged = received.contains("engaged") ? received["engaged"].get<bool>() : true;
+        getRiskGate().set_kill_switch(engaged);
+        size_t cancelled = 0;
+        if (engaged) {
+            // Stop new orders first, then pull everything still resting.
+            std::vector<OrderRecord> open;
+            getOrderManager().open_orders(InstrumentRegistry::kInvalidId, open);
+            for (const OrderRecord& order : open) {
+                if (g_ws_client) {
+                    g_ws_client->cancel_order(order.id(), session);
+                    ++cancelled;
+                }
+            }
+        }
+        LOG_WARN("[Server] Kill switch {} by session {}, {} open orders cancelled",
+                 engaged ? "engaged" : "released", session, cancelled);
+        json response = {{"action", "kill_switch"}, {"engaged", engaged}, {"cancelled", cancelled}};
+        m_server.send(hdl, response.dump(), websocketpp::frame::opcode::text);
     } else if (received["action"] == "get_positions") {
-        subscriptions_["private"].insert(hdl);
-        std::cout << "[Server] Received get_positions request." << std::endl;
+        LOG_INFO("[Server] Received get_positions request.");
         if (g_ws_client) {
-            g_ws_client->get_positions();
+            g_ws_client->get_positions(session);
+        }
+    } else if (received["action"] == "get_stats") {
+        FanoutStats stats = fanout_stats();
+        OrderManagerStats orders = getOrderManager().stats();
+        json risk_rejects = json::object();
+        for (size_t r = 1; r < static_cast<size_t>(RiskResult::RESULT_COUNT); ++r) {
+            RiskResult result = static_cast<RiskResult>(r);
+            risk_rejects[risk_result_name(result)] = getRiskGate().rejects(result);
+        }
+        json clients = json::array();
+        uint64_t now = LatencyClock::now();
+        for (const auto& entry : sessions_) {
+            const Client& peer = *entry.second;
+            uint64_t since = peer.behind_since.load(std::memory_order_relaxed);
+            clients.push_back({
+                {"session", peer.session},
+                {"buffered", peer.buffered.load(std::memory_order_relaxed)},
+                {"max_buffered", peer.max_buffered.load(std::memory_order_relaxed)},
+                {"sent", peer.sent.load(std::memory_order_relaxed)},
+                {"conflating", since != 0},
+                {"lag_ms", since ? LatencyClock::to_nanoseconds(now - since) / 1000000 : 0},
+                {"conflated", peer.conflated.load(std::memory_order_relaxed)},
+                {"conflations", peer.conflations.load(std::memory_order_relaxed)}
+            });
+        }
+        json credits = json::object();
+        for (size_t c = 0; c < static_cast<size_t>(RequestClass::CLASS_COUNT); ++c) {
+            RequestClass request_class = static_cast<RequestClass>(c);
+            CreditStats usage = getRateLimiter().stats(request_class);
+            credits[request_class_name(request_class)] = {
+                {"available", usage.available},
+                {"max", usage.max_credits},
+                {"sent", usage.sent},
+                {"queued", usage.queued},
+                {"shed", usage.shed},
+                {"exchange_rejects", usage.exchange_rejects}
+            };
+        }
+        uint64_t book_resyncs = 0;
+        if (getConnectionPool().configured()) {
+            credits["scheduled"] = getConnectionPool().scheduled_requests();
+            book_resyncs = getConnectionPool().book_resyncs();
+        } else {
+            credits["scheduled"] = g_ws_client ? g_ws_client->scheduled_requests() : 0;
+            book_resyncs = g_ws_client ? g_ws_client->book_resyncs() : 0;
         }
+        json response = {
+            {"fanout_queue", {
+                {"depth", stats.depth},
+                {"capacity", stats.capacity},
+                {"drops", stats.drops},
+                {"high_water_mark", stats.high_water_mark},
+                {"delayed_responses", g_ws_client ? g_ws_client->delayed_responses() : 0}
+            }},
+            {"risk", {
+                {"kill_switch", getRiskGate().kill_switch()},
+                {"exposure_loaded", getRiskGate().exposure_loaded()},
+                {"rejects", risk_rejects}
+            }},
+            {"credits", credits},
+            {"clients", clients},
+            {"slow_disconnects", slow_disconnects_.load(std::memory_order_relaxed)},
+            {"book_resyncs", book_resyncs},
+            {"orders", {
+                {"open", orders.open_orders},
+                {"tracked", orders.tracked_orders},
+                {"fills", orders.fills},
+                {"recycled", orders.recycled}
+            }}
+        };
+        m_server.send(hdl, response.dump(), websocketpp::frame::opcode::text);
     } else if(received["action"] == "get_orderbook") {
-        subscriptions_["private"].insert(hdl);
         std::string instrument = received["instrument"];
-        int depth = received.contains("depth") ? received["depth"].get<double>() : 10;
-        std::cout << "[Server] Received get_orderbook request for " << instrument << " with depth " << depth << std::endl;
-        if (g_ws_client) {
-            g_ws_client->get_order_book(instrument, depth);
+        int64_t depth = received.value("depth", int64_t(10));
+        if (depth <= 0) {
+            send_error(hdl, "get_orderbook", "depth must be positive");
+            return;
+        }
+        depth = std::min(depth, kMaxViewDepth);
+        LOG_INFO("[Server] Received get_orderbook request for {} with depth {}", instrument, depth);
+        std::string local = render_local_orderbook(instrument, depth);
+        if (!local.empty()) {
+            m_server.send(hdl, local, websocketpp::frame::opcode::text);
+        } else if (WebSocketClient* feed = market_data_client(getInstrumentRegistry().find(instrument))) {
+            feed->get_order_book(instrument, depth, session);
         }
     }
 }
 
+uint32_t WebSocketServer::client_instrument(const std::string& name) {
+    InstrumentRegistry& registry = getInstrumentRegistry();
+    uint32_t id = registry.find(name);
+    if (id != InstrumentRegistry::kInvalidId) return id;
+    // With metadata loaded, every tradeable name is already in the registry.
+    if (getInstrumentCache().size() > 0 || client_interned_ >= kMaxClientInstruments) {
+        return InstrumentRegistry::kInvalidId;
+    }
+    id = registry.intern(name);
+    if (id != InstrumentRegistry::kInvalidId) ++client_interned_;
+    return id;
+}
+
+void WebSocketServer::send_error(connection_hdl hdl, const char* action, const std::string& message) {
+    json response = {
+        {"action", action},
+        {"error", message}
+    };
+    websocketpp::lib::error_code ec;
+    m_server.send(hdl, response.dump(), websocketpp::frame::opcode::text, ec);
+}
+
+void WebSocketServer::send_accepted(connection_hdl hdl, const char* action, uint64_t request_id) {
+    json response = {
+        {"action", action},
+        {"request_id", request_id}
+    };
+    websocketpp::lib::error_code ec;
+    m_server.send(hdl, response.dump(), websocketpp::frame::opcode::text, ec);
+}
+
+bool WebSocketServer::pass_risk(connection_hdl hdl, const char* action, uint32_t session, uint32_t instrument,
+                                OrderSide side, double amount, double price, double replaced) {
+    RiskResult result = getRiskGate().check(session, instrument, side, amount, price, replaced);
+    if (result == RiskResult::ACCEPTED) return true;
+    LOG_EVERY_MS(LOG_LEVEL_WARN, 1000, "[Server] Risk rejected {} from session {}: {} ({} more since last warning)",
+                 action, session, risk_result_name(result));
+    send_error(hdl, action, std::string("rejected by risk: ") + risk_result_name(result));
+    return false;
+}
+
+// Edits of orders the order table knows are checked like a new order of the
+// same side; for unknown ones only the session checks apply.
+bool WebSocketServer::modify_passes_risk(connection_hdl hdl, uint32_t session, const OrderRecord* order,
+                                         double new_amount, double new_price) {
+    if (!order) {
+        RiskResult result = getRiskGate().check_session(session);
+        if (result == RiskResult::ACCEPTED) return true;
+        send_error(hdl, "modify_order", std::string("rejected by risk: ") + risk_result_name(result));
+        return false;
+    }
+    return pass_risk(hdl, "modify_order", session, order->instrument, order->side, new_amount,
+                     order->type == OrderType::MARKET ? 0.0 : new_price, order->amount);
+}
+
+// Answers get_orderbook from the local book in the same shape as Deribit's
+// public/get_order_book result. Empty if the instrument has no synced book.
+std::string WebSocketServer::render_local_orderbook(const std::string& instrument, int depth) {
+    OrderBookStore::Entry* entry = getOrderBookStore().find(instrument);
+    if (!entry || depth <= 0) return "";
+    depth = static_cast<int>(std::min<int64_t>(depth, kMaxViewDepth));
+
+    std::vector<PriceLevel> bids(depth);
+    std::vector<PriceLevel> asks(depth);
+    size_t bid_count, ask_count;
+    int64_t change_id, timestamp;
+    {
+        std::lock_guard<std::mutex> lock(entry->mutex);
+        if (!entry->book.is_valid()) return "";
+        bid_count = entry->book.top(OrderBook::BID, bids.data(), bids.size());
+        ask_count = entry->book.top(OrderBook::ASK, asks.data(), asks.size());
+        change_id = entry->book.change_id();
+        timestamp = entry->book.timestamp();
+    }
+
+    json result = {
+        {"instrument_name", instrument},
+        {"change_id", change_id},
+        {"timestamp", timestamp},
+        {"bids", json::array()},
+        {"asks", json::array()}
+    };
+    for (size_t i = 0; i < bid_count; ++i) {
+        result["bids"].push_back({bids[i].price, bids[i].amount});
+    }
+    for (size_t i = 0; i < ask_count; ++i) {
+        result["asks"].push_back({asks[i].price, asks[i].amount});
+    }
+    if (bid_count) {
+        result["best_bid_price"] = bids[0].price;
+        result["best_bid_amount"] = bids[0].amount;
+    }
+    if (ask_count) {
+        result["best_ask_price"] = asks[0].price;
+        result["best_ask_amount"] = asks[0].amount;
+    }
+
+    json response = {
+        {"jsonrpc", "2.0"},
+        {"result", result}
+    };
+    return response.dump();
+}
+
 void WebSocketServer::run(uint16_t port) {
     m_server.init_asio();
 
@@ -92,18 +570,488 @@ void WebSocketServer::run(uint16_t port) {
     m_server.listen(port);
     m_server.start_accept();
 
-    std::cout << "[Server] WebSocket running clearly on port " << port << std::endl;
-    m_server.run();
+    start_fanout();
+
+    LOG_INFO("[Server] WebSocket running clearly on port {}", port);
+    run_event_loop(m_server, ThreadRole::SERVER_IO);
 }
 
-void WebSocketServer::broadcast(const std::string& instrument, const std::string& message) {
-    std::lock_guard<std::mutex> lock(connection_mutex_);
-    std::cout << "[Server] Broadcasting to instrument " << instrument << ": " << message << std::endl;
-    if (subscriptions_.count(instrument)) {
-        for (auto hdl : subscriptions_[instrument]) {
-            m_server.send(hdl, message, websocketpp::frame::opcode::text);
+void WebSocketServer::stop() {
+    m_server.stop();
+}
+
+void WebSocketServer::start_fanout() {
+    if (fanout_running_.exchange(true)) return;
+    fanout_thread_ = getThreadingConfig().spawn(ThreadRole::FANOUT, [this]() { fanout_loop(); });
+}
+
+size_t WebSocketServer::add_producer() {
+    if (fanout_running_) {
+        throw std::logic_error("Fan-out producers must be added before the fan-out thread starts");
+    }
+    fanout_queues_.emplace_back(new SpscQueue<MarketEvent>(kFanoutQueueCapacity));
+    return fanout_queues_.size() - 1;
+}
+
+bool WebSocketServer::publish(MarketEvent&& event, size_t producer) {
+    if (!fanout_queues_[producer]->try_push(std::move(event))) {
+        return false;
+    }
+    // Only pay for a wakeup when the fan-out thread has actually gone to sleep.
+    if (fanout_sleeping_.load()) {
+        std::lock_guard<std::mutex> lock(fanout_mutex_);
+        fanout_cond_.notify_one();
+    }
+    return true;
+}
+
+FanoutStats WebSocketServer::fanout_stats() const {
+    FanoutStats stats{0, 0, 0, 0};
+    for (const auto& queue : fanout_queues_) {
+        stats.depth += queue->depth();
+        stats.capacity += queue->capacity();
+        stats.drops += queue->drops();
+        stats.high_water_mark = std::max(stats.high_water_mark, queue->high_water_mark());
+    }
+    return stats;
+}
+
+void WebSocketServer::fanout_loop() {
+    MarketEvent event;
+    int idle = 0;
+    int passes = 0;
+    const bool busy_poll = getThreadingConfig().busy_poll(ThreadRole::FANOUT);
+    while (fanout_running_) {
+        // One event per queue per pass, so a busy market-data shard cannot
+        // hold back order responses from the order session.
+        bool found = false;
+        for (const auto& queue : fanout_queues_) {
+            if (!queue->try_pop(event)) continue;
+            found = true;
+            if (event.kind == MarketEvent::PRIVATE) {
+                send_to_session(event.target, event.payload, event.order_response);
+            } else {
+                broadcast(event.instrument, std::move(event.payload), event.kind, event.change_id);
+            }
+            if (event.received_at) {
+                getLatencyTracker().record_since(LatencyTracker::WEBSOCKET_MESSAGE_PROPAGATION, event.received_at);
+            }
+        }
+        if (found) {
+            idle = 0;
+            if (++passes % kCatchUpInterval == 0) {
+                if (!behind_.empty()) catch_up();
+                if (!pending_views_.empty()) flush_views();
+            }
+            continue;
+        }
+        if (!behind_.empty()) {
+            catch_up();
+        }
+        if (!pending_views_.empty()) {
+            flush_views();
         }
+        if (busy_poll) {
+            cpu_relax();
+            continue;
+        }
+        if (++idle < kFanoutSpinCount) {
+            continue;
+        }
+        // Spun long enough: sleep until the producer signals. The timeout covers
+        // the window between publishing and seeing the sleeping flag.
+        std::unique_lock<std::mutex> lock(fanout_mutex_);
+        fanout_sleeping_ = true;
+        bool empty = true;
+        for (const auto& queue : fanout_queues_) {
+            empty = empty && queue->empty();
+        }
+        if (empty && fanout_running_) {
+            fanout_cond_.wait_for(lock, std::chrono::milliseconds(1));
+        }
+        fanout_sleeping_ = false;
+        idle = 0;
+    }
+}
+
+size_t WebSocketServer::add_subscriber(uint32_t id, const std::shared_ptr<Client>& client,
+                                       const std::shared_ptr<ViewFeed>& view) {
+    std::shared_ptr<const SubscriberList> current = std::atomic_load(&subscribers_[id]);
+    std::shared_ptr<SubscriberList> updated = current
+        ? std::make_shared<SubscriberList>(*current)
+        : std::make_shared<SubscriberList>();
+    auto existing = std::find_if(updated->begin(), updated->end(),
+                                 [&](const Subscriber& subscriber) { return subscriber.client == client; });
+    if (existing != updated->end()) {
+        if (existing->view == view) return updated->size();
+        existing->view = view;
     } else {
-        std::cout << "[Server] No subscribers for instrument " << instrument << std::endl;
+        updated->push_back(Subscriber{client, view});
+    }
+    std::atomic_store(&subscribers_[id], std::shared_ptr<const SubscriberList>(updated));
+    return updated->size();
+}
+
+size_t WebSocketServer::remove_subscriber(uint32_t id, const std::shared_ptr<Client>& client) {
+    std::shared_ptr<const SubscriberList> current = std::atomic_load(&subscribers_[id]);
+    if (!current) return 0;
+    std::shared_ptr<SubscriberList> updated = std::make_shared<SubscriberList>();
+    updated->reserve(current->size());
+    for (const auto& existing : *current) {
+        if (existing.client != client) updated->push_back(existing);
+    }
+    if (updated->size() != current->size()) {
+        std::atomic_store(&subscribers_[id], std::shared_ptr<const SubscriberList>(updated));
+    }
+    return updated->size();
+}
+
+// Frames the payload once. Server-to-client frames are unmasked, so the same
+// header and payload bytes are valid on every connection; websocketpp queues a
+// prepared message as-is instead of building and framing a copy per send.
+server::message_ptr WebSocketServer::make_shared_frame(std::string payload, websocketpp::frame::opcode::value op) {
+    typedef server::message_ptr::element_type message_type;
+    server::message_ptr msg = websocketpp::lib::make_shared<message_type>(message_type::con_msg_man_ptr(), op, 0);
+    websocketpp::frame::basic_header header(op, payload.size(), true, false);
+    websocketpp::frame::extended_header extended(payload.size());
+    msg->set_header(websocketpp::frame::prepare_header(header, extended));
+    msg->get_raw_payload() = std::move(payload);
+    msg->set_prepared(true);
+    return msg;
+}
+
+void WebSocketServer::broadcast(const std::string& instrument, std::string message) {
+    uint32_t id = getInstrumentRegistry().find(instrument);
+    if (id == InstrumentRegistry::kInvalidId) {
+        LOG_DEBUG("[Server] No subscribers for instrument {}", instrument);
+        return;
+    }
+    LOG_DEBUG("[Server] Broadcasting to instrument {}: {}", instrument, message);
+    broadcast(id, std::move(message));
+}
+
+void WebSocketServer::send_to_session(uint32_t session, const std::string& message, bool order_response) {
+    connection_hdl hdl;
+    bool binary = false;
+    {
+        std::lock_guard<std::mutex> lock(connection_mutex_);
+        auto it = sessions_.find(session);
+        if (it == sessions_.end()) {
+            LOG_DEBUG("[Server] Dropping response for closed session {}", session);
+            return;
+        }
+        hdl = it->second->hdl;
+        binary = it->second->binary.load(std::memory_order_relaxed);
+    }
+    std::string wire;
+    if (binary && order_response && encode_wire_order_ack(message, wire)) {
+        websocketpp::lib::error_code ec;
+        m_server.send(hdl, wire, websocketpp::frame::opcode::binary, ec);
+        return;
+    }
+    websocketpp::lib::error_code ec;
+    m_server.send(hdl, message, websocketpp::frame::opcode::text, ec);
+}
+
+void WebSocketServer::broadcast(uint32_t id, std::string message, MarketEvent::Kind kind, int64_t change_id) {
+    if (id >= subscribers_.size()) return;
+    std::shared_ptr<const SubscriberList> subscribers = std::atomic_load(&subscribers_[id]);
+    if (!subscribers || subscribers->empty()) return;
+
+    server::message_ptr frame = make_shared_frame(std::move(message), websocketpp::frame::opcode::text);
+    // Encoded at most once per event, and only when a binary client is there.
+    server::message_ptr wire_frame;
+    bool wire_tried = false;
+    for (const auto& subscriber : *subscribers) {
+        const std::shared_ptr<Client>& client = subscriber.client;
+        if (subscriber.view && kind == MarketEvent::BOOK) {
+            // Views diff the local book, which already has this delta applied,
+            // instead of forwarding it.
+            if (std::find(touched_views_.begin(), touched_views_.end(), subscriber.view) == touched_views_.end()) {
+                touched_views_.push_back(subscriber.view);
+            }
+            continue;
+        }
+        if (client->binary.load(std::memory_order_relaxed)) {
+            if (!wire_tried) {
+                wire_tried = true;
+                std::string wire;
+                if (encode_wire_notification(id, frame->get_payload(), wire)) {
+                    wire_frame = make_shared_frame(std::move(wire), websocketpp::frame::opcode::binary);
+                }
+            }
+            if (wire_frame) {
+                deliver(client, id, kind, change_id, wire_frame);
+                continue;
+            }
+        }
+        deliver(client, id, kind, change_id, frame);
+    }
+    for (const auto& view : touched_views_) {
+        schedule_view(view, *subscribers);
+    }
+    touched_views_.clear();
+}
+
+bool WebSocketServer::deliver(const std::shared_ptr<Client>& client, uint32_t id, MarketEvent::Kind kind,
+                              int64_t change_id, const server::message_ptr& frame,
+                              const std::shared_ptr<ViewFeed>& view) {
+    if (client->closing.load(std::memory_order_relaxed)) return false;
+    size_t buffered = client->connection->get_buffered_amount();
+    client->buffered.store(buffered, std::memory_order_relaxed);
+    if (buffered > client->max_buffered.load(std::memory_order_relaxed)) {
+        client->max_buffered.store(buffered, std::memory_order_relaxed);
+    }
+    if (backpressure_.disconnect_above && buffered > backpressure_.disconnect_above) {
+        disconnect_slow(*client, buffered);
+        return false;
+    }
+    if (!client->conflating && backpressure_.conflate_above && buffered > backpressure_.conflate_above) {
+        client->conflating = true;
+        client->conflations.fetch_add(1, std::memory_order_relaxed);
+        client->behind_since.store(LatencyClock::now(), std::memory_order_relaxed);
+        behind_.push_back(client);
+        LOG_EVERY_MS(LOG_LEVEL_WARN, 1000, "[Server] Session {} is {} bytes behind, conflating ({} more since last warning)",
+                     client->session, buffered);
+    }
+    if (client->conflating) {
+        hold(*client, id, kind, frame, view);
+        return false;
+    }
+    // Deltas already folded into a catch-up snapshot must not be applied twice.
+    if (kind == MarketEvent::BOOK && !view && !client->held.empty()) {
+        auto held = client->held.find(id);
+        if (held != client->held.end() && change_id <= held->second.snapshot_change_id) return false;
+    }
+    // A connection that closed mid-fan-out must not take the others down with it.
+    websocketpp::lib::error_code ec;
+    m_server.send(client->hdl, frame, ec);
+    if (ec) return false;
+    client->sent.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void WebSocketServer::hold(Client& client, uint32_t id, MarketEvent::Kind kind, const server::message_ptr& frame,
+                           const std::shared_ptr<ViewFeed>& view) {
+    Client::Held& held = client.held[id];
+    bool superseded = false;
+    if (kind == MarketEvent::BOOK && view) {
+        superseded = held.view != nullptr;
+        held.view = view;
+    } else if (kind == MarketEvent::BOOK) {
+        superseded = held.book;
+        held.book = true;
+    } else {
+        server::message_ptr& slot = kind == MarketEvent::TICKER ? held.ticker
+            : kind == MarketEvent::TRADES ? held.trades : held.other;
+        superseded = slot != nullptr;
+        slot = frame;
+    }
+    if (superseded) client.conflated.fetch_add(1, std::memory_order_relaxed);
+}
+
+void WebSocketServer::catch_up() {
+    for (size_t i = 0; i < behind_.size();) {
+        Client& client = *behind_[i];
+        if (client.closing.load(std::memory_order_relaxed) || send_held(client)) {
+            behind_[i] = std::move(behind_.back());
+            behind_.pop_back();
+        } else {
+            ++i;
+        }
+    }
+}
+
+bool WebSocketServer::send_held(Client& client) {
+    size_t buffered = client.connection->get_buffered_amount();
+    client.buffered.store(buffered, std::memory_order_relaxed);
+    if (backpressure_.disconnect_above && buffered > backpressure_.disconnect_above) {
+        disconnect_slow(client, buffered);
+        return true;
+    }
+    if (buffered > backpressure_.resume_below) return false;
+
+    // Snapshots first: they can fail while a book resyncs, and the client
+    // then stays behind rather than getting deltas it cannot apply.
+    for (auto& entry : client.held) {
+        Client::Held& held = entry.second;
+        if (!held.book) continue;
+        int64_t change_id = 0;
+        bool binary = client.binary.load(std::memory_order_relaxed);
+        std::string snapshot = render_book_snapshot(entry.first, binary, change_id);
+        if (snapshot.empty()) return false;
+        websocketpp::lib::error_code ec;
+        m_server.send(client.hdl, make_shared_frame(std::move(snapshot), binary ? websocketpp::frame::opcode::binary
+                                                                                : websocketpp::frame::opcode::text), ec);
+        held.book = false;
+        held.snapshot_change_id = change_id;
+    }
+    for (auto& entry : client.held) {
+        Client::Held& held = entry.second;
+        if (!held.view) continue;
+        // The view's levels as of its last refresh; its next delta chains on.
+        Client::ViewSync& sync = client.view_sync[entry.first];
+        sync = Client::ViewSync();
+        if (held.view->view.has_levels()) {
+            websocketpp::lib::error_code ec;
+            m_server.send(client.hdl, view_frame(*held.view, client.binary.load(std::memory_order_relaxed), true), ec);
+            if (!ec) sync = Client::ViewSync{held.view->view.serial(), held.view->view.change_id()};
+        }
+        held.view.reset();
+    }
+    for (auto& entry : client.held) {
+        Client::Held& held = entry.second;
+        for (server::message_ptr* slot : {&held.ticker, &held.trades, &held.other}) {
+            if (!*slot) continue;
+            websocketpp::lib::error_code ec;
+            m_server.send(client.hdl, *slot, ec);
+            slot->reset();
+        }
+    }
+    uint64_t since = client.behind_since.exchange(0, std::memory_order_relaxed);
+    LOG_INFO("[Server] Session {} caught up after {} ms", client.session,
+             LatencyClock::to_nanoseconds(LatencyClock::now() - since) / 1000000);
+    client.conflating = false;
+    return true;
+}
+
+std::shared_ptr<WebSocketServer::ViewFeed> WebSocketServer::find_view(uint32_t id, size_t depth,
+                                                                      uint32_t interval_ms) {
+    std::shared_ptr<const SubscriberList> current = std::atomic_load(&subscribers_[id]);
+    if (current) {
+        for (const auto& subscriber : *current) {
+            const std::shared_ptr<ViewFeed>& view = subscriber.view;
+            if (view && view->view.depth() == depth && view->view.interval_ms() == interval_ms) return view;
+        }
+    }
+    return std::make_shared<ViewFeed>(id, depth, interval_ms, next_view_serial_++);
+}
+
+void WebSocketServer::schedule_view(const std::shared_ptr<ViewFeed>& feed, const SubscriberList& subscribers) {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now < feed->next_due) {
+        if (!feed->pending) {
+            feed->pending = true;
+            pending_views_.push_back(feed);
+        }
+        return;
+    }
+    update_view(feed, subscribers, now);
+}
+
+void WebSocketServer::update_view(const std::shared_ptr<ViewFeed>& feed, const SubscriberList& subscribers,
+                                  std::chrono::steady_clock::time_point now) {
+    const BookView& view = feed->view;
+    OrderBookStore::Entry* entry = getOrderBookStore().find(view.instrument());
+    if (!entry) return;
+    bool changed = feed->view.refresh(*entry);
+    if (changed) {
+        feed->next_due = now + std::chrono::milliseconds(view.interval_ms());
+        for (auto& by_format : feed->frames) {
+            by_format[0].reset();
+            by_format[1].reset();
+        }
+    } else if (!view.has_levels()) {
+        return;
+    }
+
+    // Without a change only subscribers new to the view get anything: the
+    // window as it stands, rather than waiting for it to move.
+    uint32_t id = view.instrument();
+    for (const auto& subscriber : subscribers) {
+        if (subscriber.view != feed) continue;
+        Client& client = *subscriber.client;
+        Client::ViewSync& sync = client.view_sync[id];
+        if (sync.serial == view.serial() && sync.change_id == view.change_id()) continue;
+        // New to the view, or missed a change while held back or failing.
+        bool snapshot = !changed || sync.serial != view.serial() || sync.change_id != view.prev_change_id();
+        const server::message_ptr& frame = view_frame(*feed, client.binary.load(std::memory_order_relaxed), snapshot);
+        if (deliver(subscriber.client, id, MarketEvent::BOOK, view.change_id(), frame, feed)) {
+            sync = Client::ViewSync{view.serial(), view.change_id()};
+        }
+    }
+}
+
+void WebSocketServer::flush_views() {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < pending_views_.size();) {
+        std::shared_ptr<ViewFeed> feed = pending_views_[i];
+        if (now < feed->next_due) {
+            ++i;
+            continue;
+        }
+        pending_views_[i] = std::move(pending_views_.back());
+        pending_views_.pop_back();
+        feed->pending = false;
+        std::shared_ptr<const SubscriberList> subscribers = std::atomic_load(&subscribers_[feed->view.instrument()]);
+        if (subscribers) {
+            update_view(feed, *subscribers, now);
+        }
+    }
+}
+
+const server::message_ptr& WebSocketServer::view_frame(ViewFeed& feed, bool binary, bool snapshot) {
+    server::message_ptr& frame = feed.frames[binary][snapshot];
+    if (!frame) {
+        frame = binary ? make_shared_frame(feed.view.render_wire(snapshot), websocketpp::frame::opcode::binary)
+                       : make_shared_frame(feed.view.render_json(snapshot), websocketpp::frame::opcode::text);
+    }
+    return frame;
+}
+
+void WebSocketServer::disconnect_slow(Client& client, size_t buffered) {
+    if (client.closing.exchange(true)) return;
+    slow_disconnects_.fetch_add(1, std::memory_order_relaxed);
+    LOG_WARN("[Server] Closing session {}: {} bytes unsent", client.session, buffered);
+    websocketpp::lib::error_code ec;
+    client.connection->close(websocketpp::close::status::policy_violation, "slow consumer", ec);
+}
+
+std::string WebSocketServer::render_book_snapshot(uint32_t id, bool binary, int64_t& change_id) {
+    OrderBookStore::Entry* entry = getOrderBookStore().find(id);
+    if (!entry) return "";
+
+    std::vector<PriceLevel> bids;
+    std::vector<PriceLevel> asks;
+    int64_t timestamp;
+    {
+        std::lock_guard<std::mutex> lock(entry->mutex);
+        if (!entry->book.is_valid()) return "";
+        bids.resize(entry->book.depth(OrderBook::BID));
+        asks.resize(entry->book.depth(OrderBook::ASK));
+        bids.resize(entry->book.top(OrderBook::BID, bids.data(), bids.size()));
+        asks.resize(entry->book.top(OrderBook::ASK, asks.data(), asks.size()));
+        change_id = entry->book.change_id();
+        timestamp = entry->book.timestamp();
+    }
+
+    if (binary) {
+        std::string wire;
+        encode_wire_book_snapshot(id, change_id, timestamp, bids.data(), bids.size(), asks.data(), asks.size(), wire);
+        return wire;
+    }
+    const std::string& instrument = getInstrumentRegistry().name(id);
+    json data = {
+        {"type", "snapshot"},
+        {"instrument_name", instrument},
+        {"change_id", change_id},
+        {"timestamp", timestamp},
+        {"bids", json::array()},
+        {"asks", json::array()}
+    };
+    for (const auto& level : bids) {
+        data["bids"].push_back({"new", level.price, level.amount});
+    }
+    for (const auto& level : asks) {
+        data["asks"].push_back({"new", level.price, level.amount});
     }
+    json notification = {
+        {"jsonrpc", "2.0"},
+        {"method", "subscription"},
+        {"params", {
+            {"channel", getBookChannelConfig().channel(instrument)},
+            {"data", data}
+        }}
+    };
+    return notification.dump();
 }
@@ -1,5 +1,5 @@
-#include "auth.hpp"
 #include "websocket_client.hpp"
+#include "endpoints.hpp"
 #include "websocket_server.hpp"
 #include "tracker.hpp"
 #include <iostream>
@@ -15,34 +15,35 @@ WebSocketClient* g_ws_client = nullptr;
 WebSocketServer* g_ws_server = nullptr; //not used though
 
 int main() {
-    // Obtain REST token for private WebSocket requests.
     std::string client_id = "0uXsIP-O";
     std::string client_secret = "pq2Hswet8WhwSnLcdaAhyiLCz3gnbDj05OMKWdpM4w0";
-    std::string token = get_access_token(client_id, client_secret);
-    cout << "Access Token: " << token << "\n";
 
-    // Create WebSocket client instance and set the access token.
+    // The client authenticates its session once connected.
     WebSocketClient ws_client;
-    ws_client.access_token_ = token;
+    ws_client.set_credentials(client_id, client_secret);
     g_ws_client = &ws_client;
 
     std::thread deribitThread([&ws_client]() {
-        ws_client.connect("wss://test.deribit.com/ws/api/v2");
+        ws_client.connect(ws_url());
     });
 
-    std::this_thread::sleep_for(seconds(2));
+    auto ready = steady_clock::now() + seconds(10);
+    while (!ws_client.authenticated() && steady_clock::now() < ready) {
+        std::this_thread::sleep_for(milliseconds(10));
+    }
 
     LatencyTracker& tracker = getLatencyTracker();
 
+    // Round trips are timed by the client itself, from send to the matching
+    // response id, so just wait for each order's own acknowledgement (not the
+    // user stream subscription's) before the next order.
     for (int i = 0; i < 10; ++i) {
-        std::string order_unique_id = "ws_order_" + std::to_string(i);
-        tracker.start_measurement(LatencyTracker::ORDER_PLACEMENT, order_unique_id);
-
-        ws_client.place_order("BTC-PERPETUAL", 10, "buy", "market");
-
-        std::this_thread::sleep_for(milliseconds(200));
+        uint64_t id = ws_client.place_order("BTC-PERPETUAL", 10, "buy", "market");
 
-        tracker.stop_measurement(LatencyTracker::ORDER_PLACEMENT, order_unique_id);
+        auto deadline = steady_clock::now() + seconds(5);
+        while (ws_client.request_pending(id) && steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(microseconds(50));
+        }
     }
 
     cout << tracker.generate_report() << endl;
@@ -0,0 +1,106 @@
+#include "mock_exchange.hpp"
+#include "websocket_client.hpp"
+#include "endpoints.hpp"
+#include "instruments.hpp"
+#include "order_manager.hpp"
+#include "risk_gate.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+class WebSocketServer;
+WebSocketServer* g_ws_server = nullptr;
+WebSocketClient* g_ws_client = nullptr;
+
+// Places orders under a position limit against an in-process mock exchange.
+// An order resting on the account before the gateway connects has to count
+// toward the limit, which only holds once the gateway has loaded positions
+// and open orders from the exchange.
+namespace {
+
+const uint16_t kPort = 18443;
+const char* kInstrument = "BTC-PERPETUAL";
+
+int failures = 0;
+
+void expect(bool ok, const std::string& what) {
+    std::cout << (ok ? "ok   " : "FAIL ") << what << std::endl;
+    if (!ok) ++failures;
+}
+
+bool wait_for(const std::function<bool()>& done, int timeout_ms = 10000) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (!done()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+void expect_risk(uint32_t instrument, double amount, RiskResult expected) {
+    RiskResult result = getRiskGate().check(1, instrument, OrderSide::BUY, amount, 60000.0);
+    expect(result == expected, std::string("buy ") + std::to_string(static_cast<int>(amount)) + " -> " +
+                               risk_result_name(result) + ", want " + risk_result_name(expected));
+}
+
+} // namespace
+
+int main() {
+    // Read once by ws_url(), so set before any client connects.
+    setenv("DERIBIT_WS_URL", ("wss://localhost:" + std::to_string(kPort) + "/ws/api/v2").c_str(), 1);
+    setenv("DERIBIT_TLS_VERIFY", "0", 1);
+
+    MockExchangeOptions options;
+    options.port = kPort;
+    options.churn_per_second = 0.0;
+    MockExchange exchange(options);
+    std::thread exchange_thread([&exchange]() { exchange.run(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    // Another session on the same account leaves an order resting; the
+    // gateway never sees it on its own streams.
+    WebSocketClient other(ThreadRole::ORDER_EGRESS);
+    other.set_credentials("risk-seed-test", "secret");
+    other.set_user_streams(false);
+    std::thread other_thread([&other]() { other.connect(ws_url()); });
+    expect(wait_for([&other]() { return other.authenticated(); }), "other session authenticated");
+    uint64_t resting = other.place_order(kInstrument, 30, OrderSide::BUY, OrderType::LIMIT, 60000.0);
+    expect(wait_for([&other, resting]() { return !other.request_pending(resting); }), "resting order acknowledged");
+
+    uint32_t instrument = getInstrumentRegistry().intern(kInstrument);
+    RiskLimits limits;
+    limits.max_position = 50;
+    getRiskGate().set_limits(instrument, limits);
+    expect_risk(instrument, 10, RiskResult::EXPOSURE_UNKNOWN);
+
+    WebSocketClient gateway(ThreadRole::ORDER_EGRESS);
+    gateway.set_credentials("risk-seed-test", "secret");
+    g_ws_client = &gateway;
+    std::thread gateway_thread([&gateway]() { gateway.connect(ws_url()); });
+    expect(wait_for([]() { return getRiskGate().exposure_loaded(); }), "exposure loaded");
+
+    // 30 resting + 10 fits under 50; 30 + 30 does not.
+    expect_risk(instrument, 10, RiskResult::ACCEPTED);
+    expect_risk(instrument, 30, RiskResult::POSITION);
+
+    uint64_t placed = gateway.place_order(kInstrument, 10, OrderSide::BUY, OrderType::LIMIT, 60000.0);
+    expect(wait_for([&gateway, placed]() { return !gateway.request_pending(placed); }), "gateway order acknowledged");
+    std::vector<OrderRecord> open;
+    expect(wait_for([instrument, &open]() { return getOrderManager().open_orders(instrument, open) == 2; }),
+           "both orders open in the OMS");
+    expect_risk(instrument, 10, RiskResult::ACCEPTED);
+    expect_risk(instrument, 20, RiskResult::POSITION);
+
+    gateway.stop();
+    other.stop();
+    exchange.stop();
+    gateway_thread.join();
+    other_thread.join();
+    exchange_thread.join();
+
+    std::cout << (failures == 0 ? "PASS" : "FAILED") << std::endl;
+    return failures == 0 ? 0 : 1;
+}